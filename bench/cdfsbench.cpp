@@ -0,0 +1,432 @@
+//	zawa-ch/cdfs:/bench/cdfsbench
+//	Copyright 2020 zawa-ch.
+//
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cdfs/cdfs.hpp"
+#include "cdfs/builder.hpp"
+#include "cdfs/loader.hpp"
+#include "cdfs/validator.hpp"
+#include "cdfs/compression.hpp"
+#include "cdfs/framerange.hpp"
+#ifdef CDFS_HAS_FILEBUFFER
+#include "cdfs/filebuffer.hpp"
+#endif
+using namespace zawa_ch::CDFS;
+
+///	最適化による計算の除去を防ぐ
+template<typename T>
+inline void Escape(T& value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+///	書き込まれたデータを破棄するストリームバッファ
+class NullBuffer final : public std::streambuf
+{
+protected:
+	std::streamsize xsputn(const char_type*, std::streamsize count) override { return count; }
+	int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+};
+
+///	メモリ上のデータを読み込むストリームバッファ
+class MemoryBuffer final : public std::streambuf
+{
+public:
+	MemoryBuffer(const std::string& data)
+	{
+		auto p = const_cast<char_type*>(data.data());
+		setg(p, p, p + data.size());
+	}
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+	{
+		if (!(which & std::ios_base::in)) { return pos_type(off_type(-1)); }
+		off_type base = (dir == std::ios_base::beg)?0:((dir == std::ios_base::cur)?(gptr() - eback()):(egptr() - eback()));
+		return seekpos(pos_type(base + off), which);
+	}
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+	{
+		if (!(which & std::ios_base::in) || (off_type(pos) < 0) || (off_type(pos) > (egptr() - eback()))) { return pos_type(off_type(-1)); }
+		setg(eback(), eback() + off_type(pos), egptr());
+		return pos;
+	}
+};
+
+///	計測結果
+struct BenchResult
+{
+	std::string name;
+	size_t frames;
+	size_t bytes;
+	double nanoseconds;
+};
+
+///	指定の処理を繰り返し実行し、最も短い所要時間を計測結果とする
+BenchResult Measure(const std::string& name, const size_t& frames, const size_t& bytes, const size_t& repeat, const std::function<void()>& func)
+{
+	double best = 0.0;
+	for (size_t i = 0; i < repeat; i++)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+		if ((i == 0) || (ns < best)) { best = ns; }
+	}
+	return BenchResult{ name, frames, bytes, best };
+}
+
+///	使用法を表示する
+void usage()
+{
+	std::cout << "\tUsage: <program> [--format csv|json] [--frames N] [--repeat N]" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+	size_t frames = 65536U;
+	size_t repeat = 5U;
+	bool json = false;
+	for (int i = 1; i < argc; i++)
+	{
+		auto arg = std::string_view(argv[i]);
+		if ((arg == "--format") && ((i + 1) < argc))
+		{
+			auto format = std::string_view(argv[++i]);
+			if (format == "json") { json = true; }
+			else if (format == "csv") { json = false; }
+			else { usage(); return 2; }
+		}
+		else if ((arg == "--frames") && ((i + 1) < argc)) { frames = size_t(std::strtoull(argv[++i], nullptr, 10)); }
+		else if ((arg == "--repeat") && ((i + 1) < argc)) { repeat = size_t(std::strtoull(argv[++i], nullptr, 10)); }
+		else { usage(); return 2; }
+	}
+	if ((frames == 0U) || (repeat == 0U)) { usage(); return 2; }
+
+	// 計測用のデータを準備する
+	auto engine = std::mt19937_64(0x43444653U);
+	auto payload = std::vector<uint8_t>(frames * 240U);
+	for (auto& b : payload) { b = uint8_t(engine()); }
+	auto framelist = std::vector<CDFSFrame>(frames);
+	for (size_t i = 0; i < frames; i++)
+	{
+		framelist[i].sequence = uint64_t(i);
+		framelist[i].frametype = CDFSFrameTypes::DATA;
+		std::memcpy(framelist[i].data.data(), payload.data() + (i * 240U), 240U);
+		framelist[i].Validate();
+	}
+	auto image = std::string();
+	{
+		auto stream = std::ostringstream();
+		auto builder = CDFSBuilder("cdfs-bench");
+		builder.WriteHEADFrame(stream, UInt128(uint64_t(frames + 2U)), UInt128(uint64_t(payload.size())));
+		builder.Write(stream, payload.data(), payload.size());
+		builder.WriteFINFFrame(stream);
+		image = stream.str();
+	}
+	// 圧縮の計測には、単語を無作為に並べた圧縮できるデータを使用する
+	auto text = std::vector<uint8_t>(payload.size());
+	{
+		static constexpr std::string_view words[] = { "frame ", "sequence ", "checksum ", "data ", "stream ", "label ", "size\n", "0123456789 " };
+		size_t i = 0U;
+		while (i < text.size())
+		{
+			auto word = words[engine() % std::size(words)];
+			auto count = ((text.size() - i) < word.size())?(text.size() - i):word.size();
+			std::memcpy(text.data() + i, word.data(), count);
+			i += count;
+		}
+	}
+	auto compressedimage = std::string();
+	{
+		auto stream = std::ostringstream();
+		auto builder = CDFSBuilder("cdfs-bench");
+		builder.SetCompression(1U);
+		builder.WriteHEADFrame(stream);
+		builder.Write(stream, text.data(), text.size());
+		builder.WriteFINFFrame(stream);
+		compressedimage = stream.str();
+	}
+	// 小さなレコードを複数のチャンネルに交互に書き込んだCDFSデータ
+	constexpr size_t ChannelCount = 8U;
+	constexpr size_t RecordSize = 64U;
+	auto multiplex = [&](std::ostream& stream)
+	{
+		auto builder = CDFSBuilder("cdfs-bench");
+		builder.WriteHEADFrame(stream);
+		for (size_t i = 0; i < payload.size(); i += RecordSize)
+		{
+			auto count = ((payload.size() - i) < RecordSize)?(payload.size() - i):RecordSize;
+			builder.Write(stream, uint32_t((i / RecordSize) % ChannelCount), payload.data() + i, count);
+		}
+		builder.WriteFINFFrame(stream);
+	};
+	auto multiplexedimage = std::string();
+	{
+		auto stream = std::ostringstream();
+		multiplex(stream);
+		multiplexedimage = stream.str();
+	}
+
+	auto results = std::vector<BenchResult>();
+	const size_t framebytes = frames * sizeof(CDFSFrame);
+
+	results.push_back(Measure("crc32-push", frames, framebytes, repeat, [&]()
+	{
+		uint32_t acc = 0U;
+		for (const auto& frame : framelist)
+		{
+			auto crc = CRC32();
+			auto p = reinterpret_cast<const uint8_t*>(&frame);
+			crc.Push(p, p + 252U);
+			acc ^= crc.GetValue();
+		}
+		Escape(acc);
+	}));
+	results.push_back(Measure("crc32-push-table", frames, framebytes, repeat, [&]()
+	{
+		uint32_t acc = 0U;
+		for (const auto& frame : framelist)
+		{
+			auto crc = CRC32();
+			auto p = reinterpret_cast<const uint8_t*>(&frame);
+			crc.Push(p, p + 252U, CRC32::Implementations::Table);
+			acc ^= crc.GetValue();
+		}
+		Escape(acc);
+	}));
+	results.push_back(Measure("xxh3-push", frames, framebytes, repeat, [&]()
+	{
+		auto hash = XXH3();
+		for (size_t i = 0; i < frames; i++) { hash.Push(payload.data() + (i * 240U), payload.data() + ((i + 1U) * 240U)); }
+		auto value = hash.GetValue();
+		Escape(value);
+	}));
+	results.push_back(Measure("frame-validate", frames, framebytes, repeat, [&]()
+	{
+		for (auto& frame : framelist) { frame.Validate(); }
+		Escape(framelist);
+	}));
+	results.push_back(Measure("frame-isvalid", frames, framebytes, repeat, [&]()
+	{
+		size_t valid = 0U;
+		for (const auto& frame : framelist) { if (frame.IsValid()) { valid++; } }
+		Escape(valid);
+	}));
+	results.push_back(Measure("validator-validate", frames, framebytes, repeat, [&]()
+	{
+		auto summary = CDFSValidator::Validate(Span<const CDFSFrame>(framelist.data(), framelist.size()), 0U);
+		Escape(summary);
+	}));
+	results.push_back(Measure("builder-writedataframe", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = NullBuffer();
+		auto stream = std::ostream(&buffer);
+		auto builder = CDFSBuilder("cdfs-bench");
+		builder.WriteHEADFrame(stream);
+		auto data = CDFSBuilder::ContainsType();
+		for (size_t i = 0; i < frames; i++)
+		{
+			std::memcpy(data.data(), payload.data() + (i * 240U), 240U);
+			builder.WriteDATAFrame(stream, data);
+		}
+		builder.Flush(stream);
+	}));
+	results.push_back(Measure("builder-write", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = NullBuffer();
+		auto stream = std::ostream(&buffer);
+		auto builder = CDFSBuilder("cdfs-bench");
+		builder.WriteHEADFrame(stream);
+		builder.Write(stream, payload.data(), payload.size());
+		builder.Flush(stream);
+	}));
+	results.push_back(Measure("loader-readnext-getdata", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = MemoryBuffer(image);
+		auto stream = std::istream(&buffer);
+		auto loader = CDFSLoader();
+		size_t total = 0U;
+		while (loader.ReadNext(stream))
+		{
+			if (loader.GetFrame()->frametype == CDFSFrameTypes::DATA) { total += loader.GetData().size(); }
+		}
+		if (total != payload.size()) { throw std::exception(); }
+	}));
+	results.push_back(Measure("loader-readdata", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = MemoryBuffer(image);
+		auto stream = std::istream(&buffer);
+		auto loader = CDFSLoader();
+		auto dest = std::vector<uint8_t>(65536U);
+		size_t total = 0U;
+		size_t count;
+		while ((count = loader.ReadData(stream, dest.data(), dest.size())) != 0U) { total += count; }
+		if (total != payload.size()) { throw std::exception(); }
+	}));
+	results.push_back(Measure("framerange-payload", frames, framebytes, repeat, [&]()
+	{
+		auto range = CDFSFrameRange(Span<const CDFSFrame>(reinterpret_cast<const CDFSFrame*>(image.data()), image.size() / sizeof(CDFSFrame)));
+		auto payloadrange = range.Payload();
+		size_t total = 0U;
+		for (const auto& data : payloadrange) { total += data.size(); }
+		if (total != payload.size()) { throw std::exception(); }
+	}));
+	results.push_back(Measure("builder-write-compressed", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = NullBuffer();
+		auto stream = std::ostream(&buffer);
+		auto builder = CDFSBuilder("cdfs-bench");
+		builder.SetCompression(1U);
+		builder.WriteHEADFrame(stream);
+		builder.Write(stream, text.data(), text.size());
+		builder.Flush(stream);
+	}));
+	results.push_back(Measure("loader-readdata-compressed", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = MemoryBuffer(compressedimage);
+		auto stream = std::istream(&buffer);
+		auto loader = CDFSLoader();
+		auto dest = std::vector<uint8_t>(65536U);
+		size_t total = 0U;
+		size_t count;
+		while ((count = loader.ReadData(stream, dest.data(), dest.size())) != 0U) { total += count; }
+		if (total != text.size()) { throw std::exception(); }
+	}));
+	results.push_back(Measure("compression-extract", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = NullBuffer();
+		auto stream = std::ostream(&buffer);
+		auto compressedframes = Span<const CDFSFrame>(reinterpret_cast<const CDFSFrame*>(compressedimage.data()), compressedimage.size() / sizeof(CDFSFrame));
+		if (!CDFSCompression::Extract(compressedframes, stream)) { throw std::exception(); }
+	}));
+	results.push_back(Measure("framerange-payload-compressed", frames, framebytes, repeat, [&]()
+	{
+		auto range = CDFSFrameRange(Span<const CDFSFrame>(reinterpret_cast<const CDFSFrame*>(compressedimage.data()), compressedimage.size() / sizeof(CDFSFrame)));
+		auto payloadrange = range.Payload();
+		size_t total = 0U;
+		for (const auto& data : payloadrange) { total += data.size(); }
+		if (total != text.size()) { throw std::exception(); }
+	}));
+	results.push_back(Measure("builder-write-multiplexed", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = NullBuffer();
+		auto stream = std::ostream(&buffer);
+		multiplex(stream);
+	}));
+	results.push_back(Measure("loader-demultiplex", frames, framebytes, repeat, [&]()
+	{
+		auto buffer = MemoryBuffer(multiplexedimage);
+		auto stream = std::istream(&buffer);
+		auto loader = CDFSLoader();
+		auto totals = std::array<size_t, ChannelCount>();
+		loader.Demultiplex(stream, [&](const uint32_t& channel, const uint8_t*, const size_t& size) { totals[channel % ChannelCount] += size; });
+		size_t total = 0U;
+		for (const auto& item : totals) { total += item; }
+		if (total != payload.size()) { throw std::exception(); }
+	}));
+	{
+		// ファイルへの書き込み・ファイルからの読み込み(ページキャッシュを経由する)
+		auto path = (std::filesystem::temp_directory_path() / "cdfs-bench.cdfs").string();
+		auto write = [&](std::ostream& stream)
+		{
+			auto builder = CDFSBuilder("cdfs-bench");
+			builder.WriteHEADFrame(stream);
+			builder.Write(stream, payload.data(), payload.size());
+			builder.WriteFINFFrame(stream);
+			stream.flush();
+		};
+		auto read = [&](std::istream& stream)
+		{
+			auto loader = CDFSLoader();
+			auto dest = std::vector<uint8_t>(65536U);
+			size_t total = 0U;
+			size_t count;
+			while ((count = loader.ReadData(stream, dest.data(), dest.size())) != 0U) { total += count; }
+			if (total != payload.size()) { throw std::exception(); }
+		};
+		results.push_back(Measure("file-write-fstream", frames, framebytes, repeat, [&]()
+		{
+			auto stream = std::ofstream(path, std::ios_base::binary | std::ios_base::trunc);
+			write(stream);
+		}));
+		results.push_back(Measure("file-read-fstream", frames, framebytes, repeat, [&]()
+		{
+			auto stream = std::ifstream(path, std::ios_base::binary);
+			read(stream);
+		}));
+#ifdef CDFS_HAS_FILEBUFFER
+		for (auto backend : { CDFSFileBuffer::Backends::Blocking, CDFSFileBuffer::Backends::IOUring })
+		{
+			if (!CDFSFileBuffer::IsSupported(backend)) { continue; }
+			auto suffix = std::string((backend == CDFSFileBuffer::Backends::IOUring)?"iouring":"blocking");
+			results.push_back(Measure("file-write-" + suffix, frames, framebytes, repeat, [&]()
+			{
+				auto buffer = CDFSFileBuffer(path, std::ios_base::out, backend);
+				auto stream = std::ostream(&buffer);
+				write(stream);
+			}));
+			results.push_back(Measure("file-read-" + suffix, frames, framebytes, repeat, [&]()
+			{
+				auto buffer = CDFSFileBuffer(path, std::ios_base::in, backend);
+				auto stream = std::istream(&buffer);
+				read(stream);
+			}));
+		}
+#endif
+		std::filesystem::remove(path);
+	}
+	results.push_back(Measure("uint128-counter", frames, framebytes, repeat, [&]()
+	{
+		UInt128 frameindex = UInt128(0U);
+		UInt128 dataindex = UInt128(0U);
+		for (size_t i = 0; i < frames; i++)
+		{
+			Escape(frameindex);
+			frameindex += UInt128(1U);
+			dataindex += UInt128(240U);
+		}
+		Escape(frameindex);
+		Escape(dataindex);
+	}));
+
+	if (json)
+	{
+		std::cout << "[" << std::endl;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const auto& r = results[i];
+			std::cout << "\t{ \"name\": \"" << r.name << "\", \"frames\": " << r.frames << ", \"bytes\": " << r.bytes
+				<< ", \"ns_per_frame\": " << (r.nanoseconds / double(r.frames)) << ", \"gb_per_s\": " << (double(r.bytes) / r.nanoseconds) << " }"
+				<< (((i + 1) < results.size())?",":"") << std::endl;
+		}
+		std::cout << "]" << std::endl;
+	}
+	else
+	{
+		std::cout << "name,frames,bytes,ns_per_frame,gb_per_s" << std::endl;
+		for (const auto& r : results)
+		{
+			std::cout << r.name << "," << r.frames << "," << r.bytes << "," << (r.nanoseconds / double(r.frames)) << "," << (double(r.bytes) / r.nanoseconds) << std::endl;
+		}
+	}
+	return 0;
+}
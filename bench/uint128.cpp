@@ -0,0 +1,75 @@
+//	zawa-ch/cdfs:/bench/uint128
+//	Copyright 2020 zawa-ch.
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "cdfs/datatype.hpp"
+using namespace zawa_ch::CDFS;
+
+///	最適化による計算の除去を防ぐ
+template<typename T>
+inline void Escape(T& value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+///	計測を行い、1回あたりの時間(ns)を出力する
+template<typename F>
+void Measure(const char* name, const size_t& iterations, F&& func)
+{
+	auto begin = std::chrono::steady_clock::now();
+	func(iterations);
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+#ifdef CDFS_NATIVE_UINT128
+	const char* backend = "native";
+#else
+	const char* backend = "portable";
+#endif
+	std::cout << name << "," << backend << "," << iterations << "," << (ns / double(iterations)) << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+	size_t iterations = (argc > 1)?size_t(std::strtoull(argv[1], nullptr, 10)):size_t(50000000U);
+	std::cout << "name,backend,iterations,ns_per_op" << std::endl;
+
+	// フレーム毎に行われるカウンタの更新(フレーム番号・データ位置の加算とシーケンス番号の照合)
+	Measure("frame-counter", iterations, [](const size_t& n)
+	{
+		UInt128 frameindex = UInt128(0U);
+		UInt128 dataindex = UInt128(0U);
+		UInt128 datasize = UInt128(std::numeric_limits<uintmax_t>::max()) << 8;
+		size_t mismatch = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			Escape(frameindex);
+			if (frameindex != UInt128(uint64_t(i))) { mismatch++; }
+			frameindex += UInt128(1U);
+			if (dataindex < datasize) { dataindex += UInt128(240U); }
+		}
+		Escape(frameindex);
+		Escape(dataindex);
+		Escape(mismatch);
+	});
+
+	// フレーム位置からペイロード位置への換算
+	Measure("frame-offset", iterations, [](const size_t& n)
+	{
+		UInt128 acc = UInt128(0U);
+		for (size_t i = 0; i < n; i++)
+		{
+			UInt128 offset = (UInt128(uint64_t(i)) << 40) + UInt128(uint64_t(i));
+			Escape(offset);
+			acc ^= (offset / UInt128(240U)) + (offset % UInt128(240U)) * UInt128(256U);
+		}
+		Escape(acc);
+	});
+	return 0;
+}
@@ -4,6 +4,7 @@
 #include <array>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include "cdfs/builder.hpp"
@@ -12,20 +13,68 @@ using namespace zawa_ch::CDFS;
 ///	使用法を表示する
 void usage()
 {
-	std::cout << "\tUsage: <program> filename" << std::endl;
+	std::cout << "\tUsage: <program> [-z level] filename" << std::endl;
+	std::cout << "\t       <program> [-z level] - < source > dest.cdfs" << std::endl;
+}
+
+///	標準入力から読み込んだデータをCDFSデータとして標準出力に書き込む
+///	@details
+///	出力先はシークできないため、ストリーミングプロファイルで書き込む
+///	@param	level	圧縮レベル。
+int stream(const uint32_t& level)
+{
+	std::ios_base::sync_with_stdio(false);
+	std::cin.exceptions(std::ios_base::badbit);
+	///	CDFSデータビルダー
+	auto builder = CDFSBuilder();
+	builder.EnableStreaming();
+	builder.SetCompression(level);
+	// 開始フレーム書き込み
+	builder.WriteHEADFrame(std::cout);
+	///	ストリームから読み込んだデータ
+	auto buffer = std::vector<uint8_t>(65536);
+	while(std::cin.good())
+	{
+		// 読み込み可能なデータのみを読み込み、読み込むデータがない場合は到着を待つ
+		auto readsize = std::cin.readsome((std::istream::char_type*)buffer.data(), std::streamsize(buffer.size()));
+		if (readsize <= 0)
+		{
+			std::cin.read((std::istream::char_type*)buffer.data(), 1);
+			readsize = std::cin.gcount();
+		}
+		// データフレームに分割して書き込み
+		builder.Write(std::cout, buffer.data(), size_t(readsize));
+		// 読み込んだデータを書き込み先に届ける
+		builder.Flush(std::cout);
+	}
+	// 終了フレーム書き込み
+	builder.WriteFINFFrame(std::cout);
+	std::cout.flush();
+	return std::cout.good()?0:1;
 }
 
 int main(int argc, char const *argv[])
 {
+	///	読み込みファイルのパス
+	auto source_filename = std::string_view();
+	///	圧縮レベル (0 の場合は圧縮しない)
+	uint32_t level = 0U;
+	// 引数の解析
+	for (int i = 1; i < argc; i++)
+	{
+		auto arg = std::string_view(argv[i]);
+		if ((arg == "-z")&&((i + 1) < argc)) { level = uint32_t(std::stoul(argv[++i])); }
+		else { source_filename = arg; }
+	}
 	// 引数の数のチェック
-	if (argc < 2)
+	if (source_filename.empty())
 	{
 		std::cerr << "E: Too few arguments" << std::endl;
 		usage();
 		return 2;
 	}
-	///	読み込みファイルのパス
-	auto source_filename = std::string_view(argv[1]);
+	// "-" が指定された場合は標準入力から標準出力へ書き込む
+	if (source_filename == "-") { return stream(level); }
 	///	読み込みファイルのストリーム
 	auto source_stream = std::ifstream(source_filename.data());
 	source_stream.exceptions(std::ios_base::badbit);
@@ -38,7 +87,7 @@ int main(int argc, char const *argv[])
 			return 1;
 		}
 		///	書き込みファイルのパス
-		auto dest_filename = std::string(argv[1]) + ".cdfs";
+		auto dest_filename = std::string(source_filename) + ".cdfs";
 		///	書き込みファイルのストリーム
 		auto dest_stream = std::ofstream(dest_filename);
 		if (!bool(dest_stream))
@@ -48,18 +97,21 @@ int main(int argc, char const *argv[])
 		}
 		///	CDFSデータビルダー
 		auto builder = CDFSBuilder();
+		builder.SetCompression(level);
+		// 索引の構築を開始
+		builder.EnableIndex();
 		// 開始フレーム書き込み
 		builder.WriteHEADFrame(dest_stream);
+		///	ストリームから読み込んだデータ
+		auto buffer = std::vector<uint8_t>(65536);
 		// 読み込みストリームから読み込み可能な限りデータを読み込む
 		while(source_stream.good())
 		{
-			///	ストリームから読み込んだデータ
-			auto buffer = CDFSBuilder::ContainsType();
-			source_stream.read((std::istream::char_type*)buffer.data(), buffer.size());
+			source_stream.read((std::istream::char_type*)buffer.data(), std::streamsize(buffer.size()));
 			///	ストリームから読み込まれたデータのサイズ
 			auto readsize = source_stream.gcount();
-			// データフレーム書き込み
-			builder.WriteDATAFrame(dest_stream, buffer, size_t(readsize));
+			// データフレームに分割して書き込み
+			builder.Write(dest_stream, buffer.data(), size_t(readsize));
 		}
 		// 終了フレーム書き込み
 		builder.WriteFINFFrame(dest_stream);
@@ -72,6 +124,12 @@ int main(int argc, char const *argv[])
 			builder.WriteHEADFrame(dest_stream);
 		}
 		dest_stream.clear();
+		// 索引ファイル書き込み
+		auto index_stream = std::ofstream(dest_filename + ".cdfsidx", std::ios_base::binary);
+		if ((!bool(index_stream))||(!builder.GetIndex()->Write(index_stream)))
+		{
+			std::cerr << "W: Can't write index file" << std::endl;
+		}
 	}
 	return 0;
 }
@@ -4,6 +4,7 @@
 #include <array>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include "cdfs/loader.hpp"
@@ -13,6 +14,49 @@ using namespace zawa_ch::CDFS;
 void usage()
 {
 	std::cout << "\tUsage: <program> filename.cdfs" << std::endl;
+	std::cout << "\t       <program> - < source.cdfs > dest" << std::endl;
+}
+
+///	CDFSデータの内容を読み出して書き込む
+///	@details
+///	最後のデータフレームは総サイズに合わせて切り詰めて書き込む
+///	@return	CDFSデータの整合性チェックに成功した場合は true
+bool extract(CDFSLoader& cdfsloader, std::istream& source, std::ostream& dest)
+{
+	///	読み出したデータ
+	auto buffer = std::vector<uint8_t>(65536);
+	while(true)
+	{
+		auto readsize = cdfsloader.ReadData(source, buffer.data(), buffer.size());
+		if (readsize != 0U)
+		{
+			dest.write((const std::ostream::char_type*)buffer.data(), std::streamsize(readsize));
+			dest.flush();
+		}
+		// 終了フレームに到達した場合やストリームの終端に達した場合は終了
+		else if ((cdfsloader.HasFINF())||(!source.good())) { break; }
+	}
+	// CDFSデータの整合性チェック
+	return cdfsloader.CheckIntegrity().value_or(false);
+}
+
+///	標準入力から読み込んだCDFSデータの内容を標準出力に書き込む
+///	@details
+///	入力元はシークできないため、ストリーミングプロファイルで読み込む
+int stream()
+{
+	std::ios_base::sync_with_stdio(false);
+	std::cin.exceptions(std::ios_base::badbit);
+	///	CDFSデータローダー
+	auto cdfsloader = CDFSLoader();
+	cdfsloader.EnableStreaming();
+	if (extract(cdfsloader, std::cin, std::cout))
+	{
+		std::cerr << "Complete" << std::endl;
+		return 0;
+	}
+	std::cerr << "W: Integrity check failed." << std::endl;
+	return 1;
 }
 
 int main(int argc, char const *argv[])
@@ -26,6 +70,8 @@ int main(int argc, char const *argv[])
 	}
 	///	読み込みファイルのパス
 	auto source_filename = std::string_view(argv[1]);
+	// "-" が指定された場合は標準入力から標準出力へ書き込む
+	if (source_filename == "-") { return stream(); }
 	if(source_filename.rfind(".cdfs") != (source_filename.size() - 5U))
 	{
 		std::cerr << "E: Source file name MUST ends with \".cdfs\"" << std::endl;
@@ -50,61 +96,7 @@ int main(int argc, char const *argv[])
 	}
 	///	CDFSデータローダー
 	auto cdfsloader = CDFSLoader();
-	while(cdfsloader.ReadNext(source_stream))
-	{
-		// CDFSデータの検証に失敗した場合警告
-		if (!cdfsloader.IsValidData())
-		{
-			std::cerr << "W: Frame " << uint64_t(cdfsloader.FrameIndex()) << " validation failed" << std::endl;
-		}
-		switch (cdfsloader.GetFrame()->frametype)
-		{
-		// 開始フレーム
-		case CDFSFrameTypes::HEAD:
-		{
-			auto frame = CDFSHEADFrame(cdfsloader.GetFrame().value());
-			std::cout << "-> HEAD Frame" << std::endl;
-			std::cout << "Label: " << std::string(frame.data_label().data()) << std::endl;
-			break;
-		}
-		// データフレーム
-		case CDFSFrameTypes::DATA:
-		{
-			auto data = cdfsloader.GetData();
-			if (cdfsloader.DataSize() <= cdfsloader.DataIndex())
-			{
-				dest_stream.write((const std::ostream::char_type*)data.data(), std::streamsize(size_t(cdfsloader.DataSize()%240)));
-			}
-			else
-			{
-				dest_stream.write((const std::ostream::char_type*)data.data(), std::streamsize(240));
-			}
-			break;
-		}
-		// 終了フレーム
-		case CDFSFrameTypes::FINF:
-		{
-			std::cout << "-> FINF Frame" << std::endl;
-			break;
-		}
-		// 継続フレーム
-		case CDFSFrameTypes::CONT:
-		{
-			auto frame = CDFSCONTFrame(cdfsloader.GetFrame().value());
-			std::cout << "-> CONT Frame" << std::endl;
-			std::cout << "Label: " << std::string(frame.data_label().data()) << std::endl;
-			break;
-		}
-		// フレーム種類を特定できなかった場合
-		default:
-		{
-			std::cerr << "W: Can't recognized frame type" << std::endl;
-			break;
-		}
-		}
-	}
-	// CDFSデータの整合性チェック
-	if (cdfsloader.CheckIntegrity().value_or(false))
+	if (extract(cdfsloader, source_stream, dest_stream))
 	{
 		std::cout << "Complete" << std::endl;
 	}
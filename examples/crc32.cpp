@@ -18,5 +18,7 @@ int main(int argc, char const *argv[])
 	crc32gen.Push(data);
 	auto crc = crc32gen.GetValue();
 	std::cout << std::hex << crc << std::endl;
+
+	std::cout << "implementation: " << ((CRC32::ActiveImplementation() == CRC32::Implementations::CLMUL)?"CLMUL":"Table") << std::endl;
 	return 0;
 }
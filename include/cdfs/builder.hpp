@@ -4,8 +4,15 @@
 #ifndef __cdfs_builder__
 #define __cdfs_builder__
 #include <array>
+#include <map>
+#include <memory>
+#include <vector>
+#include <optional>
 #include <iostream>
 #include "cdfs.hpp"
+#include "index.hpp"
+#include "compression.hpp"
+#include "counters.hpp"
 namespace zawa_ch::CDFS
 {
 	///	CDFSデータを構築するための機能を提供します。
@@ -13,12 +20,101 @@ namespace zawa_ch::CDFS
 	{
 	public:
 		typedef std::array<uint8_t, 240> ContainsType;
+		///	一度に書き込むデータフレームの最大数。
+		static constexpr size_t BatchSize = 256;
 	private:
+		///	書き込み待ちのデータフレームを保持するバッファ。
+		struct alignas(4096) FrameBatch final
+		{
+			std::array<CDFSFrame, BatchSize> frames;
+		};
+		///	書き込み中ではないチャンネルの保留しているデータ。
+		struct ChannelState final
+		{
+			ContainsType pending;
+			size_t pendingsize;
+			std::vector<uint8_t> block;
+			size_t blocksize;
+		};
+
 		std::string label;
 		UInt128 frameindex;
 		UInt128 datasize;
 		bool wrotehead;
 		bool wrotefinf;
+		///	書き込み待ちのデータフレーム。
+		std::unique_ptr<FrameBatch> batch;
+		///	書き込み待ちのデータフレーム数。
+		size_t batchcount;
+		///	データフレームに満たないため保留しているデータ。
+		ContainsType pending;
+		///	保留しているデータの大きさ。
+		size_t pendingsize;
+		///	書き込まれたデータのハッシュ値。
+		XXH3 hash;
+		///	終了フレームに格納するハッシュ値の種類。
+		CDFSHashTypes hashtype;
+		///	書き込まれたフレームの索引。
+		std::optional<CDFSIndex> index;
+		///	ストリーミングプロファイルで書き込むか。
+		bool streaming;
+		///	データの圧縮レベル。(0 の場合は圧縮しない)
+		uint32_t compression;
+		///	ブロックに満たないため圧縮を保留しているデータ。
+		std::vector<uint8_t> block;
+		///	圧縮を保留しているデータの大きさ。
+		size_t blocksize;
+		///	圧縮したブロックの構築先。
+		std::vector<uint8_t> encoded;
+		///	データを書き込むチャンネル。
+		uint32_t channel;
+		///	チャンネル切り替えフレームを書き込まずにフレームを続けて書き込めるチャンネル。
+		///	@details
+		///	最後に書き込んだデータフレーム・圧縮フレームのチャンネルです。大きさを示したデータフレームや継続フレームの後は @a std::nullopt となります。
+		std::optional<uint32_t> openchannel;
+		///	複数のチャンネルを多重化して書き込んでいるか。
+		///	@details
+		///	多重化している場合、データの書き込み順とフレームの順序が一致しないため、ハッシュ値はフレームの構築時に計算します。
+		bool multiplexed;
+		///	圧縮フレーム・メタデータフレームを書き込んだか。
+		bool extended;
+		///	開始フレームより後のフレームが、最後を除いて240バイトを満たすデータフレームのみであるか。
+		///	@details
+		///	継続フレームを書き込んだ場合や、240バイトを満たさないデータフレームの後にデータフレームを書き込んだ場合は @a false となります。(圧縮フレーム・メタデータフレームは @a extended で判断します)
+		bool dense;
+		///	チャンネルごとの保留しているデータ。(現在のチャンネルのデータは @a pending / @a block が保持します)
+		std::map<uint32_t, ChannelState> channels;
+#if defined(CDFS_ENABLE_COUNTERS)
+		///	処理量と処理時間の計数。
+		CDFSCounters counters = CDFSCounters();
+		///	計数を受け取る関数。
+		CDFSCounterCallback countercallback;
+#endif
+
+		///	データフレームを構築し、書き込み待ちのバッファに追加します。
+		void PushDATAFrame(std::ostream& stream, const uint8_t* data, const size_t& size);
+		///	保留しているデータをデータフレームとして書き込み待ちのバッファに追加します。
+		void PushPending(std::ostream& stream);
+		///	圧縮を保留しているデータを圧縮し、圧縮フレームとして書き込み待ちのバッファに追加します。
+		void PushBlock(std::ostream& stream);
+		///	チャンネル切り替えフレームを構築し、書き込み待ちのバッファに追加します。
+		///	@param	length	直後のデータフレームに格納するデータの大きさ。(240バイトすべてを埋める場合は 0 )
+		void PushCHANFrame(std::ostream& stream, const uint32_t& length);
+		///	すべてのチャンネルの保留しているデータを書き込み待ちのバッファに追加します。
+		///	@param	pending	データフレームを満たさないため保留しているデータも書き込むか。
+		void PushChannels(std::ostream& stream, const bool& pending);
+		///	書き込み待ちのデータフレームをまとめてストリームに書き込みます。
+		void FlushBatch(std::ostream& stream);
+		///	フレームをストリームに書き込み、索引に追加します。
+		void WriteFrame(std::ostream& stream, const CDFSFrame& frame);
+		///	これまでに書き込んだフレームに必要な最も小さいフォーマットバージョンを取得します。
+		///	@details
+		///	ストリーミングプロファイルでは開始フレームを書き直さないため、以降に書き込むフレームに備えて @a CDFS::FormatVersion を返します。
+		uint32_t RequiredVersion() const noexcept;
+#if defined(CDFS_ENABLE_COUNTERS)
+		///	計数を受け取る関数が設定されている場合は、現在の計数を渡します。
+		void Report() const;
+#endif
 	public:
 		///	既定の設定で @a CDFSBuilder を初期化します。
 		CDFSBuilder();
@@ -31,7 +127,70 @@ namespace zawa_ch::CDFS
 		const UInt128& FrameIndex() const;
 		///	これまでに書き込まれたCDFSデータの総サイズを取得します。
 		const UInt128& DataSize() const;
+		///	終了フレームが書き込まれていない既存のCDFSデータの末尾から書き込みを再開します。
+		///	@details
+		///	開始フレームと末尾のフレームのみを検証し、書き込まれているフレーム数とデータサイズを復元します。
+		///	データサイズは、最後の有効なフレームからデータサイズが記録された継続フレーム(または開始フレーム)までを遡って求めます。
+		///	長時間書き込みを続ける場合は定期的に @a WriteCONTFrame を呼び出すことで再開にかかる時間を抑えられます。
+		///	書き込み途中で中断された末尾のフレームは破棄され、以降の書き込みで上書きされます。
+		///	ストリームの大きさは変更されないため、破棄されたフレームが書き込みで上書きされない場合は呼び出し元でファイルを切り詰めてください。
+		///	@param	stream	既存のCDFSデータを保持する、読み込みと書き込みが可能なシーク可能なストリーム。
+		///	@param	rehash
+		///	@a true の場合、書き込み済みのデータを先頭から読み直してハッシュ値の計算を引き継ぎます。
+		///	@a false の場合は開始フレームをハッシュ値を持たないものとして書き直し、終了フレームにハッシュ値を格納しません。
+		///	@return	再開に成功した場合は @a true 。開始フレームが無効な場合や終了フレームが書き込まれている場合は @a false 。
+		///	@note
+		///	構築中の索引は破棄されます。ラベルは開始フレームに記録されたものに置き換えられます。
+		///	遡ったフレームにチャンネル切り替えフレームが含まれていた場合は多重化を続け、チャンネル 0 から書き込みを再開します。
+		///	遡らなかったフレームは読み込まないため、開始フレームのバージョンが @a CDFS::BaseFormatVersion より大きい場合は拡張を使用しているものとしてバージョンを記録します。
+		bool Resume(std::iostream& stream, const bool& rehash = false);
+		///	書き込むフレームの索引の構築を開始します。
+		///	@details
+		///	以降に書き込まれたフレームが索引に追加されます。開始フレームの書き込み前に呼び出してください。
+		///	終了フレームの書き込み後(開始フレームを書き直す場合はその後)に @a GetIndex で取得し、 @a CDFSIndex::Write で索引ファイルに書き込みます。
+		///	@param	interval	チェックポイントの間隔。(フレーム数)
+		void EnableIndex(const size_t& interval = CDFSIndex::DefaultInterval);
+		///	構築した索引を取得します。
+		///	@return	@a EnableIndex を呼び出していない場合は @a std::nullopt 。
+		const std::optional<CDFSIndex>& GetIndex() const noexcept;
+		///	ストリーミングプロファイルでの書き込みを有効にします。
+		///	@details
+		///	パイプやソケットなどのシークできないストリームに書き込む場合に使用します。
+		///	開始フレームにはフレーム数・総サイズを記録せず(0として書き込み)、読み込み側は終了フレームからそれらを取得します。
+		///	このため、終了フレームの書き込み後に開始フレームを書き直す必要はありません。
+		///	読み込み側は @a CDFSLoader::EnableStreaming を使用することで、終了フレームを待たずにデータを受け取れます。
+		///	データを読み込み側に届けたい時点で @a Flush を呼び出してください。
+		void EnableStreaming();
+		///	ストリーミングプロファイルで書き込むかを取得します。
+		bool IsStreaming() const noexcept;
+		///	@a Write で書き込むデータの圧縮レベルを設定します。
+		///	@details
+		///	圧縮を有効にすると、データを @a CDFSCompression::BlockSize ごとのブロックに圧縮して圧縮フレームとして書き込みます。
+		///	ブロックに満たない残りのデータは次の書き込みまで保留され、 @a Flush または終了フレームの書き込み時にブロックとして書き込まれます。
+		///	@param	level	圧縮レベル。 0 の場合は圧縮しません。(既定) @a CDFSCompression::MaxLevel より大きい値は @a CDFSCompression::MaxLevel として扱います。
+		void SetCompression(const uint32_t& level);
+		///	@a Write で書き込むデータの圧縮レベルを取得します。
+		uint32_t Compression() const noexcept;
+		///	@a Write で書き込むデータのチャンネルを切り替えます。
+		///	@details
+		///	チャンネルを使用すると、複数の論理的なデータ列を1つのCDFSデータに多重化して書き込めます。
+		///	フレームを書き込む際に直前に書き込んだフレームとチャンネルが異なる場合は、チャンネル切り替えのメタデータフレームを書き込みます。
+		///	データフレームを満たさないデータや圧縮を保留しているデータはチャンネルごとに保留されるため、
+		///	少量ずつ交互に書き込んでもデータフレームは満たされたまま @a BatchSize フレームごとにまとめて書き込まれます。
+		///	チャンネルごとの最後のデータフレームは、終了フレームの書き込み時にその大きさを示すチャンネル切り替えフレームとともに書き込まれます。
+		///	開始フレームの直後のチャンネルは 0 です。チャンネルを切り替えない場合はメタデータフレームを書き込みません。
+		///	読み込み側は @a CDFSLoader::Demultiplex でチャンネルごとにデータを受け取れます。
+		///	@note
+		///	多重化を開始した時点でデータフレームを満たさないため保留しているデータは、その大きさを示して書き込まれます。
+		void SelectChannel(std::ostream& stream, const uint32_t& channel);
+		///	@a Write で書き込むデータのチャンネルを取得します。
+		uint32_t Channel() const noexcept;
 		///	指定されたストリームに開始フレームを書き込みます。
+		///	@note
+		///	ストリーミングプロファイルではフレーム数・総サイズを0として書き込みます。
+		///	データの内容の @a XXH3 ハッシュ値を書き込み中に計算し、終了フレームに格納します。
+		///	最初の書き込みでは @a CDFS::FormatVersion を、書き直す場合はそれまでに書き込んだフレームに必要な最も小さいバージョンを記録します。
+		///	終了フレームの書き込み後に書き直す場合、データフレームのみで構成されていれば @a CDFSHEADFrame::DenseFlag を記録します。(読み込み側はデータの位置から直接フレームの位置を求められます)
 		void WriteHEADFrame(std::ostream& stream);
 		///	指定されたストリームに開始フレームを書き込みます。
 		void WriteHEADFrame(std::ostream& stream, const UInt128& framecount, const UInt128& datasize);
@@ -41,6 +200,58 @@ namespace zawa_ch::CDFS
 		void WriteDATAFrame(std::ostream& stream, const ContainsType& data, const size_t& size = 240U);
 		///	指定されたストリームに継続フレームを書き込みます。
 		void WriteCONTFrame(std::ostream& stream);
+		///	指定されたデータをデータフレームに分割して書き込みます。
+		///	@details
+		///	データはデータフレームに詰めて構築され、 @a BatchSize フレームごとにまとめてストリームに書き込まれます。
+		///	データフレームを満たさない残りのデータは次の書き込みまで保留され、終了フレームの書き込み時に最後のデータフレームとして書き込まれます。
+		///	圧縮が有効な場合は圧縮フレームとして書き込みます。( @a SetCompression を参照)
+		///	@a size が 0 の場合は何も書き込みません。(この場合 @a data は @a nullptr でも構いません)
+		void Write(std::ostream& stream, const void* data, const size_t& size);
+		///	指定されたチャンネルに切り替えて、指定されたデータを書き込みます。
+		///	@details
+		///	@a SelectChannel と @a Write を続けて呼び出すことと同じです。
+		void Write(std::ostream& stream, const uint32_t& channel, const void* data, const size_t& size);
+		///	書き込み待ちのデータフレームをストリームに書き込み、ストリームをフラッシュします。
+		///	@note
+		///	データフレームを満たさないため保留しているデータは書き込まれません。
+		///	圧縮を保留しているデータは、ブロックに満たなくてもブロックとして書き込まれます。(多重化している場合はすべてのチャンネルのものを書き込みます)
+		void Flush(std::ostream& stream);
+#if defined(CDFS_ENABLE_COUNTERS)
+		///	これまでに構築したフレーム(書き込み待ちのものを含む)の処理量と処理時間の計数を取得します。
+		///	@details
+		///	チェックサムの計算時間は @a BatchSize フレームごとにまとめて計算したものと、 @a WriteDATAFrame で計算したものです。(開始フレームなど個別に構築するフレームのものは含みません)
+		///	ストリームの読み書きの時間はフレームの書き込みにかかった時間です。 @a Flush でのストリームのフラッシュも含みます。
+		///	@a Resume で読み込んだフレームは数えません。
+		CDFSCounters Counters() const noexcept;
+		///	計数を 0 に戻します。
+		void ResetCounters() noexcept;
+		///	計数を受け取る関数を設定します。
+		///	@details
+		///	ストリームにフレームを書き込むたびに( @a BatchSize フレームごと、または個別に書き込むフレームごとに)呼び出されます。
+		///	空の関数を設定すると呼び出されなくなります。
+		void SetCounterCallback(const CDFSCounterCallback& callback);
+#endif
+
+		///	開始フレームを構築します。
+		///	@param	hashtype	終了フレームに格納するハッシュ値の種類。
+		///	@param	version	開始フレームに記録するフォーマットバージョン。
+		///	@param	flags	開始フレームに記録するCDFSデータの構成を示すフラグ。( @a CDFSHEADFrame::DenseFlag など)
+		static CDFSHEADFrame BuildHEADFrame(const std::string& label, const UInt128& framecount, const UInt128& datasize, const CDFSHashTypes& hashtype = CDFSHashTypes::None, const uint32_t& version = CDFS::FormatVersion, const uint32_t& flags = 0U);
+		///	終了フレームを構築します。
+		///	@param	frameindex	終了フレームのシーケンス番号。
+		static CDFSFINFFrame BuildFINFFrame(const UInt128& frameindex, const UInt128& datasize);
+		///	ハッシュ値を格納した終了フレームを構築します。
+		///	@param	frameindex	終了フレームのシーケンス番号。
+		///	@param	hash	データの内容の @a XXH3 ハッシュ値。
+		static CDFSFINFFrame BuildFINFFrame(const UInt128& frameindex, const UInt128& datasize, const XXH3::ValueType& hash);
+		///	継続フレームを構築します。
+		///	@param	frameindex	継続フレームのシーケンス番号。
+		///	@param	datasize	継続フレームより前に書き込まれたデータの総サイズ。
+		static CDFSCONTFrame BuildCONTFrame(const UInt128& frameindex, const std::string& label, const UInt128& datasize = UInt128(0U));
+		///	チャンネル切り替えのメタデータフレームを構築します。
+		///	@param	frameindex	メタデータフレームのシーケンス番号。
+		///	@param	length	直後のデータフレームに格納するデータの大きさ。(240バイトすべてを埋める場合は 0 )
+		static CDFSMETAFrame BuildCHANFrame(const UInt128& frameindex, const uint32_t& channel, const uint32_t& length = 0U);
 
 		/// 指定されたストリームに指定されたCDFSフレームを書き込みます。
 		static void WriteToStream(std::ostream& stream, const CDFSFrame& frame);
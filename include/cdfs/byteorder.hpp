@@ -0,0 +1,42 @@
+//	cdfs/byteorder
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_byteorder__
+#define __cdfs_byteorder__
+#include <cstddef>
+#include <optional>
+#include "datatype.hpp"
+#include "framelayout.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSフレームのバイト順序の判定と変換を行います。
+	///	@details
+	///	CDFSデータは書き込んだ環境のバイト順序で記録されるため、読み込む際は開始フレームのフレームの種類からバイト順序を判定します。
+	///	実行環境と異なるバイト順序のフレームは、読み込んだフレーム列に対してまとめて変換します。
+	///	(フィールドごとに変換しながら参照する場合は @a CDFSBasicRawFrameView などのビューをバイト順序を指定して使用します)
+	class CDFSByteOrderConverter final
+	{
+		CDFSByteOrderConverter() = delete;
+		~CDFSByteOrderConverter() = delete;
+
+		///	実行環境と異なるバイト順序で書き込まれたフレームを実行環境のバイト順序に変換します。
+		static void Swap(CDFSFrame* frames, const size_t& count) noexcept;
+	public:
+		///	実行環境と異なるバイト順序。
+		static constexpr CDFSByteOrder Foreign = (CDFSByteOrder::Native == CDFSByteOrder::Little)?CDFSByteOrder::Big:CDFSByteOrder::Little;
+
+		///	開始フレームのフレームの種類から、CDFSデータのバイト順序を判定します。
+		///	@return	いずれのバイト順序でも開始フレームではない場合は @a std::nullopt 。
+		static std::optional<CDFSByteOrder> Detect(const CDFSFrame& frame) noexcept;
+		///	指定されたバイト順序で書き込まれたフレームを、実行環境のバイト順序に変換します。
+		///	@details
+		///	シーケンス番号・フレームの種類・チェックサムと、フレームの種類ごとの数値のフィールドを変換します。データフレームの内容などのバイト列は変換しません。
+		///	チェックサムはフィールドを変換したフレームに合わせて補正するため、変換前に有効であったフレームのみが変換後も有効となります。
+		///	@a order が実行環境のバイト順序である場合は何もしません。
+		static void ToNative(CDFSFrame* frames, const size_t& count, const CDFSByteOrder& order) noexcept
+		{
+			if (order != CDFSByteOrder::Native) { Swap(frames, count); }
+		}
+	};
+}
+#endif // __cdfs_byteorder__
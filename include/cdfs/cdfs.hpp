@@ -5,6 +5,8 @@
 #define __cdfs_cdfs__
 #include "datatype.hpp"
 #include "checksum.hpp"
+#include "frameview.hpp"
+#include "byteorder.hpp"
 namespace zawa_ch::CDFS
 {
 	///	CDFSライブラリの情報を提供します。
@@ -14,7 +16,9 @@ namespace zawa_ch::CDFS
 		~CDFS() = delete;
 	public:
 		///	対応しているCDFSのバージョン。
-		static constexpr uint32_t FormatVersion = 0x00000100;
+		static constexpr uint32_t FormatVersion = 0x00000200;
+		///	圧縮フレーム・メタデータフレーム・ハッシュの種類を使用しないCDFSデータのバージョン。
+		static constexpr uint32_t BaseFormatVersion = 0x00000100;
 		///	CDFSライブラリのバージョンを取得します。
 		static uint32_t GetLibraryVersion() noexcept;
 	};
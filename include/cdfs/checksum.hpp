@@ -3,13 +3,24 @@
 //
 #ifndef __cdfs_checksum__
 #define __cdfs_checksum__
+#include <cstddef>
 #include <cstdint>
 #include <array>
+#include <initializer_list>
 namespace zawa_ch::CDFS
 {
 	///	CRC32チェックサムの計算を行います。
 	class CRC32
 	{
+	public:
+		///	CRC32の計算に使用する実装の種類。
+		enum class Implementations
+		{
+			///	テーブル参照(スライシング)による実装。
+			Table,
+			///	キャリーレス乗算(PCLMULQDQ)による畳み込みを用いる実装。
+			CLMUL,
+		};
 	private:
 		///	@a CRC32 の計算用のデータセットです。
 		struct Dataset final
@@ -17,6 +28,16 @@ namespace zawa_ch::CDFS
 		public:
 			///	CRC32 テーブル。
 			std::array<uint32_t, 256> table;
+			///	スライシング計算用のCRC32 テーブル。
+			///	@details
+			///	@a slice[n][i] はバイト値 @a i の後に @a n バイトの0が続く場合の剰余を表します。
+			///	@a slice[0] は @a table と同じ内容です。
+			std::array<std::array<uint32_t, 256>, 16> slice;
+			///	結合計算用の多項式 x^(2^n) mod P 。
+			std::array<uint32_t, 32> power;
+			///	ブロック計算に使用する実装。
+			///	データセットの初期化時に実行環境のCPUを確認して決定します。
+			Implementations implementation;
 			///	データセットの初期化を行います。
 			Dataset();
 		};
@@ -26,6 +47,20 @@ namespace zawa_ch::CDFS
 		///	ハッシュ計算値。
 		uint32_t curr;
 
+		///	スライシング(16バイト単位)によりデータをハッシュの一部に追加します。
+		static const uint8_t* PushSlice16(uint32_t& crc, const uint8_t* begin, const uint8_t* end) noexcept;
+		///	スライシング(8バイト単位)によりデータをハッシュの一部に追加します。
+		static const uint8_t* PushSlice8(uint32_t& crc, const uint8_t* begin, const uint8_t* end) noexcept;
+		///	キャリーレス乗算による畳み込みでデータをハッシュの一部に追加します。
+		static const uint8_t* PushCLMUL(uint32_t& crc, const uint8_t* begin, const uint8_t* end) noexcept;
+		///	GF(2)上の多項式として a * b mod P を計算します。
+		static uint32_t MultiplyModP(uint32_t a, uint32_t b) noexcept;
+		///	GF(2)上の多項式として x^(8 * length) mod P を計算します。
+		static uint32_t PowerModP(uint64_t length) noexcept;
+		///	キャリーレス乗算による畳み込みで4つのデータを並行してハッシュの一部に追加します。
+		///	@return	処理したバイト数。
+		static size_t PushCLMULx4(uint32_t* crc, const uint8_t* const* begins, const size_t& length) noexcept;
+
 	public:
 		///	既定の設定でこのオブジェクトを初期化します。
 		CRC32() noexcept;
@@ -38,11 +73,97 @@ namespace zawa_ch::CDFS
 		void Push(const std::initializer_list<uint8_t>& list) noexcept;
 		///	指定されたデータをハッシュの一部に追加します。
 		void Push(const uint8_t* begin, const uint8_t* end) noexcept;
+		///	実装を指定して、指定されたデータをハッシュの一部に追加します。
+		///	@note
+		///	実行環境で使用できない実装が指定された場合はテーブル参照による実装を使用します。
+		void Push(const uint8_t* begin, const uint8_t* end, const Implementations& implementation) noexcept;
 		///	指定されたデータをハッシュの一部に追加します。
 		template<size_t length>
-		void Push(const std::array<uint8_t, length>& array) noexcept { for(const auto& item: array) { Push(item); } }
+		void Push(const std::array<uint8_t, length>& array) noexcept { Push(array.data(), array.data() + length); }
 		///	計算されたダイジェスト値を取得します。
 		uint32_t GetValue() const noexcept;
+
+		///	同じ長さの複数のデータのダイジェスト値をまとめて計算します。
+		///	@details
+		///	互いに独立したデータの計算を交互に進めることで、1つずつ計算するよりも高速に処理します。
+		///	@param	begins	各データの先頭。
+		///	@param	length	各データの長さ。
+		///	@param	results	各データのダイジェスト値の書き込み先。
+		///	@param	count	データの数。
+		static void Calculate(const uint8_t* const* begins, const size_t& length, uint32_t* results, const size_t& count) noexcept;
+		///	連続する2つのデータのダイジェスト値から、それらを連結したデータのダイジェスト値を計算します。
+		///	@details
+		///	データを読み直すことなく、別々に(別々のスレッドで)計算したダイジェスト値を結合できます。
+		///	計算量は @a lengthB の桁数に比例します。
+		///	@param	crcA	前半のデータのダイジェスト値。
+		///	@param	crcB	後半のデータのダイジェスト値。
+		///	@param	lengthB	後半のデータの長さ。
+		static uint32_t Combine(const uint32_t& crcA, const uint32_t& crcB, const uint64_t& lengthB) noexcept;
+		///	連続する複数のデータのダイジェスト値から、それらを連結したデータのダイジェスト値を計算します。
+		///	@param	crcs	各データのダイジェスト値。(先頭から順に)
+		///	@param	lengths	各データの長さ。
+		///	@param	count	データの数。 0 の場合は空のデータのダイジェスト値 0 を返します。
+		static uint32_t Combine(const uint32_t* crcs, const uint64_t* lengths, const size_t& count) noexcept;
+		///	ブロック計算に使用されている実装を取得します。
+		static Implementations ActiveImplementation() noexcept;
+		///	指定された実装が実行環境で使用できるかを取得します。
+		static bool IsSupported(const Implementations& implementation) noexcept;
+	};
+
+	///	XXH3 (128ビット)ハッシュの計算を行います。
+	///	@details
+	///	データは少しずつ追加でき、一度に追加した場合と同じダイジェスト値が得られます。
+	class XXH3
+	{
+	public:
+		///	ダイジェスト値の型。(XXH128の正規形式と同じビッグエンディアンで格納されます)
+		typedef std::array<uint8_t, 16> ValueType;
+		///	一度に処理するデータの大きさ。
+		static constexpr size_t StripeSize = 64;
+		///	鍵の大きさ。
+		static constexpr size_t SecretSize = 192;
+		///	短いデータとして扱われる最大の大きさ。
+		static constexpr size_t ShortLength = 240;
+	private:
+		///	既定の鍵。
+		static const std::array<uint8_t, SecretSize> DefaultSecret;
+
+		///	累積値。
+		alignas(16) std::array<uint64_t, 8> acc;
+		///	シード値から導出した鍵。
+		std::array<uint8_t, SecretSize> secret;
+		///	データの先頭部分。(短いデータのハッシュ値の計算に使用します)
+		std::array<uint8_t, ShortLength> head;
+		///	処理を保留しているデータ。
+		std::array<uint8_t, StripeSize> buffer;
+		///	最後に処理したストライプ。
+		std::array<uint8_t, StripeSize> last;
+		///	処理を保留しているデータの大きさ。
+		size_t buffersize;
+		///	現在のブロック内で処理したストライプ数。
+		size_t stripes;
+		///	シード値。
+		uint64_t seed;
+		///	追加されたデータの総サイズ。
+		uint64_t length;
+
+		///	ストライプをまとめて累積値に追加します。
+		void ConsumeStripes(const uint8_t* begin, const size_t& count) noexcept;
+		///	短いデータのダイジェスト値を計算します。
+		ValueType GetShortValue() const noexcept;
+	public:
+		///	シード値を指定してこのオブジェクトを初期化します。
+		XXH3(const uint64_t& seed = 0U) noexcept;
+
+		///	指定されたデータをハッシュの一部に追加します。
+		void Push(const uint8_t& value) noexcept;
+		///	指定されたデータをハッシュの一部に追加します。
+		void Push(const uint8_t* begin, const uint8_t* end) noexcept;
+		///	指定されたデータをハッシュの一部に追加します。
+		template<size_t length>
+		void Push(const std::array<uint8_t, length>& array) noexcept { Push(array.data(), array.data() + length); }
+		///	計算されたダイジェスト値を取得します。
+		ValueType GetValue() const noexcept;
 	};
 }
-#endif // __cdfs_checksum__
\ No newline at end of file
+#endif // __cdfs_checksum__
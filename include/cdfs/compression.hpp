@@ -0,0 +1,79 @@
+//	cdfs/compression
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_compression__
+#define __cdfs_compression__
+#include <optional>
+#include <iostream>
+#include "cdfs.hpp"
+#include "span.hpp"
+namespace zawa_ch::CDFS
+{
+	///	圧縮フレームに格納するブロックの圧縮・展開を行います。
+	///	@details
+	///	ブロックは先頭の @a HeaderSize バイトのヘッダーと、それに続く圧縮したデータで構成されます。
+	///	ヘッダーには圧縮方式(uint16)・予約領域(uint16)・展開後の大きさ(uint32)・圧縮したデータの大きさ(uint32)を格納します。
+	///	圧縮したデータはLZ4のブロック形式と互換性があります。
+	///	圧縮によって大きさが小さくならない場合は、データをそのまま格納します。
+	class CDFSCompression final
+	{
+		CDFSCompression() = delete;
+		~CDFSCompression() = delete;
+	public:
+		///	ブロックの圧縮方式。
+		enum class Codecs : uint16_t
+		{
+			///	圧縮せずに格納する。
+			Stored = 0,
+			///	LZ4のブロック形式で圧縮する。
+			LZ4 = 1,
+		};
+		///	1ブロックに格納できるデータの最大の大きさ。
+		static constexpr size_t BlockSize = 65536;
+		///	ブロックのヘッダーの大きさ。
+		static constexpr size_t HeaderSize = 12;
+		///	ブロックの最大の大きさ。(ヘッダーを含む)
+		static constexpr size_t MaxEncodedSize = HeaderSize + BlockSize;
+		///	圧縮レベルの最大値。
+		static constexpr uint32_t MaxLevel = 9;
+
+		///	指定された大きさのデータを圧縮した結果の最大の大きさを取得します。
+		static constexpr size_t Bound(const size_t& size) noexcept { return size + (size / 255U) + 16U; }
+		///	データをLZ4のブロック形式で圧縮します。
+		///	@param	level	圧縮レベル。(1 から @a MaxLevel ) 大きいほど一致する箇所を多く探索し、圧縮率が高くなる代わりに低速になります。
+		///	@return	圧縮したデータの大きさ。 @a capacity に収まらなかった場合は 0 。
+		static size_t Compress(const uint8_t* source, const size_t& size, uint8_t* destination, const size_t& capacity, const uint32_t& level = 1U) noexcept;
+		///	LZ4のブロック形式で圧縮されたデータを展開します。
+		///	@param	rawsize	展開後の大きさ。
+		///	@return	展開後の大きさが @a rawsize と一致し、不正なデータを含まない場合は @a true 。
+		static bool Decompress(const uint8_t* source, const size_t& size, uint8_t* destination, const size_t& rawsize) noexcept;
+
+		///	データを圧縮してブロックを構築します。
+		///	@param	size	データの大きさ。 @a BlockSize 以下である必要があります。
+		///	@param	destination	ブロックの書き込み先。 @a MaxEncodedSize バイト以上の領域が必要です。
+		///	@return	ブロックの大きさ。
+		static size_t EncodeBlock(const uint8_t* data, const size_t& size, uint8_t* destination, const uint32_t& level = 1U) noexcept;
+		///	ブロックに記録されたブロックの大きさを取得します。
+		///	@return	ヘッダーが不正な場合は @a std::nullopt 。
+		static std::optional<size_t> EncodedSize(const uint8_t* block, const size_t& size) noexcept;
+		///	ブロックに記録された展開後の大きさを取得します。
+		///	@return	ヘッダーが不正な場合(展開後の大きさが 0 の場合を含む)は @a std::nullopt 。
+		static std::optional<size_t> DecodedSize(const uint8_t* block, const size_t& size) noexcept;
+		///	ブロックを展開します。
+		///	@param	destination	展開したデータの書き込み先。 @a BlockSize バイト以上の領域が必要です。
+		///	@return	展開したデータの大きさ。ブロックが不正な場合は @a std::nullopt 。
+		static std::optional<size_t> DecodeBlock(const uint8_t* block, const size_t& size, uint8_t* destination) noexcept;
+		///	指定された大きさのブロックを格納するのに必要な圧縮フレーム数を取得します。
+		static constexpr size_t FrameCount(const size_t& size) noexcept { return (size + CDFSCMPRFrame::ContentSize - 1U) / CDFSCMPRFrame::ContentSize; }
+
+		///	フレーム列に含まれるデータを先頭から順にストリームに書き込みます。
+		///	@details
+		///	圧縮フレームのブロックは複数のスレッドで並行して展開し、データフレームの内容とともにシーケンス順に書き込みます。
+		///	フレーム列の最後が終了フレームの場合、最後のデータフレームは総サイズに合わせて切り詰めます。
+		///	フレームのチェックサム・シーケンス番号は検証しません。
+		///	@param	threads	展開に使用するスレッド数。 0 の場合は実行環境のスレッド数を使用します。
+		///	@return	すべてのブロックの展開に成功した場合は @a true 。
+		static bool Extract(const Span<const CDFSFrame>& frames, std::ostream& stream, const size_t& threads = 0U);
+	};
+}
+#endif // __cdfs_compression__
@@ -0,0 +1,93 @@
+//	cdfs/counters
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_counters__
+#define __cdfs_counters__
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include "datatype.hpp"
+namespace zawa_ch::CDFS
+{
+	///	フレームの種類ごとの処理量。
+	struct CDFSFrameCounter final
+	{
+		///	処理したフレームの数。
+		uint64_t frames;
+		///	処理したフレームが格納しているデータの大きさの合計。
+		///	@details
+		///	データフレームは格納しているデータの大きさ、圧縮フレームはブロックの大きさ(展開後の大きさで、ブロックごとに1回数えます)です。
+		///	その他のフレームは 0 です。
+		uint64_t bytes;
+	};
+
+	///	@a CDFSBuilder / @a CDFSLoader の処理量と処理時間の計数。
+	///	@details
+	///	CMakeのオプション CDFS_ENABLE_COUNTERS を有効にしてビルドした場合のみ、 @a CDFSBuilder::Counters / @a CDFSLoader::Counters で取得できます。
+	///	無効の場合(既定)は計数のためのメンバや処理はビルドに含まれません。
+	///	処理時間は @a std::chrono::steady_clock で計測するため、有効にした場合は計測のたびにその読み出しの時間がかかります。
+	struct CDFSCounters final
+	{
+		///	開始フレーム。
+		CDFSFrameCounter head;
+		///	終了フレーム。
+		CDFSFrameCounter finf;
+		///	データフレーム。
+		CDFSFrameCounter data;
+		///	継続フレーム。
+		CDFSFrameCounter cont;
+		///	メタデータフレーム。
+		CDFSFrameCounter meta;
+		///	圧縮フレーム。
+		CDFSFrameCounter cmpr;
+		///	フレームの種類が不明なフレーム。
+		CDFSFrameCounter other;
+		///	チェックサムの計算・検証にかかった時間。
+		std::chrono::nanoseconds crctime;
+		///	ストリームの読み書きにかかった時間。
+		std::chrono::nanoseconds iotime;
+		///	チェックサムの検証に失敗したフレームの数。
+		uint64_t validationfailures;
+		///	チェックサムは正しいが、シーケンス番号が読み込み位置と一致しなかったフレームの数。
+		uint64_t sequencemismatches;
+
+		///	指定されたフレームの種類の処理量を取得します。
+		[[nodiscard]] CDFSFrameCounter& Of(const CDFSFrameTypes& type) noexcept
+		{
+			switch (type)
+			{
+			case CDFSFrameTypes::HEAD: { return head; }
+			case CDFSFrameTypes::FINF: { return finf; }
+			case CDFSFrameTypes::DATA: { return data; }
+			case CDFSFrameTypes::CONT: { return cont; }
+			case CDFSFrameTypes::META: { return meta; }
+			case CDFSFrameTypes::CMPR: { return cmpr; }
+			default: { return other; }
+			}
+		}
+		///	指定されたフレームの種類の処理量を取得します。
+		[[nodiscard]] const CDFSFrameCounter& Of(const CDFSFrameTypes& type) const noexcept { return const_cast<CDFSCounters&>(*this).Of(type); }
+		///	すべての種類のフレームの数の合計を取得します。
+		[[nodiscard]] uint64_t Frames() const noexcept { return head.frames + finf.frames + data.frames + cont.frames + meta.frames + cmpr.frames + other.frames; }
+		///	すべての種類のフレームが格納しているデータの大きさの合計を取得します。
+		[[nodiscard]] uint64_t Bytes() const noexcept { return data.bytes + cmpr.bytes; }
+	};
+	///	計数を受け取る関数。
+	///	@details
+	///	呼び出し時点の計数を受け取ります。参照は呼び出しから戻った後は使用できません。
+	typedef std::function<void(const CDFSCounters&)> CDFSCounterCallback;
+
+	///	生成からスコープを抜けるまでの経過時間を指定された計数に加算します。
+	class CDFSCounterTimer final
+	{
+	private:
+		std::chrono::nanoseconds& target;
+		std::chrono::steady_clock::time_point begin;
+	public:
+		explicit CDFSCounterTimer(std::chrono::nanoseconds& target) noexcept : target(target), begin(std::chrono::steady_clock::now()) {}
+		CDFSCounterTimer(const CDFSCounterTimer&) = delete;
+		CDFSCounterTimer& operator=(const CDFSCounterTimer&) = delete;
+		~CDFSCounterTimer() { target += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin); }
+	};
+}
+#endif // __cdfs_counters__
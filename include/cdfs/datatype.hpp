@@ -3,9 +3,17 @@
 //
 #ifndef __cdfs_datatype__
 #define __cdfs_datatype__
+#include <cstdint>
 #include <limits>
 #include <array>
 #include "checksum.hpp"
+#include "framelayout.hpp"
+#include "span.hpp"
+// コンパイラが128ビット整数型をサポートしている場合は UInt128 の演算に使用する
+// (CDFS_NO_NATIVE_UINT128 を定義すると移植性のある実装を使用します)
+#if defined(__SIZEOF_INT128__) && (UINTMAX_MAX == UINT64_MAX) && !defined(CDFS_NO_NATIVE_UINT128)
+#define CDFS_NATIVE_UINT128 1
+#endif
 namespace zawa_ch::CDFS
 {
 	///	128ビットの符号なし整数を表します。
@@ -19,6 +27,14 @@ namespace zawa_ch::CDFS
 		value_type _data;
 		///	内部表現型から @a UInt128 のオブジェクトを作成します。
 		constexpr explicit UInt128(const value_type& data) : _data(data) {}
+#ifdef CDFS_NATIVE_UINT128
+		///	ネイティブの128ビット符号なし整数型。
+		typedef unsigned __int128 native_type;
+		///	ネイティブの128ビット整数型に変換します。
+		[[nodiscard]] constexpr native_type ToNative() const noexcept { return (native_type(_data[1]) << 64) | native_type(_data[0]); }
+		///	ネイティブの128ビット整数型から @a UInt128 のオブジェクトを作成します。
+		[[nodiscard]] static constexpr UInt128 FromNative(const native_type& value) noexcept { return UInt128(value_type{ uint_value(value), uint_value(value >> 64) }); }
+#endif
 	public:
 		///	空の @a UInt128 のオブジェクトを作成します。
 		constexpr UInt128() noexcept : _data() {}
@@ -29,6 +45,9 @@ namespace zawa_ch::CDFS
 		[[nodiscard]] constexpr UInt128 operator-() const noexcept { return ~*this; }
 		[[nodiscard]] constexpr UInt128 operator+(const UInt128& other) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			return FromNative(ToNative() + other.ToNative());
+#else
 			bool c = false;
 			UInt128 result;
 			for (size_t i = 0; i < _data.size(); i++)
@@ -38,9 +57,13 @@ namespace zawa_ch::CDFS
 				result._data[i] += other._data[i];
 			}
 			return result;
+#endif
 		}
 		[[nodiscard]] constexpr UInt128 operator-(const UInt128& other) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			return FromNative(ToNative() - other.ToNative());
+#else
 			bool b = false;
 			UInt128 result;
 			for (size_t i = 0; i < _data.size(); i++)
@@ -50,9 +73,13 @@ namespace zawa_ch::CDFS
 				result._data[i] -= other._data[i];
 			}
 			return result;
+#endif
 		}
 		[[nodiscard]] constexpr UInt128 operator*(const UInt128& other) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			return FromNative(ToNative() * other.ToNative());
+#else
 			UInt128 result;
 			for (size_t i = 0; i < 128; i++)
 			{
@@ -62,9 +89,14 @@ namespace zawa_ch::CDFS
 				}
 			}
 			return result;
+#endif
 		}
 		[[nodiscard]] constexpr UInt128 operator/(const UInt128& other) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			// 0除算は移植性のある実装と同じ結果を返す
+			if (!other.Equals(0U)) { return FromNative(ToNative() / other.ToNative()); }
+#endif
 			size_t w = 0;
 			for (size_t i = 0; i < 128; i++)
 			{
@@ -85,10 +117,14 @@ namespace zawa_ch::CDFS
 		}
 		[[nodiscard]] constexpr UInt128 operator%(const UInt128& other) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			// 0除算は移植性のある実装と同じ結果を返す
+			if (!other.Equals(0U)) { return FromNative(ToNative() % other.ToNative()); }
+#endif
 			size_t w = 0;
 			for (size_t i = 0; i < 128; i++)
 			{
-				if (((other << i) & (UInt128(1U) << 127)) != 0) { w = i; }
+				if (((other << i) & (UInt128(1U) << 127)) != 0) { w = i; break; }
 			}
 			UInt128 result;
 			UInt128 surplus = *this;
@@ -141,6 +177,9 @@ namespace zawa_ch::CDFS
 		}
 		[[nodiscard]] constexpr UInt128 operator>>(const size_t& count) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			return (count < 128U)?FromNative(ToNative() >> count):UInt128();
+#else
 			size_t shiftindex = count / (sizeof(uint_value) * 8U);
 			size_t shiftbit = count % (sizeof(uint_value) * 8U);
 			UInt128 result;
@@ -150,9 +189,13 @@ namespace zawa_ch::CDFS
 				result._data[i] |= _data[i + shiftindex] >> shiftbit;
 			}
 			return result;
+#endif
 		}
 		[[nodiscard]] constexpr UInt128 operator<<(const size_t& count) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			return (count < 128U)?FromNative(ToNative() << count):UInt128();
+#else
 			size_t shiftindex = count / (sizeof(uint_value) * 8U);
 			size_t shiftbit = count % (sizeof(uint_value) * 8U);
 			UInt128 result;
@@ -162,6 +205,7 @@ namespace zawa_ch::CDFS
 				result._data[i] |= _data[i - shiftindex] << shiftbit;
 			}
 			return result;
+#endif
 		}
 
 		[[nodiscard]] constexpr bool operator!() const noexcept { return *this == 0U; }
@@ -194,19 +238,30 @@ namespace zawa_ch::CDFS
 		///	このオブジェクトと他のオブジェクトの大小関係を比較します。
 		[[nodiscard]] constexpr int Compare(const UInt128& other) const noexcept
 		{
+#ifdef CDFS_NATIVE_UINT128
+			return (other.ToNative() < ToNative()) - (ToNative() < other.ToNative());
+#else
 			for (size_t i = _data.size() - 1; i < _data.size(); i--)
 			{
 				if (other._data[i] < _data[i]) { return 1; }
 				if (_data[i] < other._data[i]) { return -1; }
 			}
 			return 0;
+#endif
 		}
 		[[nodiscard]] constexpr bool operator==(const UInt128& other) const noexcept { return Equals(other); }
 		[[nodiscard]] constexpr bool operator!=(const UInt128& other) const noexcept { return !Equals(other); }
+#ifdef CDFS_NATIVE_UINT128
+		[[nodiscard]] constexpr bool operator<(const UInt128& other) const noexcept { return ToNative() < other.ToNative(); }
+		[[nodiscard]] constexpr bool operator>=(const UInt128& other) const noexcept { return ToNative() >= other.ToNative(); }
+		[[nodiscard]] constexpr bool operator>(const UInt128& other) const noexcept { return ToNative() > other.ToNative(); }
+		[[nodiscard]] constexpr bool operator<=(const UInt128& other) const noexcept { return ToNative() <= other.ToNative(); }
+#else
 		[[nodiscard]] constexpr bool operator<(const UInt128& other) const noexcept { return Compare(other) < 0;}
 		[[nodiscard]] constexpr bool operator>=(const UInt128& other) const noexcept { return Compare(other) >= 0;}
 		[[nodiscard]] constexpr bool operator>(const UInt128& other) const noexcept { return Compare(other) > 0;}
 		[[nodiscard]] constexpr bool operator<=(const UInt128& other) const noexcept { return Compare(other) <= 0;}
+#endif
 
 		constexpr explicit operator uint64_t() const noexcept { return uint64_t(_data[0]); }
 		constexpr explicit operator uint32_t() const noexcept { return uint32_t(_data[0]); }
@@ -214,6 +269,36 @@ namespace zawa_ch::CDFS
 		constexpr explicit operator uint8_t() const noexcept { return uint8_t(_data[0]); }
 	};
 
+	///	@a UInt128 のフィールドの値とバイト列を相互に変換します。
+	///	@details
+	///	バイト順序に関わらず下位64ビット、上位64ビットの順に、それぞれを指定されたバイト順序で読み書きします。
+	///	(従来の @a UInt128 のメモリ上の表現をそのまま書き込んでいた配置と同じです)
+	template<>
+	struct CDFSFieldCodec<UInt128> final
+	{
+	private:
+		typedef CDFSFieldCodec<uint64_t> half_codec;
+	public:
+		///	フィールドのバイト単位の大きさ。
+		static constexpr size_t Size = 16U;
+
+		///	指定された位置から値を読み出します。
+		template<CDFSByteOrder Order>
+		[[nodiscard]] static constexpr UInt128 Load(const uint8_t* source) noexcept
+		{
+			auto low = half_codec::Load<Order>(source);
+			auto high = half_codec::Load<Order>(source + 8U);
+			return (UInt128(high) << 64) | UInt128(low);
+		}
+		///	指定された位置に値を書き込みます。
+		template<CDFSByteOrder Order>
+		static constexpr void Store(uint8_t* destination, const UInt128& value) noexcept
+		{
+			half_codec::Store<Order>(destination, uint64_t(value));
+			half_codec::Store<Order>(destination + 8U, uint64_t(value >> 64));
+		}
+	};
+
 	///	CDFSフレームの種類。
 	enum class CDFSFrameTypes : uint32_t
 	{
@@ -222,6 +307,144 @@ namespace zawa_ch::CDFS
 		DATA = 0x44415444,
 		CONT = 0x434F4E54,
 		META = 0x4D455441,
+		CMPR = 0x434D5052,
+	};
+
+	///	CDFSデータの内容のハッシュ値の種類。
+	enum class CDFSHashTypes : uint32_t
+	{
+		///	ハッシュ値を持たない。
+		None = 0,
+		///	XXH3 (128ビット)。 @a XXH3 のダイジェスト値を先頭16バイトに格納し、残りは0でフィルします。
+		XXH3 = 1,
+	};
+
+	///	メタデータフレーム(META)に格納するメタデータの種類。
+	enum class CDFSMetaTypes : uint32_t
+	{
+		///	チャンネル切り替え。以降のデータフレーム・圧縮フレームが属するチャンネルを示します。
+		CHAN = 0x4348414E,
+	};
+
+	///	CDFSフレームのバイト列です。
+	///	@details
+	///	定数式の中でフレームを構築・解析する場合に使用します。
+	typedef std::array<uint8_t, 256> CDFSFrameImage;
+
+	///	CDFSフレームの基本構造の配置を表します。
+	///	@details
+	///	各フィールドはフレームの先頭を指すポインタに対して読み書きします。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSFrameLayout final
+	{
+		///	フレームのバイト単位の大きさ。
+		static constexpr size_t Size = 256U;
+		///	シーケンス番号。
+		typedef CDFSFrameField<0, uint64_t, Order> Sequence;
+		///	CDFSフレームの種類。
+		typedef CDFSFrameField<8, CDFSFrameTypes, Order> FrameType;
+		///	CDFSフレームの内容。
+		typedef CDFSFrameBytes<12, 240> Data;
+		///	CRC32 チェックサム。
+		typedef CDFSFrameField<252, uint32_t, Order> Checksum;
+
+		///	フレームのCRC32チェックサムを計算します。
+		///	@details
+		///	定数式の中で使用するための1ビットずつ計算する実装です。実行時は @a CRC32 を使用してください。
+		[[nodiscard]] static constexpr uint32_t CalculateChecksum(const uint8_t* frame) noexcept
+		{
+			auto crc = uint32_t(0xFFFFFFFF);
+			for (size_t i = 0U; i < Checksum::Position; i++)
+			{
+				crc ^= frame[i];
+				for (size_t j = 0U; j < 8U; j++) { crc = (crc & 1U)?(0xEDB88320U ^ (crc >> 1)):(crc >> 1); }
+			}
+			return crc ^ 0xFFFFFFFF;
+		}
+		///	フレームのCRC32チェックサムを計算し、フレームに書き込みます。
+		static constexpr void Seal(uint8_t* frame) noexcept { Checksum::Store(frame, CalculateChecksum(frame)); }
+		///	フレームのCRC32チェックサムを計算し、フレーム内のチェックサムが一致しているか検証します。
+		[[nodiscard]] static constexpr bool Verify(const uint8_t* frame) noexcept { return Checksum::Load(frame) == CalculateChecksum(frame); }
+	};
+
+	///	開始フレーム(CDFS)の配置を表します。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSHEADLayout final
+	{
+		typedef CDFSFrameLayout<Order> Frame;
+		///	CDFSデータバージョン。
+		typedef CDFSFrameField<Frame::Data::Position + 0U, uint32_t, Order> Version;
+		///	CDFSフレーム数。
+		typedef CDFSFrameField<Frame::Data::Position + 4U, UInt128, Order> Count;
+		///	CDFSラベル。
+		typedef CDFSFrameBytes<Frame::Data::Position + 20U, 32U> Label;
+		///	CDFSデータの総サイズ。
+		typedef CDFSFrameField<Frame::Data::Position + 52U, UInt128, Order> DataSize;
+		///	CDFSデータのハッシュ値の種類。
+		typedef CDFSFrameField<Frame::Data::Position + 68U, CDFSHashTypes, Order> HashType;
+		///	CDFSデータの構成を示すフラグ。
+		typedef CDFSFrameField<Frame::Data::Position + 72U, uint32_t, Order> Flags;
+	};
+
+	///	終了フレーム(FINF)の配置を表します。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSFINFLayout final
+	{
+		typedef CDFSFrameLayout<Order> Frame;
+		///	CDFSフレーム数。
+		typedef CDFSFrameField<Frame::Data::Position + 4U, UInt128, Order> Count;
+		///	CDFSデータのハッシュ値。
+		typedef CDFSFrameBytes<Frame::Data::Position + 20U, 32U> Hash;
+		///	CDFSデータの総サイズ。
+		typedef CDFSFrameField<Frame::Data::Position + 52U, UInt128, Order> DataSize;
+	};
+
+	///	データフレーム(DATA)の配置を表します。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSDATALayout final
+	{
+		typedef CDFSFrameLayout<Order> Frame;
+		///	フレームが保持しているデータ。
+		typedef CDFSFrameBytes<Frame::Data::Position, 240U> Content;
+	};
+
+	///	継続フレーム(CONT)の配置を表します。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSCONTLayout final
+	{
+		typedef CDFSFrameLayout<Order> Frame;
+		///	完全なシーケンス番号。
+		typedef CDFSFrameField<Frame::Data::Position + 4U, UInt128, Order> Current;
+		///	CDFSラベル。
+		typedef CDFSFrameBytes<Frame::Data::Position + 20U, 32U> Label;
+		///	このフレームより前のデータフレームに格納されたデータの総サイズ。
+		typedef CDFSFrameField<Frame::Data::Position + 52U, UInt128, Order> DataSize;
+	};
+
+	///	圧縮フレーム(CMPR)の配置を表します。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSCMPRLayout final
+	{
+		typedef CDFSFrameLayout<Order> Frame;
+		///	ブロック内でのフレームの位置。
+		typedef CDFSFrameField<Frame::Data::Position + 0U, uint16_t, Order> Part;
+		///	ブロックを構成するフレーム数。
+		typedef CDFSFrameField<Frame::Data::Position + 2U, uint16_t, Order> Parts;
+		///	フレームが保持しているブロックの断片。
+		typedef CDFSFrameBytes<Frame::Data::Position + 4U, 236U> Content;
+	};
+
+	///	メタデータフレーム(META)の配置を表します。
+	template<CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSMETALayout final
+	{
+		typedef CDFSFrameLayout<Order> Frame;
+		///	メタデータの種類。
+		typedef CDFSFrameField<Frame::Data::Position + 0U, CDFSMetaTypes, Order> Type;
+		///	以降のフレームが属するチャンネル。(チャンネル切り替えの場合)
+		typedef CDFSFrameField<Frame::Data::Position + 4U, uint32_t, Order> Channel;
+		///	直後のデータフレームに格納されたデータの大きさ。(チャンネル切り替えの場合)
+		typedef CDFSFrameField<Frame::Data::Position + 8U, uint32_t, Order> Length;
 	};
 
 	///	CDFSフレームの基本型です。
@@ -237,6 +460,10 @@ namespace zawa_ch::CDFS
 		///	CRC32 チェックサム。
 		uint32_t checksum;
 
+		///	フレームのバイト列の先頭を取得します。
+		[[nodiscard]] uint8_t* Bytes() noexcept { return reinterpret_cast<uint8_t*>(this); }
+		///	フレームのバイト列の先頭を取得します。
+		[[nodiscard]] const uint8_t* Bytes() const noexcept { return reinterpret_cast<const uint8_t*>(this); }
 		///	CRC32チェックサムを計算し、このオブジェクトに適用します。
 		void Validate();
 		///	CRC32チェックサムを計算し、オブジェクト内のチェックサムが一致しているか検証します。
@@ -246,6 +473,9 @@ namespace zawa_ch::CDFS
 	///	開始フレーム(CDFS)のシグネチャを持つCDFSフレームです。
 	struct CDFSHEADFrame final
 	{
+	public:
+		///	開始フレームと終了フレームの間が、最後を除いて240バイトを満たすデータフレームのみで構成されていることを示すフラグ。
+		static constexpr uint32_t DenseFlag = 0x00000001U;
 	private:
 		CDFSFrame frame;
 	public:
@@ -265,21 +495,29 @@ namespace zawa_ch::CDFS
 		///	このフレームのシーケンス番号を取得します。
 		const uint64_t& sequence() const;
 		///	このヘッダーが持つCDFSデータバージョンを取得します。
-		uint32_t& data_version();
-		///	このヘッダーが持つCDFSデータバージョンを取得します。
-		const uint32_t& data_version() const;
-		///	このヘッダーが持つCDFSフレーム数を取得します。
-		UInt128& data_count();
+		[[nodiscard]] uint32_t data_version() const noexcept { return CDFSHEADLayout<>::Version::Load(frame.Bytes()); }
+		///	このヘッダーが持つCDFSデータバージョンを設定します。
+		void data_version(const uint32_t& value) noexcept { CDFSHEADLayout<>::Version::Store(frame.Bytes(), value); }
 		///	このヘッダーが持つCDFSフレーム数を取得します。
-		const UInt128& data_count() const;
+		[[nodiscard]] UInt128 data_count() const noexcept { return CDFSHEADLayout<>::Count::Load(frame.Bytes()); }
+		///	このヘッダーが持つCDFSフレーム数を設定します。
+		void data_count(const UInt128& value) noexcept { CDFSHEADLayout<>::Count::Store(frame.Bytes(), value); }
 		///	このヘッダーが持つCDFSラベルを取得します。
-		std::array<char, 32>& data_label();
+		[[nodiscard]] Span<char> data_label() noexcept { return Span<char>(reinterpret_cast<char*>(CDFSHEADLayout<>::Label::Begin(frame.Bytes())), CDFSHEADLayout<>::Label::Size); }
 		///	このヘッダーが持つCDFSラベルを取得します。
-		const std::array<char, 32>& data_label() const;
+		[[nodiscard]] Span<const char> data_label() const noexcept { return Span<const char>(reinterpret_cast<const char*>(CDFSHEADLayout<>::Label::Begin(frame.Bytes())), CDFSHEADLayout<>::Label::Size); }
 		///	このヘッダーが持つCDFSデータの総サイズを取得します。
-		UInt128& data_size();
-		///	このヘッダーが持つCDFSデータの総サイズを取得します。
-		const UInt128& data_size() const;
+		[[nodiscard]] UInt128 data_size() const noexcept { return CDFSHEADLayout<>::DataSize::Load(frame.Bytes()); }
+		///	このヘッダーが持つCDFSデータの総サイズを設定します。
+		void data_size(const UInt128& value) noexcept { CDFSHEADLayout<>::DataSize::Store(frame.Bytes(), value); }
+		///	このヘッダーが持つCDFSデータのハッシュ値の種類を取得します。
+		[[nodiscard]] CDFSHashTypes data_hashtype() const noexcept { return CDFSHEADLayout<>::HashType::Load(frame.Bytes()); }
+		///	このヘッダーが持つCDFSデータのハッシュ値の種類を設定します。
+		void data_hashtype(const CDFSHashTypes& value) noexcept { CDFSHEADLayout<>::HashType::Store(frame.Bytes(), value); }
+		///	このヘッダーが持つCDFSデータの構成を示すフラグを取得します。
+		[[nodiscard]] uint32_t data_flags() const noexcept { return CDFSHEADLayout<>::Flags::Load(frame.Bytes()); }
+		///	このヘッダーが持つCDFSデータの構成を示すフラグを設定します。
+		void data_flags(const uint32_t& value) noexcept { CDFSHEADLayout<>::Flags::Store(frame.Bytes(), value); }
 
 		///	CRC32チェックサムを計算し、このオブジェクトに適用します。
 		void Validate();
@@ -312,17 +550,17 @@ namespace zawa_ch::CDFS
 		///	このフレームのシーケンス番号を取得します。
 		const uint64_t& sequence() const;
 		///	このフッターが持つCDFSフレーム数を取得します。
-		UInt128& data_count();
-		///	このフッターが持つCDFSフレーム数を取得します。
-		const UInt128& data_count() const;
+		[[nodiscard]] UInt128 data_count() const noexcept { return CDFSFINFLayout<>::Count::Load(frame.Bytes()); }
+		///	このフッターが持つCDFSフレーム数を設定します。
+		void data_count(const UInt128& value) noexcept { CDFSFINFLayout<>::Count::Store(frame.Bytes(), value); }
 		///	このフッターが持つCDFSデータのハッシュ値を取得します。
-		std::array<uint8_t, 32>& data_hash();
+		[[nodiscard]] Span<uint8_t> data_hash() noexcept { return Span<uint8_t>(CDFSFINFLayout<>::Hash::Begin(frame.Bytes()), CDFSFINFLayout<>::Hash::Size); }
 		///	このフッターが持つCDFSデータのハッシュ値を取得します。
-		const std::array<uint8_t, 32>& data_hash() const;
+		[[nodiscard]] Span<const uint8_t> data_hash() const noexcept { return Span<const uint8_t>(CDFSFINFLayout<>::Hash::Begin(frame.Bytes()), CDFSFINFLayout<>::Hash::Size); }
 		///	このフッターが持つCDFSデータの総サイズを取得します。
-		UInt128& data_size();
-		///	このフッターが持つCDFSデータの総サイズを取得します。
-		const UInt128& data_size() const;
+		[[nodiscard]] UInt128 data_size() const noexcept { return CDFSFINFLayout<>::DataSize::Load(frame.Bytes()); }
+		///	このフッターが持つCDFSデータの総サイズを設定します。
+		void data_size(const UInt128& value) noexcept { CDFSFINFLayout<>::DataSize::Store(frame.Bytes(), value); }
 
 		///	CRC32チェックサムを計算し、このオブジェクトに適用します。
 		void Validate();
@@ -390,13 +628,17 @@ namespace zawa_ch::CDFS
 		///	このフレームのシーケンス番号を取得します。
 		const uint64_t& sequence() const;
 		///	このフレームの完全なシーケンス番号を取得します。
-		UInt128& data_current();
-		///	このフレームの完全なシーケンス番号を取得します。
-		const UInt128& data_current() const;
+		[[nodiscard]] UInt128 data_current() const noexcept { return CDFSCONTLayout<>::Current::Load(frame.Bytes()); }
+		///	このフレームの完全なシーケンス番号を設定します。
+		void data_current(const UInt128& value) noexcept { CDFSCONTLayout<>::Current::Store(frame.Bytes(), value); }
 		///	このヘッダーが持つCDFSラベルを取得します。
-		std::array<char, 32>& data_label();
+		[[nodiscard]] Span<char> data_label() noexcept { return Span<char>(reinterpret_cast<char*>(CDFSCONTLayout<>::Label::Begin(frame.Bytes())), CDFSCONTLayout<>::Label::Size); }
 		///	このヘッダーが持つCDFSラベルを取得します。
-		const std::array<char, 32>& data_label() const;
+		[[nodiscard]] Span<const char> data_label() const noexcept { return Span<const char>(reinterpret_cast<const char*>(CDFSCONTLayout<>::Label::Begin(frame.Bytes())), CDFSCONTLayout<>::Label::Size); }
+		///	このフレームより前のデータフレームに格納されたデータの総サイズを取得します。
+		[[nodiscard]] UInt128 data_size() const noexcept { return CDFSCONTLayout<>::DataSize::Load(frame.Bytes()); }
+		///	このフレームより前のデータフレームに格納されたデータの総サイズを設定します。
+		void data_size(const UInt128& value) noexcept { CDFSCONTLayout<>::DataSize::Store(frame.Bytes(), value); }
 
 		///	CRC32チェックサムを計算し、このオブジェクトに適用します。
 		void Validate();
@@ -406,5 +648,106 @@ namespace zawa_ch::CDFS
 		/// 指定された @a CDFSFrame が継続フレームであるかを取得します。
 		static bool IsCONTFrame(const CDFSFrame& frame);
 	};
+
+	///	圧縮フレーム(CMPR)のシグネチャを持つCDFSフレームです。
+	///	@details
+	///	圧縮したデータのブロックを連続する複数の圧縮フレームに分割して格納します。
+	///	ブロックは他のフレームに依存せず展開できます。ブロックの形式は @a CDFSCompression を参照してください。
+	struct CDFSCMPRFrame final
+	{
+	public:
+		///	1フレームに格納できるブロックの大きさ。
+		static constexpr size_t ContentSize = 236;
+	private:
+		CDFSFrame frame;
+	public:
+		///	空の @a CDFSCMPRFrame を作成します。
+		CDFSCMPRFrame();
+		///	@a CDFSFrame をこの型に変換します。
+		///	@exception
+		explicit CDFSCMPRFrame(const CDFSFrame& frame);
+		///	@a CDFSFrame をこの型に変換します。
+		///	@exception
+		explicit CDFSCMPRFrame(CDFSFrame&& frame);
+
+		///	データを保持している @a CDFSFrame を取得します。
+		const CDFSFrame& Frame() const;
+		///	このフレームのシーケンス番号を取得します。
+		uint64_t& sequence();
+		///	このフレームのシーケンス番号を取得します。
+		const uint64_t& sequence() const;
+		///	ブロック内でのこのフレームの位置を取得します。
+		[[nodiscard]] uint16_t data_part() const noexcept { return CDFSCMPRLayout<>::Part::Load(frame.Bytes()); }
+		///	ブロック内でのこのフレームの位置を設定します。
+		void data_part(const uint16_t& value) noexcept { CDFSCMPRLayout<>::Part::Store(frame.Bytes(), value); }
+		///	ブロックを構成するフレーム数を取得します。
+		[[nodiscard]] uint16_t data_parts() const noexcept { return CDFSCMPRLayout<>::Parts::Load(frame.Bytes()); }
+		///	ブロックを構成するフレーム数を設定します。
+		void data_parts(const uint16_t& value) noexcept { CDFSCMPRLayout<>::Parts::Store(frame.Bytes(), value); }
+		///	このフレームが保持しているブロックの断片を取得します。
+		[[nodiscard]] Span<uint8_t> data_content() noexcept { return Span<uint8_t>(CDFSCMPRLayout<>::Content::Begin(frame.Bytes()), CDFSCMPRLayout<>::Content::Size); }
+		///	このフレームが保持しているブロックの断片を取得します。
+		[[nodiscard]] Span<const uint8_t> data_content() const noexcept { return Span<const uint8_t>(CDFSCMPRLayout<>::Content::Begin(frame.Bytes()), CDFSCMPRLayout<>::Content::Size); }
+
+		///	CRC32チェックサムを計算し、このオブジェクトに適用します。
+		void Validate();
+		///	CRC32チェックサムを計算し、オブジェクト内のチェックサムが一致しているか検証します。
+		bool IsValid() const;
+
+		/// 指定された @a CDFSFrame が圧縮フレームであるかを取得します。
+		static bool IsCMPRFrame(const CDFSFrame& frame);
+	};
+
+	///	メタデータフレーム(META)のシグネチャを持つCDFSフレームです。
+	///	@details
+	///	先頭の4バイトにメタデータの種類を格納し、以降の内容は種類ごとに定義されます。
+	///	チャンネル切り替え( @a CDFSMetaTypes::CHAN )の場合、以降のデータフレーム・圧縮フレームは次のチャンネル切り替えまで @a data_channel のチャンネルに属します。
+	///	@a data_length が 0 でない場合、直後のデータフレームは @a data_length バイトのデータのみを格納します。
+	struct CDFSMETAFrame final
+	{
+	private:
+		CDFSFrame frame;
+	public:
+		///	空の @a CDFSMETAFrame を作成します。
+		CDFSMETAFrame();
+		///	@a CDFSFrame をこの型に変換します。
+		///	@exception
+		explicit CDFSMETAFrame(const CDFSFrame& frame);
+		///	@a CDFSFrame をこの型に変換します。
+		///	@exception
+		explicit CDFSMETAFrame(CDFSFrame&& frame);
+
+		///	データを保持している @a CDFSFrame を取得します。
+		const CDFSFrame& Frame() const;
+		///	このフレームのシーケンス番号を取得します。
+		uint64_t& sequence();
+		///	このフレームのシーケンス番号を取得します。
+		const uint64_t& sequence() const;
+		///	このフレームが持つメタデータの種類を取得します。
+		[[nodiscard]] CDFSMetaTypes data_type() const noexcept { return CDFSMETALayout<>::Type::Load(frame.Bytes()); }
+		///	このフレームが持つメタデータの種類を設定します。
+		void data_type(const CDFSMetaTypes& value) noexcept { CDFSMETALayout<>::Type::Store(frame.Bytes(), value); }
+		///	以降のフレームが属するチャンネルを取得します。(チャンネル切り替えの場合)
+		[[nodiscard]] uint32_t data_channel() const noexcept { return CDFSMETALayout<>::Channel::Load(frame.Bytes()); }
+		///	以降のフレームが属するチャンネルを設定します。(チャンネル切り替えの場合)
+		void data_channel(const uint32_t& value) noexcept { CDFSMETALayout<>::Channel::Store(frame.Bytes(), value); }
+		///	直後のデータフレームに格納されたデータの大きさを取得します。(チャンネル切り替えの場合、 0 の場合は240バイトすべてを埋めています)
+		[[nodiscard]] uint32_t data_length() const noexcept { return CDFSMETALayout<>::Length::Load(frame.Bytes()); }
+		///	直後のデータフレームに格納されたデータの大きさを設定します。(チャンネル切り替えの場合、 0 の場合は240バイトすべてを埋めています)
+		void data_length(const uint32_t& value) noexcept { CDFSMETALayout<>::Length::Store(frame.Bytes(), value); }
+
+		///	CRC32チェックサムを計算し、このオブジェクトに適用します。
+		void Validate();
+		///	CRC32チェックサムを計算し、オブジェクト内のチェックサムが一致しているか検証します。
+		bool IsValid() const;
+
+		/// 指定された @a CDFSFrame がメタデータフレームであるかを取得します。
+		static bool IsMETAFrame(const CDFSFrame& frame);
+		/// 指定された @a CDFSFrame がチャンネル切り替えのメタデータフレームであるかを取得します。
+		static bool IsCHANFrame(const CDFSFrame& frame);
+		///	指定された @a CDFSFrame が直後のデータフレームに格納されたデータの大きさを示している場合、その大きさを取得します。
+		///	@return	有効なチャンネル切り替えのメタデータフレームではない場合や、大きさを示していない場合は 0 。
+		static size_t DeclaredSize(const CDFSFrame& frame);
+	};
 }
 #endif // __cdfs_datatype__
@@ -0,0 +1,118 @@
+//	cdfs/filebuffer
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_filebuffer__
+#define __cdfs_filebuffer__
+#include <memory>
+#include <string>
+#include <vector>
+#include <streambuf>
+#include "cdfs.hpp"
+namespace zawa_ch::CDFS
+{
+	///	複数のブロックの読み書きを非同期に並行して行うファイルストリームバッファです。
+	///	@details
+	///	ファイルを @a BlockSize バイト単位のブロックに区切り、最大 @a depth 個のブロックの読み書きをカーネルに発行したまま処理を続けます。
+	///	読み込み時は現在のブロックの後続のブロックを先読みし、書き込み時は書き終えたブロックの書き込み完了を待たずに次のブロックを埋めます。
+	///	これにより @a CDFSBuilder / @a CDFSLoader のチェックサム計算とディスクI/Oが重なって実行されます。
+	///	@a std::istream / @a std::ostream に渡して使用します。
+	///	@note
+	///	io_uring が使用できない環境では pread/pwrite による同期的な読み書きを行います。
+	///	この機能はPOSIX環境でのみ使用できます。
+	///	一つのバッファを読み込みと書き込みの両方に使用することはできません。
+	class CDFSFileBuffer final : public std::streambuf
+	{
+	public:
+		///	ファイルの読み書きに使用する実装の種類。
+		enum class Backends
+		{
+			///	pread/pwrite による同期的な読み書き。
+			Blocking,
+			///	io_uring による非同期的な読み書き。
+			IOUring,
+		};
+		///	既定のブロックの大きさ。(4096フレーム)
+		static constexpr size_t DefaultBlockSize = sizeof(CDFSFrame) * 4096U;
+		///	既定の同時に発行する読み書きの数。
+		static constexpr size_t DefaultDepth = 4U;
+	private:
+		///	読み書きの単位となるブロック。
+		struct Block final
+		{
+			///	ブロックのデータ。
+			std::unique_ptr<char_type[]> data;
+			///	ブロックの先頭のファイル上の位置。
+			off_type offset;
+			///	読み書きを要求した大きさ。
+			size_t size;
+			///	読み書きが完了した大きさ。(エラーの場合は負の値)
+			std::streamsize result;
+			///	読み書きを発行し、完了を待っているか。
+			bool pending;
+		};
+		///	io_uring の状態。
+		struct Ring;
+
+		int descriptor;
+		std::ios_base::openmode mode;
+		Backends backend;
+		size_t blocksize;
+		std::vector<Block> blocks;
+		std::unique_ptr<Ring> ring;
+		///	現在のバッファとして使用しているブロックのインデックス。
+		size_t current;
+		///	次に発行する読み込みのファイル上の位置。
+		off_type readahead;
+		///	書き込みに失敗したか。
+		bool fault;
+
+		///	指定されたブロックの読み込みを発行します。
+		void SubmitRead(const size_t& index, const off_type& offset);
+		///	指定されたブロックの書き込みを発行します。
+		void SubmitWrite(const size_t& index, const off_type& offset, const size_t& size);
+		///	指定されたブロックの読み書きが完了するまで待機します。
+		void Wait(const size_t& index);
+		///	発行したすべての読み書きが完了するまで待機します。
+		void WaitAll();
+		///	先読みを破棄し、指定された位置から読み込みを開始します。
+		void RestartRead(const off_type& offset);
+		///	バッファに書き込まれたデータの書き込みを発行し、次のブロックをバッファとします。
+		void FlushPut();
+		///	現在のファイル上の位置を取得します。
+		off_type Position() const noexcept;
+
+	protected:
+		int_type underflow() override;
+		int_type overflow(int_type c) override;
+		int sync() override;
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+		pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+	public:
+		///	ファイルを開かずに @a CDFSFileBuffer を初期化します。
+		CDFSFileBuffer();
+		///	指定されたファイルを開いて @a CDFSFileBuffer を初期化します。
+		CDFSFileBuffer(const std::string& path, const std::ios_base::openmode& mode, const Backends& backend = Backends::IOUring, const size_t& blocksize = DefaultBlockSize, const size_t& depth = DefaultDepth);
+		CDFSFileBuffer(const CDFSFileBuffer&) = delete;
+		CDFSFileBuffer& operator=(const CDFSFileBuffer&) = delete;
+		~CDFSFileBuffer();
+
+		///	指定されたファイルを開きます。
+		///	@param	mode	@a std::ios_base::in (読み込み)または @a std::ios_base::out (書き込み)のいずれか。書き込みの場合、既存のファイルの内容は破棄されます。
+		///	@param	backend	使用する実装。使用できない場合は @a Backends::Blocking を使用します。
+		///	@param	blocksize	一度に読み書きする大きさ。フレームの大きさの倍数に切り上げられます。
+		///	@param	depth	同時に発行する読み書きの数。
+		///	@return	ファイルを開くことに成功した場合は @a true 。
+		bool Open(const std::string& path, const std::ios_base::openmode& mode, const Backends& backend = Backends::IOUring, const size_t& blocksize = DefaultBlockSize, const size_t& depth = DefaultDepth);
+		///	書き込みを完了させてファイルを閉じます。
+		///	@return	すべての書き込みに成功した場合は @a true 。
+		bool Close();
+		///	ファイルが開かれているかを取得します。
+		bool IsOpen() const noexcept;
+		///	使用している実装を取得します。
+		Backends ActiveBackend() const noexcept;
+		///	指定された実装が実行環境で使用できるかを取得します。
+		static bool IsSupported(const Backends& backend) noexcept;
+	};
+}
+#endif // __cdfs_filebuffer__
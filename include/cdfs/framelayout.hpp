@@ -0,0 +1,159 @@
+//	cdfs/framelayout
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_framelayout__
+#define __cdfs_framelayout__
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+// 定数式の評価中であるかを判定する組み込み関数が使用できる場合は、実行時の読み書きを memcpy で行う
+// (使用できない場合は常にバイト単位で読み書きします)
+#if defined(__clang__)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define CDFS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#elif defined(__GNUC__) && (9 <= __GNUC__)
+#define CDFS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#ifndef CDFS_CONSTANT_EVALUATED
+#define CDFS_CONSTANT_EVALUATED() true
+#endif
+namespace zawa_ch::CDFS
+{
+	///	フィールドのバイト順序。
+	enum class CDFSByteOrder
+	{
+		///	リトルエンディアン。
+		Little,
+		///	ビッグエンディアン。
+		Big,
+		///	実行環境のバイト順序。
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		Native = Big,
+#else
+		Native = Little,
+#endif
+	};
+
+	///	フィールドの値とバイト列を相互に変換します。
+	///	@details
+	///	整数型・列挙型に対応します。その他の型はこのテンプレートを特殊化して対応させます。
+	///	特殊化は @a Size と、バイト順序を引数に取る静的関数 @a Load 、 @a Store を持つ必要があります。
+	template<typename T, typename = void>
+	struct CDFSFieldCodec;
+
+	///	整数型のフィールドの値とバイト列を相互に変換します。
+	///	@details
+	///	定数式の中ではバイト単位で読み書きし、実行時は境界の揃っていない単一のロード・ストア命令(必要であればバイト順序の入れ替え)になります。
+	template<typename T>
+	struct CDFSFieldCodec<T, std::enable_if_t<std::is_integral_v<T>>> final
+	{
+	private:
+		typedef std::make_unsigned_t<T> unsigned_type;
+
+		///	指定された値のバイト順序を入れ替えます。
+		[[nodiscard]] static constexpr unsigned_type Swap(const unsigned_type& value) noexcept
+		{
+			auto result = unsigned_type();
+			for (size_t i = 0U; i < sizeof(T); i++) { result = unsigned_type(result | unsigned_type(unsigned_type(uint8_t(value >> (i * 8U))) << ((sizeof(T) - 1U - i) * 8U))); }
+			return result;
+		}
+		///	指定されたバイト順序で @a i バイト目の桁を取得します。
+		[[nodiscard]] static constexpr size_t Shift(const CDFSByteOrder& order, const size_t& i) noexcept { return ((order == CDFSByteOrder::Little)?i:(sizeof(T) - 1U - i)) * 8U; }
+	public:
+		///	フィールドのバイト単位の大きさ。
+		static constexpr size_t Size = sizeof(T);
+
+		///	指定された位置から値を読み出します。
+		template<CDFSByteOrder Order>
+		[[nodiscard]] static constexpr T Load(const uint8_t* source) noexcept
+		{
+			auto value = unsigned_type();
+			if (!CDFS_CONSTANT_EVALUATED())
+			{
+				std::memcpy(&value, source, sizeof(T));
+				if constexpr (Order != CDFSByteOrder::Native) { value = Swap(value); }
+				return T(value);
+			}
+			for (size_t i = 0U; i < sizeof(T); i++) { value = unsigned_type(value | unsigned_type(unsigned_type(source[i]) << Shift(Order, i))); }
+			return T(value);
+		}
+		///	指定された位置に値を書き込みます。
+		template<CDFSByteOrder Order>
+		static constexpr void Store(uint8_t* destination, const T& value) noexcept
+		{
+			auto bits = unsigned_type(value);
+			if (!CDFS_CONSTANT_EVALUATED())
+			{
+				if constexpr (Order != CDFSByteOrder::Native) { bits = Swap(bits); }
+				std::memcpy(destination, &bits, sizeof(T));
+				return;
+			}
+			for (size_t i = 0U; i < sizeof(T); i++) { destination[i] = uint8_t(bits >> Shift(Order, i)); }
+		}
+	};
+
+	///	列挙型のフィールドの値とバイト列を相互に変換します。
+	///	@details
+	///	基になる整数型として読み書きします。
+	template<typename T>
+	struct CDFSFieldCodec<T, std::enable_if_t<std::is_enum_v<T>>> final
+	{
+	private:
+		typedef CDFSFieldCodec<std::underlying_type_t<T>> underlying_codec;
+	public:
+		///	フィールドのバイト単位の大きさ。
+		static constexpr size_t Size = underlying_codec::Size;
+
+		///	指定された位置から値を読み出します。
+		template<CDFSByteOrder Order>
+		[[nodiscard]] static constexpr T Load(const uint8_t* source) noexcept { return T(underlying_codec::template Load<Order>(source)); }
+		///	指定された位置に値を書き込みます。
+		template<CDFSByteOrder Order>
+		static constexpr void Store(uint8_t* destination, const T& value) noexcept { underlying_codec::template Store<Order>(destination, std::underlying_type_t<T>(value)); }
+	};
+
+	///	フレーム内の値を持つフィールドの配置を表します。
+	///	@details
+	///	@a Offset はフレームの先頭からのバイト単位の位置です。境界が揃っている必要はありません。
+	///	@a Load 、 @a Store はフレームの先頭を指すポインタを受け取ります。
+	template<size_t Offset, typename T, CDFSByteOrder Order = CDFSByteOrder::Native>
+	struct CDFSFrameField final
+	{
+		typedef T value_type;
+		///	フレームの先頭からのフィールドの位置。
+		static constexpr size_t Position = Offset;
+		///	フィールドのバイト単位の大きさ。
+		static constexpr size_t Size = CDFSFieldCodec<T>::Size;
+		///	フィールドのバイト順序。
+		static constexpr CDFSByteOrder ByteOrder = Order;
+
+		///	指定されたフレームからフィールドの値を読み出します。
+		[[nodiscard]] static constexpr T Load(const uint8_t* frame) noexcept { return CDFSFieldCodec<T>::template Load<Order>(frame + Offset); }
+		///	指定されたフレームにフィールドの値を書き込みます。
+		static constexpr void Store(uint8_t* frame, const T& value) noexcept { CDFSFieldCodec<T>::template Store<Order>(frame + Offset, value); }
+	};
+
+	///	フレーム内のバイト列のフィールドの配置を表します。
+	///	@details
+	///	バイト列はバイト順序の影響を受けません。
+	template<size_t Offset, size_t Length>
+	struct CDFSFrameBytes final
+	{
+		///	フレームの先頭からのフィールドの位置。
+		static constexpr size_t Position = Offset;
+		///	フィールドのバイト単位の大きさ。
+		static constexpr size_t Size = Length;
+
+		///	指定されたフレームのフィールドの先頭を取得します。
+		[[nodiscard]] static constexpr const uint8_t* Begin(const uint8_t* frame) noexcept { return frame + Offset; }
+		///	指定されたフレームのフィールドの先頭を取得します。
+		[[nodiscard]] static constexpr uint8_t* Begin(uint8_t* frame) noexcept { return frame + Offset; }
+		///	指定されたフレームのフィールドの終端を取得します。
+		[[nodiscard]] static constexpr const uint8_t* End(const uint8_t* frame) noexcept { return frame + Offset + Length; }
+		///	指定されたフレームのフィールドの終端を取得します。
+		[[nodiscard]] static constexpr uint8_t* End(uint8_t* frame) noexcept { return frame + Offset + Length; }
+	};
+}
+#endif // __cdfs_framelayout__
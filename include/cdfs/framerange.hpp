@@ -0,0 +1,285 @@
+//	cdfs/framerange
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_framerange__
+#define __cdfs_framerange__
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <vector>
+#include "cdfs.hpp"
+#include "span.hpp"
+namespace zawa_ch::CDFS
+{
+	///	フレーム列中の1つのフレームを参照します。
+	///	@details
+	///	フレームの内容はコピーせずに参照するため、参照先のフレーム列が有効な間のみ使用できます。
+	class CDFSFrameView final
+	{
+	private:
+		const CDFSFrame* frame;
+		size_t index;
+		uint32_t channel;
+		Span<const uint8_t> data;
+	public:
+		///	空の @a CDFSFrameView を作成します。
+		constexpr CDFSFrameView() noexcept : frame(), index(), channel(), data() {}
+		///	フレームと、そのフレームの位置・チャンネル・データを指定して @a CDFSFrameView を作成します。
+		constexpr CDFSFrameView(const CDFSFrame& frame, const size_t& index, const uint32_t& channel, const Span<const uint8_t>& data) noexcept : frame(&frame), index(index), channel(channel), data(data) {}
+
+		///	参照しているフレームを取得します。
+		[[nodiscard]] constexpr const CDFSFrame& Frame() const noexcept { return *frame; }
+		///	フレームの種類を取得します。
+		[[nodiscard]] constexpr CDFSFrameTypes Type() const noexcept { return frame->frametype; }
+		///	フレームのシーケンス番号を取得します。
+		[[nodiscard]] constexpr uint64_t Sequence() const noexcept { return frame->sequence; }
+		///	フレーム列の先頭からのフレームの位置を取得します。
+		[[nodiscard]] constexpr size_t Index() const noexcept { return index; }
+		///	フレームが属するチャンネルを取得します。
+		[[nodiscard]] constexpr uint32_t Channel() const noexcept { return channel; }
+		///	フレームに含まれるデータを取得します。
+		///	@details
+		///	データフレームではない場合は空の @a Span を返します。
+		[[nodiscard]] constexpr Span<const uint8_t> Data() const noexcept { return data; }
+		///	CRC32チェックサムを計算し、フレーム内のチェックサムが一致しているか検証します。
+		[[nodiscard]] bool IsValid() const { return frame->IsValid(); }
+		///	このフレームが @a T の種類であるかを取得します。
+		template<typename T>
+		[[nodiscard]] bool Is() const noexcept { return CDFSRawFrameView(*frame).Is<T>(); }
+		///	このフレームを @a T の型として参照します。
+		///	@return	フレームの種類が異なる場合は @a std::nullopt 。
+		template<typename T>
+		[[nodiscard]] std::optional<T> TryAs() const noexcept { return CDFSRawFrameView(*frame).TryAs<T>(); }
+	};
+
+	class CDFSPayloadRange;
+
+	///	メモリ上のフレーム列を先頭から順に参照する範囲です。
+	///	@details
+	///	マップしたファイルや読み込み済みのバッファなど、連続したフレーム列を直接参照します。
+	///	反復子は前方反復子として使用でき、フレームごとに @a CDFSFrameView を返します。
+	///	反復の際にフレームのコピーやメモリの確保は発生しません。
+	///	データフレームのデータは、直前のチャンネル切り替えが示す大きさ、または総サイズに合わせて切り詰められます。
+	///	最後のデータフレームの大きさは、そのフレームを参照した際に直前の開始フレーム・継続フレームまで遡って求めます。
+	///	( @a Payload で開始フレームから順に参照する場合は遡りません)
+	///	@note
+	///	フレーム列がCDFSデータの途中から始まる場合、先頭のフレームのチャンネルは 0 とみなします。
+	///	フレームのチェックサム・シーケンス番号は検証しません。
+	class CDFSFrameRange final
+	{
+	public:
+		///	@a CDFSFrameRange の反復子。
+		class Iterator final
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef CDFSFrameView value_type;
+			typedef ptrdiff_t difference_type;
+			typedef void pointer;
+			typedef CDFSFrameView reference;
+		private:
+			const CDFSFrameRange* range;
+			const CDFSFrame* current;
+			uint32_t channel;
+
+			///	現在のフレームが示すチャンネルを適用します。
+			void Enter() noexcept
+			{
+				if (current == range->frames.end()) { return; }
+				if (current->frametype == CDFSFrameTypes::HEAD) { channel = 0U; }
+				else if (current->frametype == CDFSFrameTypes::META) { channel = Announce(*current, channel); }
+			}
+		public:
+			///	どの範囲も参照しない反復子を作成します。
+			Iterator() noexcept : range(), current(), channel() {}
+			///	指定された範囲のフレームを指す反復子を作成します。
+			Iterator(const CDFSFrameRange& range, const CDFSFrame* current) noexcept : range(&range), current(current), channel() { Enter(); }
+
+			///	現在のフレームを取得します。
+			[[nodiscard]] const CDFSFrame& Frame() const noexcept { return *current; }
+			///	現在のフレームが属するチャンネルを取得します。
+			[[nodiscard]] uint32_t Channel() const noexcept { return channel; }
+			[[nodiscard]] reference operator*() const noexcept { return CDFSFrameView(*current, size_t(current - range->frames.data()), channel, range->GetData(*current)); }
+			Iterator& operator++() noexcept
+			{
+				++current;
+				Enter();
+				return *this;
+			}
+			Iterator operator++(int) noexcept
+			{
+				auto result = *this;
+				++(*this);
+				return result;
+			}
+			[[nodiscard]] bool operator==(const Iterator& other) const noexcept { return current == other.current; }
+			[[nodiscard]] bool operator!=(const Iterator& other) const noexcept { return current != other.current; }
+		};
+		typedef Iterator iterator;
+		typedef Iterator const_iterator;
+	private:
+		Span<const CDFSFrame> frames;
+		UInt128 datasize;
+		///	最後のデータフレーム。
+		const CDFSFrame* lastdata;
+
+		///	最後のデータフレームを求めます。
+		void Locate() noexcept;
+		///	最後のデータフレームが保持するデータの大きさを求めます。
+		///	@param	preceding	最後のデータフレームより前のデータの大きさ。 @a nullptr の場合は直前の開始フレーム・継続フレームまで遡って求めます。
+		size_t LastDataSize(const UInt128* preceding) const noexcept;
+		///	指定された大きさのデータより後に残るデータの大きさを、データフレームの大きさを上限として求めます。
+		size_t Remain(const UInt128& preceding) const noexcept;
+		///	指定されたフレームに含まれるデータを取得します。
+		///	@param	preceding	@a frame より前のデータの大きさ。不明な場合は @a nullptr 。
+		[[nodiscard]] Span<const uint8_t> GetData(const CDFSFrame& frame, const UInt128* preceding) const noexcept
+		{
+			if (frame.frametype != CDFSFrameTypes::DATA) { return Span<const uint8_t>(); }
+			// 直前のチャンネル切り替えフレームが大きさを示している場合はそれに従う
+			if ((&frame != frames.begin())&&((&frame)[-1].frametype == CDFSFrameTypes::META))
+			{
+				auto declared = CDFSMETAFrame::DeclaredSize((&frame)[-1]);
+				if (declared != 0U) { return Span<const uint8_t>(frame.data.data(), declared); }
+			}
+			return Span<const uint8_t>(frame.data.data(), (&frame == lastdata)?LastDataSize(preceding):frame.data.size());
+		}
+
+		friend CDFSPayloadRange;
+		///	指定されたフレームが有効なチャンネル切り替えの場合はそのチャンネルを、そうでない場合は @a channel を返します。
+		static uint32_t Announce(const CDFSFrame& frame, const uint32_t& channel) noexcept;
+	public:
+		///	空の @a CDFSFrameRange を作成します。
+		CDFSFrameRange() noexcept;
+		///	フレーム列を参照する @a CDFSFrameRange を作成します。
+		///	@details
+		///	総サイズはフレーム列の最後の終了フレーム、または先頭の開始フレームから取得します。
+		explicit CDFSFrameRange(const Span<const CDFSFrame>& frames) noexcept;
+		///	フレーム列と総サイズを指定して @a CDFSFrameRange を作成します。
+		///	@param	datasize	CDFSデータの総サイズ。 0 の場合は不明なものとして扱い、データフレームを切り詰めません。
+		CDFSFrameRange(const Span<const CDFSFrame>& frames, const UInt128& datasize) noexcept;
+
+		///	参照しているフレーム列を取得します。
+		[[nodiscard]] Span<const CDFSFrame> Frames() const noexcept { return frames; }
+		///	CDFSデータの総サイズを取得します。
+		[[nodiscard]] const UInt128& DataSize() const noexcept { return datasize; }
+		///	フレーム数を取得します。
+		[[nodiscard]] size_t size() const noexcept { return frames.size(); }
+		///	フレームを含まないかを取得します。
+		[[nodiscard]] bool empty() const noexcept { return frames.empty(); }
+		[[nodiscard]] Iterator begin() const noexcept { return Iterator(*this, frames.begin()); }
+		[[nodiscard]] Iterator end() const noexcept { return Iterator(*this, frames.end()); }
+
+		///	指定されたフレームに含まれるデータを取得します。
+		///	@details
+		///	@a frame はこの範囲のフレームである必要があります。
+		///	データフレームではない場合は空の @a Span を返します。
+		[[nodiscard]] Span<const uint8_t> GetData(const CDFSFrame& frame) const noexcept { return GetData(frame, nullptr); }
+		///	指定されたインデックスのフレームに含まれるデータを取得します。
+		///	@details
+		///	データフレームではない場合や範囲外の場合は空の @a Span を返します。
+		[[nodiscard]] Span<const uint8_t> GetData(const size_t& index) const noexcept { return (index < frames.size())?GetData(frames[index]):Span<const uint8_t>(); }
+		///	フレーム列に含まれるデータを先頭から順に参照する範囲を取得します。
+		[[nodiscard]] CDFSPayloadRange Payload() const;
+	};
+
+	///	フレーム列に含まれるデータを先頭から順に参照する範囲です。
+	///	@details
+	///	反復子はデータフレームのデータと、圧縮フレームのブロックを展開したデータを順に @a Span として返します。
+	///	データフレームのデータはフレームを直接参照し、ブロックはこのオブジェクトが持つ領域に展開します。
+	///	展開に使用する領域は最初の圧縮フレームに到達した際に一度だけ確保されます。
+	///	@note
+	///	展開した領域は次のブロックの展開で上書きされるため、反復子は入力反復子として扱う必要があります。
+	///	不正なブロックは読み飛ばし、 @a HasFault で検出できます。
+	class CDFSPayloadRange final
+	{
+	public:
+		///	@a CDFSPayloadRange の反復子。
+		class Iterator final
+		{
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef Span<const uint8_t> value_type;
+			typedef ptrdiff_t difference_type;
+			typedef const Span<const uint8_t>* pointer;
+			typedef const Span<const uint8_t>& reference;
+		private:
+			CDFSPayloadRange* range;
+			///	現在のデータを含む最初のフレーム。
+			CDFSFrameRange::Iterator current;
+			///	現在のデータを含むフレームの次のフレーム。
+			CDFSFrameRange::Iterator next;
+			Span<const uint8_t> data;
+			///	現在のデータより前のデータの大きさ。
+			UInt128 position;
+			///	開始フレームから数えているため @a position が有効であるか。
+			bool anchored;
+
+			///	@a next 以降の、データを含む最初のフレームに移動します。
+			void Seek()
+			{
+				auto last = range->frames.end();
+				position += data.size();
+				while ((current = next) != last)
+				{
+					const auto& frame = next.Frame();
+					++next;
+					if (frame.frametype == CDFSFrameTypes::DATA) { data = range->frames.GetData(frame, anchored?&position:nullptr); }
+					else if (frame.frametype == CDFSFrameTypes::CMPR) { data = range->Expand(frame, next); }
+					else { continue; }
+					if (!data.empty()) { return; }
+				}
+				data = Span<const uint8_t>();
+			}
+		public:
+			///	どの範囲も参照しない反復子を作成します。
+			Iterator() noexcept : range(), current(), next(), data(), position(), anchored() {}
+			///	指定された範囲のフレームから始まる反復子を作成します。
+			Iterator(CDFSPayloadRange& range, const CDFSFrameRange::Iterator& first) : range(&range), current(first), next(first), data(), position(), anchored()
+			{
+				anchored = (first != range.frames.end())&&(first.Frame().frametype == CDFSFrameTypes::HEAD);
+				Seek();
+			}
+
+			///	現在のデータが属するチャンネルを取得します。
+			[[nodiscard]] uint32_t Channel() const noexcept { return current.Channel(); }
+			[[nodiscard]] reference operator*() const noexcept { return data; }
+			[[nodiscard]] pointer operator->() const noexcept { return &data; }
+			Iterator& operator++()
+			{
+				Seek();
+				return *this;
+			}
+			Iterator operator++(int)
+			{
+				auto result = *this;
+				++(*this);
+				return result;
+			}
+			[[nodiscard]] bool operator==(const Iterator& other) const noexcept { return current == other.current; }
+			[[nodiscard]] bool operator!=(const Iterator& other) const noexcept { return current != other.current; }
+		};
+		typedef Iterator iterator;
+	private:
+		CDFSFrameRange frames;
+		///	フレームに分割されたブロックを連結する領域。
+		std::vector<uint8_t> block;
+		///	ブロックを展開する領域。
+		std::vector<uint8_t> raw;
+		bool fault;
+
+		///	圧縮フレームのブロックを展開します。
+		///	@param	first	ブロックの最初の圧縮フレーム。
+		///	@param	next	@a first の次のフレームを指す反復子。ブロックの次のフレームに進められます。
+		///	@return	展開したデータ。ブロックが不正な場合は空の @a Span 。
+		Span<const uint8_t> Expand(const CDFSFrame& first, CDFSFrameRange::Iterator& next);
+	public:
+		///	フレーム列の範囲からデータを参照する @a CDFSPayloadRange を作成します。
+		explicit CDFSPayloadRange(const CDFSFrameRange& frames);
+
+		[[nodiscard]] Iterator begin() { return Iterator(*this, frames.begin()); }
+		[[nodiscard]] Iterator end() { return Iterator(*this, frames.end()); }
+		///	不正なブロックを読み飛ばしたかを取得します。
+		[[nodiscard]] bool HasFault() const noexcept { return fault; }
+	};
+}
+#endif // __cdfs_framerange__
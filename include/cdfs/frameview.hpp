@@ -0,0 +1,215 @@
+//	cdfs/frameview
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_frameview__
+#define __cdfs_frameview__
+#include <optional>
+#include "datatype.hpp"
+#include "framelayout.hpp"
+#include "checksum.hpp"
+#include "span.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSフレームを所有せずに参照します。
+	///	@details
+	///	フレームのバイト列を直接参照し、各フィールドは参照の都度読み出します。参照先の境界は揃っている必要はありません。
+	///	参照先のフレームが有効な間のみ使用できます。
+	///	種類ごとのフィールドを読み出す場合は @a TryAs で種類を確認したうえで、対応する型に変換します。
+	///	各フィールドは @a Order のバイト順序で読み出します。バイト順序はコンパイル時に決まるため、実行環境と同じバイト順序では変換は発生しません。
+	template<CDFSByteOrder Order>
+	class CDFSBasicRawFrameView
+	{
+	protected:
+		const uint8_t* bytes;
+
+		///	指定されたバイト列のフィールドを参照する @a Span を取得します。
+		template<typename T, typename Field>
+		[[nodiscard]] Span<const T> Range() const noexcept { return Span<const T>(reinterpret_cast<const T*>(Field::Begin(bytes)), Field::Size); }
+	public:
+		///	参照するフレームのバイト順序。
+		static constexpr CDFSByteOrder ByteOrder = Order;
+		///	参照するフレームのバイト単位の大きさ。
+		static constexpr size_t Size = CDFSFrameLayout<Order>::Size;
+
+		///	何も参照しない @a CDFSBasicRawFrameView を作成します。
+		constexpr CDFSBasicRawFrameView() noexcept : bytes() {}
+		///	@a CDFSFrame を参照する @a CDFSBasicRawFrameView を作成します。
+		explicit CDFSBasicRawFrameView(const CDFSFrame& frame) noexcept : bytes(reinterpret_cast<const uint8_t*>(&frame)) {}
+		///	@a Size バイトのバイト列を参照する @a CDFSBasicRawFrameView を作成します。
+		explicit constexpr CDFSBasicRawFrameView(const uint8_t* bytes) noexcept : bytes(bytes) {}
+
+		///	参照しているバイト列を取得します。
+		[[nodiscard]] constexpr Span<const uint8_t> Bytes() const noexcept { return Span<const uint8_t>(bytes, Size); }
+		///	このフレームのシーケンス番号を取得します。
+		[[nodiscard]] uint64_t sequence() const noexcept { return CDFSFrameLayout<Order>::Sequence::Load(bytes); }
+		///	このフレームの種類を取得します。
+		[[nodiscard]] CDFSFrameTypes frametype() const noexcept { return CDFSFrameLayout<Order>::FrameType::Load(bytes); }
+		///	このフレームのCRC32チェックサムを取得します。
+		[[nodiscard]] uint32_t checksum() const noexcept { return CDFSFrameLayout<Order>::Checksum::Load(bytes); }
+		///	CRC32チェックサムを計算し、フレーム内のチェックサムが一致しているか検証します。
+		[[nodiscard]] bool IsValid() const noexcept
+		{
+			auto calculator = CRC32();
+			calculator.Push(bytes, bytes + CDFSFrameLayout<Order>::Checksum::Position);
+			return checksum() == calculator.GetValue();
+		}
+
+		///	このフレームが @a T の種類であるかを取得します。
+		template<typename T>
+		[[nodiscard]] bool Is() const noexcept { return frametype() == T::Type; }
+		///	このフレームを @a T の型として参照します。
+		///	@return	フレームの種類が異なる場合は @a std::nullopt 。
+		template<typename T>
+		[[nodiscard]] std::optional<T> TryAs() const noexcept
+		{
+			static_assert(T::ByteOrder == Order, "バイト順序の異なる型には変換できません。");
+			if (!Is<T>()) { return std::nullopt; }
+			return T(bytes);
+		}
+	};
+	///	実行環境のバイト順序で書き込まれたCDFSフレームを所有せずに参照します。
+	typedef CDFSBasicRawFrameView<CDFSByteOrder::Native> CDFSRawFrameView;
+
+	///	開始フレーム(CDFS)を所有せずに参照します。
+	///	@details
+	///	フレームの種類は確認しません。種類が不明なフレームは @a CDFSRawFrameView::TryAs で変換します。
+	template<CDFSByteOrder Order>
+	class CDFSBasicHEADView final : public CDFSBasicRawFrameView<Order>
+	{
+	public:
+		static constexpr CDFSFrameTypes Type = CDFSFrameTypes::HEAD;
+
+		constexpr CDFSBasicHEADView() noexcept : CDFSBasicRawFrameView<Order>() {}
+		explicit CDFSBasicHEADView(const CDFSFrame& frame) noexcept : CDFSBasicRawFrameView<Order>(frame) {}
+		explicit constexpr CDFSBasicHEADView(const uint8_t* bytes) noexcept : CDFSBasicRawFrameView<Order>(bytes) {}
+
+		///	このヘッダーが持つCDFSデータバージョンを取得します。
+		[[nodiscard]] uint32_t data_version() const noexcept { return CDFSHEADLayout<Order>::Version::Load(this->bytes); }
+		///	このヘッダーが持つCDFSフレーム数を取得します。
+		[[nodiscard]] UInt128 data_count() const noexcept { return CDFSHEADLayout<Order>::Count::Load(this->bytes); }
+		///	このヘッダーが持つCDFSラベルを取得します。
+		[[nodiscard]] Span<const char> data_label() const noexcept { return this->template Range<char, typename CDFSHEADLayout<Order>::Label>(); }
+		///	このヘッダーが持つCDFSデータの総サイズを取得します。
+		[[nodiscard]] UInt128 data_size() const noexcept { return CDFSHEADLayout<Order>::DataSize::Load(this->bytes); }
+		///	このヘッダーが持つCDFSデータのハッシュ値の種類を取得します。
+		[[nodiscard]] CDFSHashTypes data_hashtype() const noexcept { return CDFSHEADLayout<Order>::HashType::Load(this->bytes); }
+		///	このヘッダーが持つCDFSデータの構成を示すフラグを取得します。
+		[[nodiscard]] uint32_t data_flags() const noexcept { return CDFSHEADLayout<Order>::Flags::Load(this->bytes); }
+	};
+	///	実行環境のバイト順序で書き込まれた開始フレーム(CDFS)を所有せずに参照します。
+	typedef CDFSBasicHEADView<CDFSByteOrder::Native> CDFSHEADView;
+
+	///	終了フレーム(FINF)を所有せずに参照します。
+	///	@details
+	///	フレームの種類は確認しません。種類が不明なフレームは @a CDFSRawFrameView::TryAs で変換します。
+	template<CDFSByteOrder Order>
+	class CDFSBasicFINFView final : public CDFSBasicRawFrameView<Order>
+	{
+	public:
+		static constexpr CDFSFrameTypes Type = CDFSFrameTypes::FINF;
+
+		constexpr CDFSBasicFINFView() noexcept : CDFSBasicRawFrameView<Order>() {}
+		explicit CDFSBasicFINFView(const CDFSFrame& frame) noexcept : CDFSBasicRawFrameView<Order>(frame) {}
+		explicit constexpr CDFSBasicFINFView(const uint8_t* bytes) noexcept : CDFSBasicRawFrameView<Order>(bytes) {}
+
+		///	このフッターが持つCDFSフレーム数を取得します。
+		[[nodiscard]] UInt128 data_count() const noexcept { return CDFSFINFLayout<Order>::Count::Load(this->bytes); }
+		///	このフッターが持つCDFSデータのハッシュ値を取得します。
+		[[nodiscard]] Span<const uint8_t> data_hash() const noexcept { return this->template Range<uint8_t, typename CDFSFINFLayout<Order>::Hash>(); }
+		///	このフッターが持つCDFSデータの総サイズを取得します。
+		[[nodiscard]] UInt128 data_size() const noexcept { return CDFSFINFLayout<Order>::DataSize::Load(this->bytes); }
+	};
+	///	実行環境のバイト順序で書き込まれた終了フレーム(FINF)を所有せずに参照します。
+	typedef CDFSBasicFINFView<CDFSByteOrder::Native> CDFSFINFView;
+
+	///	データフレーム(DATA)を所有せずに参照します。
+	///	@details
+	///	フレームの種類は確認しません。種類が不明なフレームは @a CDFSRawFrameView::TryAs で変換します。
+	template<CDFSByteOrder Order>
+	class CDFSBasicDATAView final : public CDFSBasicRawFrameView<Order>
+	{
+	public:
+		static constexpr CDFSFrameTypes Type = CDFSFrameTypes::DATA;
+
+		constexpr CDFSBasicDATAView() noexcept : CDFSBasicRawFrameView<Order>() {}
+		explicit CDFSBasicDATAView(const CDFSFrame& frame) noexcept : CDFSBasicRawFrameView<Order>(frame) {}
+		explicit constexpr CDFSBasicDATAView(const uint8_t* bytes) noexcept : CDFSBasicRawFrameView<Order>(bytes) {}
+
+		///	このフレームが保持しているデータを取得します。
+		[[nodiscard]] Span<const uint8_t> data() const noexcept { return this->template Range<uint8_t, typename CDFSDATALayout<Order>::Content>(); }
+	};
+	///	実行環境のバイト順序で書き込まれたデータフレーム(DATA)を所有せずに参照します。
+	typedef CDFSBasicDATAView<CDFSByteOrder::Native> CDFSDATAView;
+
+	///	継続フレーム(CONT)を所有せずに参照します。
+	///	@details
+	///	フレームの種類は確認しません。種類が不明なフレームは @a CDFSRawFrameView::TryAs で変換します。
+	template<CDFSByteOrder Order>
+	class CDFSBasicCONTView final : public CDFSBasicRawFrameView<Order>
+	{
+	public:
+		static constexpr CDFSFrameTypes Type = CDFSFrameTypes::CONT;
+
+		constexpr CDFSBasicCONTView() noexcept : CDFSBasicRawFrameView<Order>() {}
+		explicit CDFSBasicCONTView(const CDFSFrame& frame) noexcept : CDFSBasicRawFrameView<Order>(frame) {}
+		explicit constexpr CDFSBasicCONTView(const uint8_t* bytes) noexcept : CDFSBasicRawFrameView<Order>(bytes) {}
+
+		///	このフレームの完全なシーケンス番号を取得します。
+		[[nodiscard]] UInt128 data_current() const noexcept { return CDFSCONTLayout<Order>::Current::Load(this->bytes); }
+		///	このヘッダーが持つCDFSラベルを取得します。
+		[[nodiscard]] Span<const char> data_label() const noexcept { return this->template Range<char, typename CDFSCONTLayout<Order>::Label>(); }
+		///	このフレームより前のデータフレームに格納されたデータの総サイズを取得します。
+		[[nodiscard]] UInt128 data_size() const noexcept { return CDFSCONTLayout<Order>::DataSize::Load(this->bytes); }
+	};
+	///	実行環境のバイト順序で書き込まれた継続フレーム(CONT)を所有せずに参照します。
+	typedef CDFSBasicCONTView<CDFSByteOrder::Native> CDFSCONTView;
+
+	///	圧縮フレーム(CMPR)を所有せずに参照します。
+	///	@details
+	///	フレームの種類は確認しません。種類が不明なフレームは @a CDFSRawFrameView::TryAs で変換します。
+	template<CDFSByteOrder Order>
+	class CDFSBasicCMPRView final : public CDFSBasicRawFrameView<Order>
+	{
+	public:
+		static constexpr CDFSFrameTypes Type = CDFSFrameTypes::CMPR;
+
+		constexpr CDFSBasicCMPRView() noexcept : CDFSBasicRawFrameView<Order>() {}
+		explicit CDFSBasicCMPRView(const CDFSFrame& frame) noexcept : CDFSBasicRawFrameView<Order>(frame) {}
+		explicit constexpr CDFSBasicCMPRView(const uint8_t* bytes) noexcept : CDFSBasicRawFrameView<Order>(bytes) {}
+
+		///	ブロック内でのこのフレームの位置を取得します。
+		[[nodiscard]] uint16_t data_part() const noexcept { return CDFSCMPRLayout<Order>::Part::Load(this->bytes); }
+		///	ブロックを構成するフレーム数を取得します。
+		[[nodiscard]] uint16_t data_parts() const noexcept { return CDFSCMPRLayout<Order>::Parts::Load(this->bytes); }
+		///	このフレームが保持しているブロックの断片を取得します。
+		[[nodiscard]] Span<const uint8_t> data_content() const noexcept { return this->template Range<uint8_t, typename CDFSCMPRLayout<Order>::Content>(); }
+	};
+	///	実行環境のバイト順序で書き込まれた圧縮フレーム(CMPR)を所有せずに参照します。
+	typedef CDFSBasicCMPRView<CDFSByteOrder::Native> CDFSCMPRView;
+
+	///	メタデータフレーム(META)を所有せずに参照します。
+	///	@details
+	///	フレームの種類は確認しません。種類が不明なフレームは @a CDFSRawFrameView::TryAs で変換します。
+	template<CDFSByteOrder Order>
+	class CDFSBasicMETAView final : public CDFSBasicRawFrameView<Order>
+	{
+	public:
+		static constexpr CDFSFrameTypes Type = CDFSFrameTypes::META;
+
+		constexpr CDFSBasicMETAView() noexcept : CDFSBasicRawFrameView<Order>() {}
+		explicit CDFSBasicMETAView(const CDFSFrame& frame) noexcept : CDFSBasicRawFrameView<Order>(frame) {}
+		explicit constexpr CDFSBasicMETAView(const uint8_t* bytes) noexcept : CDFSBasicRawFrameView<Order>(bytes) {}
+
+		///	このフレームが持つメタデータの種類を取得します。
+		[[nodiscard]] CDFSMetaTypes data_type() const noexcept { return CDFSMETALayout<Order>::Type::Load(this->bytes); }
+		///	以降のフレームが属するチャンネルを取得します。(チャンネル切り替えの場合)
+		[[nodiscard]] uint32_t data_channel() const noexcept { return CDFSMETALayout<Order>::Channel::Load(this->bytes); }
+		///	直後のデータフレームに格納されたデータの大きさを取得します。(チャンネル切り替えの場合、 0 の場合は240バイトすべてを埋めています)
+		[[nodiscard]] uint32_t data_length() const noexcept { return CDFSMETALayout<Order>::Length::Load(this->bytes); }
+		///	チャンネル切り替えのメタデータであるかを取得します。
+		[[nodiscard]] bool IsCHAN() const noexcept { return data_type() == CDFSMetaTypes::CHAN; }
+	};
+	///	実行環境のバイト順序で書き込まれたメタデータフレーム(META)を所有せずに参照します。
+	typedef CDFSBasicMETAView<CDFSByteOrder::Native> CDFSMETAView;
+}
+#endif // __cdfs_frameview__
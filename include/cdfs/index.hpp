@@ -0,0 +1,154 @@
+//	cdfs/index
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_index__
+#define __cdfs_index__
+#include <array>
+#include <vector>
+#include <optional>
+#include <iostream>
+#include "cdfs.hpp"
+#include "span.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSデータのフレームの配置を記録した索引(.cdfsidx)です。
+	///	@details
+	///	@a Interval フレームごとのチェックポイント(そのフレームまでのデータの位置とブロック内のチェックサムの要約)と、
+	///	データフレーム以外のフレームの位置を保持します。
+	///	これにより、データの位置に対応するフレームの位置や、フレームの位置に対応するデータの位置を O(log n) で求めることができます。
+	///	索引はCDFSデータのフレームを先頭から順に @a Append することで構築します。
+	///	フレームは実行環境のバイト順序に変換したものを扱い、チェックサムも変換後のものを記録します。
+	class CDFSIndex final
+	{
+	public:
+		///	既定のチェックポイントの間隔。(フレーム数)
+		static constexpr size_t DefaultInterval = 4096;
+		///	索引ファイルのシグネチャ。
+		static constexpr std::array<char, 8> Signature = { 'C', 'D', 'F', 'S', 'I', 'D', 'X', '\0' };
+		///	索引ファイルのフォーマットバージョン。
+		static constexpr uint32_t Version = 2;
+
+		///	@a Interval フレームごとのチェックポイント。
+		struct Checkpoint final
+		{
+		public:
+			///	ブロックの最初のフレームより前に格納されたデータの大きさ。
+			UInt128 dataoffset;
+			///	ブロックに含まれるフレーム(開始フレームを除く)のチェックサムを連結したものの @a CRC32 。
+			uint32_t summary;
+		};
+		///	データフレーム以外のフレームの位置。
+		///	@details
+		///	圧縮フレームはブロックごとに、ブロックの最初のフレームのみを記録します。
+		struct Marker final
+		{
+		public:
+			///	フレームのインデックス。
+			uint64_t frame;
+			///	フレームの種類。
+			CDFSFrameTypes type;
+			///	圧縮フレームのブロック内での位置。(ブロックの最初のフレームのみを記録するため常に 0 )
+			uint16_t part;
+			///	圧縮フレームのブロックを構成するフレーム数。(圧縮フレーム以外は 0 )
+			uint16_t parts;
+			///	フレームまでに格納されたデータの大きさ。
+			///	@details
+			///	圧縮フレームの場合はブロックのデータを含めた大きさです。
+			UInt128 dataoffset;
+		};
+		///	データの位置に対応するフレームの位置。
+		struct Location final
+		{
+		public:
+			///	データを格納しているデータフレームのインデックス。(圧縮フレームの場合はブロックの最初のフレームのインデックス)
+			uint64_t frame;
+			///	データフレーム内でのデータの位置。(圧縮フレームの場合は展開したブロック内での位置)
+			size_t inner;
+		};
+	private:
+		size_t interval;
+		uint64_t framecount;
+		///	データフレームに格納されたデータの大きさ。(終了フレームを追加した時点で総サイズに置き換えます)
+		UInt128 datasize;
+		uint32_t headchecksum;
+		uint32_t finfchecksum;
+		bool complete;
+		std::vector<Checkpoint> checkpoints;
+		std::vector<Marker> markers;
+		///	最後のブロックのチェックサムの要約の計算途中の値。
+		CRC32 summary;
+		///	追加途中の圧縮フレームのブロックの展開後の大きさ。
+		size_t blockrawsize;
+		///	直前のチャンネル切り替えフレームが示したデータフレームの大きさ。
+		size_t declared;
+
+		///	指定されたチェックポイントから走査を始めるマーカーを取得します。
+		///	@details
+		///	チェックポイントが圧縮フレームのブロックの途中にある場合は、そのブロックのマーカーを返します。
+		std::vector<Marker>::const_iterator FirstMarker(const uint64_t& first) const;
+		///	指定されたマーカーが表すフレームの範囲の次のフレームを取得します。(圧縮フレームの場合はブロックの次のフレーム)
+		static uint64_t MarkerEnd(const Marker& marker) noexcept;
+		///	読み込んだチェックポイント・マーカーがフレーム数・総サイズと矛盾しないかを検証します。
+		///	@details
+		///	チェックポイントとマーカーのデータの位置は単調に増加し、総サイズを超えない必要があります。
+		///	マーカーのフレームは単調に増加し、圧縮フレームのブロックは次のマーカーと重ならずにフレーム数の範囲に収まる必要があります。
+		///	また、マーカーの間で増加するデータの大きさは、その間のデータフレーム(と圧縮フレームのブロック)に格納できる大きさを超えない必要があります。
+		bool IsConsistent() const noexcept;
+	public:
+		///	チェックポイントの間隔を指定して空の @a CDFSIndex を初期化します。
+		explicit CDFSIndex(const size_t& interval = DefaultInterval);
+
+		///	CDFSデータの次のフレームを索引に追加します。
+		///	@details
+		///	フレームはシーケンス番号の順に追加する必要があります。
+		///	既に追加したシーケンス番号の開始フレームは書き直されたものとみなし、開始フレームのチェックサムのみを更新します。
+		///	それ以外の順序に合わないフレームは無視します。
+		void Append(const CDFSFrame& frame);
+		///	CDFSデータの次のフレームを索引に追加します。
+		void Append(const Span<const CDFSFrame>& frames);
+
+		///	チェックポイントの間隔を取得します。
+		size_t Interval() const noexcept;
+		///	索引に追加されたフレーム数を取得します。
+		uint64_t FrameCount() const noexcept;
+		///	CDFSデータの総サイズを取得します。
+		///	@details
+		///	終了フレームを追加する前はデータフレームの数から求めた大きさを返します。
+		const UInt128& DataSize() const noexcept;
+		///	開始フレームのチェックサムを取得します。
+		uint32_t HEADChecksum() const noexcept;
+		///	終了フレームのチェックサムを取得します。
+		uint32_t FINFChecksum() const noexcept;
+		///	終了フレームまで追加されているかを取得します。
+		bool IsComplete() const noexcept;
+		///	チェックポイントの一覧を取得します。
+		const std::vector<Checkpoint>& Checkpoints() const noexcept;
+		///	データフレーム以外のフレームの一覧を取得します。
+		const std::vector<Marker>& Markers() const noexcept;
+
+		///	指定されたフレームより前に格納されたデータの大きさを求めます。
+		UInt128 DataOffset(const uint64_t& frame) const;
+		///	指定されたデータの位置を格納しているデータフレーム(または圧縮フレームのブロック)を求めます。
+		///	@return	データの位置が総サイズを超えている場合は @a std::nullopt 。
+		std::optional<Location> Locate(const UInt128& offset) const;
+		///	指定されたフレームの列が、索引に記録されたブロックと一致するかを検証します。
+		///	@param	block	ブロックのインデックス。
+		///	@param	frames	ブロックに含まれるすべてのフレーム。
+		bool VerifyBlock(const size_t& block, const Span<const CDFSFrame>& frames) const;
+		///	索引がCDFSデータの開始フレーム・終了フレームと対応しているかを取得します。
+		bool Matches(const CDFSFrame& head, const CDFSFrame& finf) const;
+
+		///	索引をストリームに書き込みます。
+		///	@return	書き込みに成功した場合は @a true 。
+		bool Write(std::ostream& stream) const;
+		///	ストリームから索引を読み込みます。
+		///	@return	索引として読み込めなかった場合や、内容が矛盾している場合は @a std::nullopt 。
+		static std::optional<CDFSIndex> Read(std::istream& stream);
+		///	CDFSデータを先頭から読み込み、索引を構築します。
+		///	@details
+		///	実行環境と異なるバイト順序のCDFSデータは、開始フレームから判定したバイト順序で変換しながら読み込みます。
+		///	@return	終了フレームまで読み込めなかった場合は @a std::nullopt 。
+		static std::optional<CDFSIndex> Build(std::istream& stream, const size_t& interval = DefaultInterval);
+	};
+}
+#endif // __cdfs_index__
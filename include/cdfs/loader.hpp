@@ -3,16 +3,28 @@
 //
 #ifndef __cdfs_loader__
 #define __cdfs_loader__
+#include <cstdint>
 #include <array>
 #include <vector>
 #include <optional>
 #include <iostream>
+#include <functional>
 #include "cdfs.hpp"
+#include "index.hpp"
+#include "counters.hpp"
 namespace zawa_ch::CDFS
 {
 	///	CDFSデータを読み出すための機能を提供します。
 	class CDFSLoader
 	{
+	public:
+		///	@a ReadData で一度に読み込むフレームの最大数。
+		static constexpr size_t BatchSize = 256;
+		///	@a Demultiplex で読み出したデータを受け取る関数。
+		///	@details
+		///	データのチャンネル・データの先頭・データの大きさを受け取ります。
+		///	データは読み込んだフレーム(または展開したブロック)を直接参照しているため、呼び出しから戻った後は使用できません。
+		typedef std::function<void(const uint32_t&, const uint8_t*, const size_t&)> ChannelConsumer;
 	private:
 		std::optional<CDFSFrame> buffer;
 		std::string label;
@@ -23,10 +35,149 @@ namespace zawa_ch::CDFS
 		bool readhead;
 		bool readfinf;
 		bool fault;
+		///	現在保持しているフレームの検証結果。
+		bool valid;
+		///	現在保持しているフレームが持つデータの大きさ。
+		size_t payloadsize;
+		///	先読みしたフレーム。
+		std::vector<CDFSFrame> batch;
+		///	先読みしたフレームのうち次に処理するフレームの位置。
+		size_t batchhead;
+		///	先読みしたフレームの数。
+		size_t batchtail;
+		///	読み出し途中のデータの位置。
+		const uint8_t* payload;
+		///	読み出し途中のデータの残りの大きさ。
+		size_t payloadremain;
+		///	開始フレームに記録されたハッシュ値の種類。
+		CDFSHashTypes hashtype;
+		///	読み込んだデータのハッシュ値。
+		XXH3 hash;
+		///	データのハッシュ値を計算中であるか。(データを先頭から順に読み込んでいる場合のみ計算します)
+		bool hashing;
+		///	ハッシュ値が終了フレームと一致しなかったか。
+		bool hashfault;
+		///	大きさが確定していないためハッシュ値への追加を保留しているデータ。
+		std::array<uint8_t, 240> hashpending;
+		///	ハッシュ値への追加を保留しているデータの大きさ。
+		size_t hashpendingsize;
+		///	読み出し途中のデータがハッシュ値に追加済みであるか。
+		bool payloadhashed;
+		///	CDFSデータの索引。
+		std::optional<CDFSIndex> index;
+		///	ストリーミングプロファイルで読み込むか。
+		bool streaming;
+		///	総サイズが分かっていないため @a ReadData での読み出しを保留しているデータフレームの内容。
+		///	@details
+		///	保留を解除したデータを読み出している間に次のデータフレームを保留するため、2つの領域を交互に使用します。
+		std::array<std::array<uint8_t, 240>, 2> withheld;
+		///	読み出しを保留しているデータの領域。
+		size_t withheldside;
+		///	読み出しを保留しているデータの大きさ。
+		size_t withheldsize;
+		///	読み出し途中のデータの次に読み出すデータの位置。
+		const uint8_t* nextpayload;
+		///	読み出し途中のデータの次に読み出すデータの大きさ。
+		size_t nextremain;
+		///	読み込み途中の圧縮フレームのブロック。
+		std::vector<uint8_t> blockdata;
+		///	読み込み途中のブロックの大きさ。
+		size_t blockdatasize;
+		///	次に読み込む圧縮フレームのブロック内での位置。
+		size_t blockpart;
+		///	展開したブロックの内容。
+		std::vector<uint8_t> blockraw;
+		///	現在のフレームが属するチャンネル。
+		std::optional<uint32_t> channel;
+		///	直前のチャンネル切り替えフレームが示した、次のデータフレームに格納されたデータの大きさ。(示されていない場合は 0 )
+		size_t declared;
+		///	読み出しを保留しているデータのチャンネル。
+		uint32_t withheldchannel;
+		///	開始フレームがデータフレームのみで構成されていることを示していたか。( @a CDFSHEADFrame::DenseFlag )
+		bool dense;
+		///	読み込んでいるCDFSデータのバイト順序。
+		CDFSByteOrder byteorder;
+		///	@a ReadNext で保留を解除した、現在保持しているフレームの時点で読み出せるデータ。(データフレームの内容を保留していない場合は @a std::nullopt )
+		std::optional<std::vector<uint8_t>> released;
+#if defined(CDFS_ENABLE_COUNTERS)
+		///	処理量と処理時間の計数。
+		CDFSCounters counters = CDFSCounters();
+		///	計数を受け取る関数。
+		CDFSCounterCallback countercallback;
+		///	先読みしたフレームのチェックサムの検証結果。
+		std::array<bool, BatchSize> batchintact = std::array<bool, BatchSize>();
+#endif
+
+		///	フレームを検証し、フレームの種類に応じて状態を更新します。
+		///	@param	hashpayload	データフレームの内容をハッシュ値に追加するか。
+		///	@details
+		///	@a hashpayload が false の場合でも、総サイズが分かっていない場合はハッシュ値に追加します。
+		///	追加しなかった場合は @a payloadhashed が false となり、呼び出し元で追加する必要があります。
+		void Accept(const CDFSFrame& frame, const bool& hashpayload = true);
+		///	データのハッシュ値の計算を最初からやり直します。
+		void ResetHash();
+		///	ストリームからフレームをまとめて先読みします。
+		///	@details
+		///	ストリーミングプロファイルでは、1フレームを読み込んだ後はストリームから待たずに読み込める分のみを読み込みます。
+		bool FillBatch(std::istream& stream);
+		///	先読みしたフレームのうち最後に処理したフレームを、現在のフレームとしてコピーして保持します。
+		///	@details
+		///	先読みしたフレームは @a FillBatch で上書きされるため、 @a FillBatch の呼び出し前と処理の終了時に呼び出します。
+		void KeepFrame();
+		///	@a ReadData で処理したフレームに応じて、保留しているデータの読み出しと次のデータフレームの保留を行います。
+		///	@details
+		///	総サイズが分かっていない場合、データフレームの内容は次のデータフレームまたは終了フレームが来るまで読み出しを保留します。
+		void Withhold(const CDFSFrame& frame);
+		///	圧縮フレームをブロックに追加し、ブロックが揃った場合は展開します。
+		///	@return	展開したデータの大きさ。ブロックが揃っていない場合や展開に失敗した場合は 0 。
+		size_t AcceptBlock(const CDFSFrame& frame);
+		///	フレームが持つデータの先頭を取得します。
+		///	@details
+		///	圧縮フレームの場合は展開したブロックの内容を返します。
+		const uint8_t* PayloadData(const CDFSFrame& frame) const noexcept;
+		///	読み込んだフレームを実行環境のバイト順序に変換します。
+		///	@details
+		///	開始フレームを読み込む前は、先頭のフレームが開始フレームであればそのフレームの種類からバイト順序を判定します。
+		void Normalize(CDFSFrame* frames, const size_t& count) noexcept;
+		///	ストリームからフレームを取得し、実行環境のバイト順序に変換します。
+		std::optional<CDFSFrame> ReadFrame(std::istream& stream);
+#if defined(CDFS_ENABLE_COUNTERS)
+		///	計数を受け取る関数が設定されている場合は、現在の計数を渡します。
+		void Report() const;
+		///	先読みしたフレームのチェックサムをまとめて検証します。
+		///	@details
+		///	検証時間をフレームごとに計測すると計測にかかる時間が検証と同程度になるため、先読みしたフレームは先読みごとに計測します。
+		void VerifyBatch();
+		///	フレームのチェックサムを検証します。
+		///	@details
+		///	先読みしたフレームは @a VerifyBatch の結果を使用します。
+		bool Verify(const CDFSFrame& frame);
+#endif
+
+		///	指定されたインデックスのフレームの位置にストリームをシークします。
+		static bool SeekStream(std::istream& stream, const UInt128& index);
+		///	ストリームの末尾から終了フレームを読み込み、総フレーム数と総サイズを取得します。
+		bool LoadFINF(std::istream& stream);
+		///	CDFSデータが開始フレーム・データフレーム・終了フレームのみで構成されているかを取得します。
+		///	@details
+		///	この場合、データの位置から対応するフレームの位置を直接求めることができます。
+		///	開始フレームの @a CDFSHEADFrame::DenseFlag を信頼し、フレームは読み込みません。(フレーム数と総サイズがフラグと矛盾する場合は @a false )
+		bool IsDenseLayout() const noexcept;
 	public:
 		///	@a CDFSLoader を初期化します。
 		CDFSLoader();
 
+		///	ストリーミングプロファイルでの読み込みを有効にします。
+		///	@details
+		///	パイプやソケットなどのシークできないストリームから、 @a ReadData で一定のメモリ量のまま読み出す場合に使用します。
+		///	@a ReadData はストリームから待たずに読み込める分のフレームのみを処理して戻るため、書き込み側が @a CDFSBuilder::Flush した時点までのデータを受け取れます。
+		///	ただし最後のデータフレームの大きさは終了フレームが来るまで分からないため、最新のデータフレームの内容は次のフレームが来るまで読み出しを保留します。
+		///	終了フレームに到達する前にストリームが終了した場合、保留しているデータは読み出されません。
+		///	@note
+		///	@a SeekToFrame / @a ReadAt / @a LoadIndex などのシークを伴う操作は使用できません。
+		void EnableStreaming();
+		///	ストリーミングプロファイルで読み込むかを取得します。
+		bool IsStreaming() const noexcept;
 		///	開始フレームが読み込まれたかを取得します。
 		bool HasHEAD() const;
 		///	終了フレームが読み込まれたかを取得します。
@@ -36,26 +187,125 @@ namespace zawa_ch::CDFS
 		///	現在読み込んでいるCDFSデータの総フレーム数を取得します。
 		const UInt128& FrameCount() const;
 		///	現在までに読み込まれたCDFSデータの総サイズを取得します。
+		///	@details
+		///	最後のデータフレームは総サイズに合わせて切り詰めた大きさで数えます。
 		const UInt128& DataIndex() const;
 		///	現在読み込んでいるCDFSデータの総サイズを取得します。
 		const UInt128& DataSize() const;
+		///	現在保持しているフレームが属するチャンネルを取得します。
+		///	@details
+		///	開始フレームの直後のチャンネルは 0 で、チャンネル切り替えのメタデータフレームを読み込むごとに切り替わります。
+		///	@return	フレームにシークした後、チャンネル切り替えフレームを読み込むまでの間など、チャンネルが分からない場合は @a std::nullopt 。
+		const std::optional<uint32_t>& Channel() const noexcept;
+		///	読み込んでいるCDFSデータのバイト順序を取得します。
+		///	@details
+		///	開始フレームから判定したバイト順序です。実行環境と異なるバイト順序のフレームは読み込み時に変換されるため、 @a GetFrame などで取得するフレームは常に実行環境のバイト順序となります。
+		const CDFSByteOrder& ByteOrder() const noexcept;
 		///	次のフレームを指定されたストリームから読み出します。
+		///	@details
+		///	開始フレームに総サイズが記録されていない場合、シーク可能なストリームでは開始フレームの読み込み時に終了フレームから総サイズを取得します。
+		///	取得できない場合(ストリーミングプロファイルなど)は、最後のデータフレームを総サイズに合わせて切り詰めるため @a ReadData と同様に各データフレームの内容を保留し、
+		///	@a GetData は保留を解除したデータ(直前のデータフレームの内容など)を返します。
 		bool ReadNext(std::istream& stream);
+		///	指定されたインデックスのフレームにシークし、読み出します。
+		///	@details
+		///	開始フレームが読み込まれていない場合は先に開始フレームを読み込みます。
+		///	シーク可能なストリームでのみ使用できます。
+		///	@return	フレームの読み出しに成功した場合は @a true 。
+		bool SeekToFrame(std::istream& stream, const UInt128& index);
+		///	CDFSデータの指定された位置から指定された大きさのデータを読み出します。
+		///	@details
+		///	索引を使用している場合は索引から、開始フレームがデータフレームのみで構成されていることを示している場合はデータの位置から直接フレームの位置を求め、
+		///	開始フレームと読み出しに必要なフレームのみを読み込みます。
+		///	いずれでもない場合(継続フレーム・圧縮フレームなどを含む場合や、ストリーミングプロファイルで書き込まれた場合など)は先頭から順にフレームを走査するため、
+		///	繰り返し読み出す場合は @a LoadIndex で索引を使用してください。
+		///	シーク可能なストリームでのみ使用できます。
+		///	@param	offset	読み出しを開始するデータの位置。
+		///	@param	buffer	読み出したデータの書き込み先。
+		///	@param	length	読み出すデータの大きさ。
+		///	@return	読み出したデータの大きさ。索引またはCDFSデータが不正で読み出し開始位置のデータを読み込めない場合は 0 。
+		size_t ReadAt(std::istream& stream, const UInt128& offset, uint8_t* buffer, const size_t& length);
+		///	CDFSデータの索引を読み込み、以降のシーク・読み出しに使用します。
+		///	@details
+		///	索引がCDFSデータの開始フレーム・終了フレームと対応しない場合は使用しません。
+		///	ストリームの読み込み位置は呼び出し前の位置に戻されます。
+		///	@param	stream	CDFSデータを読み込むストリーム。
+		///	@param	indexstream	索引を読み込むストリーム。
+		///	@return	索引を使用できる場合は @a true 。
+		bool LoadIndex(std::istream& stream, std::istream& indexstream);
+		///	CDFSデータを先頭から読み込んで索引を構築し、以降のシーク・読み出しに使用します。
+		///	@details
+		///	索引が存在しないか、 @a LoadIndex で使用できなかった場合に使用します。
+		///	ストリームの読み込み位置は呼び出し前の位置に戻されます。
+		///	@return	索引の構築に成功した場合は @a true 。
+		bool BuildIndex(std::istream& stream, const size_t& interval = CDFSIndex::DefaultInterval);
+		///	使用している索引を取得します。
+		const std::optional<CDFSIndex>& GetIndex() const noexcept;
+		///	索引に記録されたブロックを読み込み、内容が索引と一致するかを検証します。
+		///	@details
+		///	ストリームの読み込み位置は呼び出し前の位置に戻されます。
+		///	@return	索引を使用していない場合は @a std::nullopt 。
+		std::optional<bool> VerifyBlock(std::istream& stream, const size_t& block);
 		///	現在このオブジェクトがフレームを保持しているかを取得します。
 		bool HasValue() const noexcept;
 		///	現在保持しているフレームがCDFSフレームとして有効であるか取得します。
 		bool IsValidData() const noexcept;
+		///	次のフレーム以降に含まれるデータを指定されたバッファに読み出します。
+		///	@details
+		///	フレームを @a BatchSize 個ずつまとめて読み込み、データフレームの内容をバッファに直接コピーします。
+		///	データフレーム以外のフレームは読み飛ばし、最後のデータフレームは総サイズに合わせて切り詰めます。
+		///	圧縮フレームはブロックが揃った時点で展開し、その内容を読み出します。
+		///	開始フレームに総サイズが記録されていない場合は、最後のデータフレームを終了フレームの総サイズに合わせて切り詰めるため、
+		///	各データフレームの内容を次のデータフレームまたは終了フレームを読み込むまで保留します。
+		///	バッファを満たした時点で読み出しを中断し、残りのデータは次の呼び出しで読み出されます。
+		///	@return	読み出したデータの大きさ。終了フレームに到達した場合やストリームの終端に達した場合は @a capacity より小さくなります。
+		size_t ReadData(std::istream& stream, uint8_t* buffer, const size_t& capacity);
+		///	次のフレーム以降に含まれるデータを、チャンネルごとに分離して指定された関数に渡します。
+		///	@details
+		///	フレームを @a BatchSize 個ずつまとめて読み込み、データフレームの内容(または展開したブロックの内容)をコピーせずにそのまま @a consumer に渡します。
+		///	チャンネルは @a CDFSBuilder::SelectChannel で書き込まれたチャンネル切り替えのメタデータフレームから判断し、チャンネルを持たないCDFSデータはすべてチャンネル 0 として渡します。
+		///	開始フレームに総サイズが記録されていない場合は @a ReadData と同様に各データフレームの内容を次のデータフレームまたは終了フレームを読み込むまで保留するため、
+		///	保留したデータのみはコピーしたものを渡します。
+		///	終了フレームに到達するかストリームの終端に達するまで読み込みます。ストリーミングプロファイルでは、ストリームから待たずに読み込める分のフレームを処理した時点で戻ります。
+		///	@note
+		///	読み出し途中のデータ( @a ReadData で読み出しきれなかったもの)は破棄されます。
+		///	@return	@a consumer に渡したデータの大きさの合計。
+		size_t Demultiplex(std::istream& stream, const ChannelConsumer& consumer);
 		///	現在保持しているフレームに含まれるデータを取得します。
-		std::vector<uint8_t> GetData(const size_t& size = 240U) const;
+		///	@details
+		///	最後のデータフレームは総サイズに合わせて切り詰められます。
+		///	@a ReadNext でデータフレームの内容を保留している場合は、現在のフレームの時点で保留を解除したデータを取得します。
+		///	圧縮フレームの場合、ブロックの最後のフレームでは展開したブロックの内容を取得し、それ以外のフレームでは空のデータを取得します。
+		std::vector<uint8_t> GetData(const size_t& size = SIZE_MAX) const;
 		///	現在保持しているフレームを取得します。
 		const std::optional<CDFSFrame>& GetFrame() const;
 		///	読み込まれたCDFSデータの整合性をチェックします。
+		///	@details
+		///	終了フレームまで読み込み、フレーム数と読み出したデータの大きさが終了フレームと一致する場合に成功します。
+		///	開始フレームにハッシュ値の種類が記録されており、データを先頭から順に読み込んだ場合は終了フレームのハッシュ値も照合します。
 		std::optional<bool> CheckIntegrity() const;
+#if defined(CDFS_ENABLE_COUNTERS)
+		///	これまでに処理したフレームの処理量と処理時間の計数を取得します。
+		///	@details
+		///	フレームは検証して状態を更新した時点で数えます。( @a ReadData などで先読みしたが処理していないフレームは含みません)
+		///	チェックサムの検証時間は、 @a ReadData / @a Demultiplex では先読みしたフレームごとに、 @a ReadNext などではフレームごとに計測します。
+		///	ストリームの読み込み時間は @a LoadIndex などの索引の操作を含みません。
+		CDFSCounters Counters() const noexcept;
+		///	計数を 0 に戻します。
+		void ResetCounters() noexcept;
+		///	計数を受け取る関数を設定します。
+		///	@details
+		///	ストリームからフレームを読み込むたびに( @a BatchSize フレームごと、または個別に読み込むフレームごとに)と、終了フレームを処理した時点で呼び出されます。
+		///	空の関数を設定すると呼び出されなくなります。
+		void SetCounterCallback(const CDFSCounterCallback& callback);
+#endif
 
 		///	指定されたストリームからフレームを取得します。
 		static std::optional<CDFSFrame> ReadFrameFromStream(std::istream& stream);
 		///	ヘッダのCDFSフォーマットバージョンがこのライブラリで対応しているかを取得します。
 		static bool IsVersionCompatible(const CDFSHEADFrame& frame);
+		///	ヘッダのCDFSフォーマットバージョンがこのライブラリで対応しているかを取得します。
+		static bool IsVersionCompatible(const CDFSHEADView& frame) noexcept;
 		///	フレームのシーケンス番号を検証します。
 		static bool VerifySequence(const CDFSFrame& frame, const uint64_t& seq);
 	};
@@ -0,0 +1,105 @@
+//	cdfs/mappedloader
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_mappedloader__
+#define __cdfs_mappedloader__
+#include <string>
+#include "cdfs.hpp"
+#include "span.hpp"
+#include "framerange.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSファイルをメモリにマップして読み出すための機能を提供します。
+	///	@details
+	///	フレームおよびデータフレームの内容はマップされた領域を直接参照するため、読み出しの際にコピーは発生しません。
+	///	取得した @a Span はこのオブジェクトが閉じられるまで有効です。
+	///	実行環境と異なるバイト順序で書き込まれたファイルはマップした領域を直接参照できないため、開きません。
+	///	それらのファイルは、フレームを読み込むごとに変換する @a CDFSLoader で読み込んでください。
+	///	@note
+	///	この機能はPOSIX環境(mmap/madvise)でのみ使用できます。
+	class CDFSMappedLoader
+	{
+	public:
+		///	マップした領域へのアクセスパターンのヒント。
+		enum class AccessPatterns
+		{
+			///	特に指定しない。
+			Normal,
+			///	先頭から順にアクセスする。(先読みを積極的に行います)
+			Sequential,
+			///	ランダムにアクセスする。(先読みを抑制します)
+			Random,
+			///	近いうちにアクセスする。
+			WillNeed,
+			///	当面アクセスしない。
+			DontNeed,
+		};
+	private:
+		const uint8_t* mapping;
+		size_t length;
+		std::string label;
+		UInt128 framecount;
+		UInt128 datasize;
+		bool readhead;
+		bool readfinf;
+		///	マップされたフレーム列の範囲。
+		CDFSFrameRange range;
+
+		///	開始フレーム・終了フレームを読み込みます。
+		void LoadMetadata();
+	public:
+		///	ファイルを開かずに @a CDFSMappedLoader を初期化します。
+		CDFSMappedLoader();
+		///	指定されたファイルを開いて @a CDFSMappedLoader を初期化します。
+		explicit CDFSMappedLoader(const std::string& path);
+		CDFSMappedLoader(const CDFSMappedLoader&) = delete;
+		CDFSMappedLoader(CDFSMappedLoader&& other) noexcept;
+		CDFSMappedLoader& operator=(const CDFSMappedLoader&) = delete;
+		CDFSMappedLoader& operator=(CDFSMappedLoader&& other) noexcept;
+		~CDFSMappedLoader();
+
+		///	指定されたファイルをメモリにマップします。
+		///	@return	ファイルのマップに成功した場合は @a true 。実行環境と異なるバイト順序で書き込まれたファイルの場合は @a false 。
+		bool Open(const std::string& path);
+		///	マップしたファイルを閉じます。
+		void Close() noexcept;
+		///	ファイルがマップされているかを取得します。
+		bool IsOpen() const noexcept;
+
+		///	有効な開始フレームが読み込まれたかを取得します。
+		bool HasHEAD() const noexcept;
+		///	有効な終了フレームが読み込まれたかを取得します。
+		bool HasFINF() const noexcept;
+		///	CDFSデータに付けられたCDFSボリュームラベルを取得します。
+		const std::string& Label() const noexcept;
+		///	CDFSデータの総フレーム数を取得します。
+		const UInt128& FrameCount() const noexcept;
+		///	CDFSデータの総サイズを取得します。
+		const UInt128& DataSize() const noexcept;
+
+		///	マップされたファイルのバイト単位の大きさを取得します。
+		size_t Length() const noexcept;
+		///	マップされたフレーム数を取得します。
+		size_t Size() const noexcept;
+		///	マップされたすべてのフレームを取得します。
+		Span<const CDFSFrame> Frames() const noexcept;
+		///	マップされたフレーム列を先頭から順に参照する範囲を取得します。
+		///	@details
+		///	データフレームのデータは @a GetData と同様に切り詰められます。
+		const CDFSFrameRange& Range() const noexcept;
+		///	指定されたインデックスのフレームを取得します。
+		const CDFSFrame& GetFrame(const size_t& index) const noexcept;
+		///	指定されたインデックスのフレームに含まれるデータを取得します。
+		///	@details
+		///	最後のデータフレームはCDFSデータの総サイズに合わせて切り詰められます。(終了フレームの直前がチャンネル切り替えの場合を除く)
+		///	直前のチャンネル切り替えフレームが大きさを示している場合はその大きさに切り詰められます。
+		///	データフレームではない場合は空の @a Span を返します。
+		Span<const uint8_t> GetData(const size_t& index) const noexcept;
+
+		///	マップした領域全体へのアクセスパターンをカーネルに通知します。
+		bool Advise(const AccessPatterns& pattern) const noexcept;
+		///	指定された範囲のフレームへのアクセスパターンをカーネルに通知します。
+		bool Advise(const AccessPatterns& pattern, const size_t& index, const size_t& count) const noexcept;
+	};
+}
+#endif // __cdfs_mappedloader__
@@ -0,0 +1,130 @@
+//	cdfs/parallelbuilder
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_parallelbuilder__
+#define __cdfs_parallelbuilder__
+#include <array>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include "cdfs.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSデータを複数のスレッドで構築するための機能を提供します。
+	///	@details
+	///	データは呼び出し元のスレッドでブロック単位にまとめられ、ワーカースレッドでフレームヘッダーとチェックサムが計算された後、
+	///	書き込みスレッドでシーケンス順にストリームへ書き込まれます。
+	///	出力は同じ操作を行った @a CDFSBuilder の出力と一致します。
+	///	書き込み先のストリームは書き込みスレッドから操作されるため、 @a Flush を呼び出すまで他から操作しないでください。
+	class CDFSParallelBuilder
+	{
+	public:
+		///	1ブロックに含まれるフレームの最大数。
+		static constexpr size_t BlockSize = 256;
+	private:
+		///	処理単位となるフレームの列。
+		struct alignas(4096) Block final
+		{
+			///	ブロックに含まれるフレーム。
+			std::array<CDFSFrame, BlockSize> frames;
+			///	ブロックに含まれるフレーム数。
+			size_t count;
+			///	最後のフレームが保持するデータの大きさ。
+			size_t lastsize;
+			///	最初のフレームのシーケンス番号。
+			uint64_t sequence;
+			///	フレームが構築済みであるか。(データフレーム以外のフレームは呼び出し元のスレッドで構築されます)
+			bool prepared;
+			///	ワーカースレッドでの処理が完了したか。
+			bool done;
+		};
+
+		std::ostream& stream;
+		std::string label;
+		UInt128 frameindex;
+		UInt128 datasize;
+		bool wrotehead;
+		bool wrotefinf;
+		///	データを書き込み中のブロック。
+		Block* current;
+		///	書き込み中のフレームに書き込まれたデータの大きさ。
+		size_t fill;
+		///	書き込まれたデータのハッシュ値。(呼び出し元のスレッドで計算します)
+		XXH3 hash;
+
+		///	確保したすべてのブロック。
+		std::vector<std::unique_ptr<Block>> blocks;
+		///	使用されていないブロック。
+		std::vector<Block*> freeblocks;
+		///	ワーカースレッドの処理待ちのブロック。
+		std::deque<Block*> work;
+		///	書き込み待ちのブロック。(シーケンス順)
+		std::deque<Block*> order;
+		///	書き込みスレッドが書き込み中であるか。
+		bool writing;
+		///	スレッドの停止要求。
+		bool stopping;
+		std::mutex mutex;
+		std::condition_variable freeready;
+		std::condition_variable workready;
+		std::condition_variable writeready;
+		std::vector<std::thread> workers;
+		std::thread writer;
+
+		///	使用されていないブロックを取得します。(すべてのブロックが使用中の場合は空くまで待機します)
+		Block* Acquire();
+		///	ブロックを処理待ちとして送出します。
+		void Submit(Block* block);
+		///	データを書き込み中のブロックを送出します。(書き込み途中のフレームは新しいブロックに移します)
+		void SubmitCurrent();
+		///	構築済みのフレームを送出します。
+		void SubmitFrame(const CDFSFrame& frame);
+		///	ワーカースレッドの処理。
+		void WorkerLoop();
+		///	書き込みスレッドの処理。
+		void WriterLoop();
+		///	ブロックのフレームヘッダーとチェックサムを計算します。
+		static void Prepare(Block& block) noexcept;
+	public:
+		///	@a CDFSParallelBuilder を初期化します。
+		///	@param	stream	書き込み先のストリーム。
+		///	@param	label	CDFSボリュームラベル。
+		///	@param	threads	ワーカースレッド数。 0 の場合は実行環境のスレッド数を使用します。
+		///	@param	depth	同時に処理中にできるブロックの最大数。これを超えると書き込みは処理が追いつくまで待機します。 0 の場合はワーカースレッド数の2倍を使用します。
+		explicit CDFSParallelBuilder(std::ostream& stream, const std::string& label = std::string(), const size_t& threads = 0U, const size_t& depth = 0U);
+		CDFSParallelBuilder(const CDFSParallelBuilder&) = delete;
+		CDFSParallelBuilder& operator=(const CDFSParallelBuilder&) = delete;
+		///	書き込み待ちのブロックをすべて書き込み、スレッドを終了します。
+		~CDFSParallelBuilder();
+
+		///	CDFSデータに付けられたCDFSボリュームラベルを取得します。
+		const std::string& Label() const;
+		///	書き込まれているCDFSデータのシーケンス番号を取得します。
+		const UInt128& FrameIndex() const;
+		///	これまでに書き込まれたCDFSデータの総サイズを取得します。
+		const UInt128& DataSize() const;
+		///	ワーカースレッド数を取得します。
+		size_t Threads() const;
+		///	開始フレームを書き込みます。
+		void WriteHEADFrame();
+		///	開始フレームを書き込みます。
+		void WriteHEADFrame(const UInt128& framecount, const UInt128& datasize);
+		///	終了フレームを書き込みます。
+		void WriteFINFFrame();
+		///	継続フレームを書き込みます。
+		void WriteCONTFrame();
+		///	指定されたデータをデータフレームに分割して書き込みます。
+		///	@details
+		///	データフレームを満たさない残りのデータは次の書き込みまで保留され、終了フレームの書き込み時に最後のデータフレームとして書き込まれます。
+		void Write(const void* data, const size_t& size);
+		///	書き込み待ちのブロックがすべてストリームに書き込まれるまで待機し、ストリームをフラッシュします。
+		///	@note
+		///	データフレームを満たさないため保留しているデータは書き込まれません。
+		void Flush();
+	};
+}
+#endif // __cdfs_parallelbuilder__
@@ -0,0 +1,102 @@
+//	cdfs/recovery
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_recovery__
+#define __cdfs_recovery__
+#include <vector>
+#include <string>
+#include <optional>
+#include <iostream>
+#include "cdfs.hpp"
+namespace zawa_ch::CDFS
+{
+	///	復旧の際に読み飛ばした入力の範囲。
+	struct CDFSSkippedRange final
+	{
+	public:
+		///	読み飛ばした範囲の入力上の位置。
+		uint64_t offset;
+		///	読み飛ばした範囲の大きさ。
+		uint64_t size;
+	};
+	///	復旧できなかったフレームとデータの範囲。
+	struct CDFSRecoveryGap final
+	{
+	public:
+		///	失われた最初のフレームのシーケンス番号。
+		uint64_t frame;
+		///	失われたフレーム数。
+		uint64_t framecount;
+		///	失われたデータの復旧したデータ上の位置。
+		UInt128 dataoffset;
+		///	失われたデータの大きさ。
+		///	@details
+		///	失われた範囲の直後が継続フレーム(データサイズが記録されているもの)・終了フレームの場合はそれらに記録されたデータサイズから求め、
+		///	そうでない場合は失われたフレームをすべてデータフレームとみなして推定します。
+		UInt128 datasize;
+		///	失われたデータの大きさが記録されたデータサイズから求めたものか。
+		///	@details
+		///	推定した場合、失われたフレームにデータフレーム以外のフレームが含まれていると実際より大きくなり、
+		///	以降の復旧したデータ上の位置は元のデータ上の位置からずれます。
+		bool exact;
+	};
+	///	破損したCDFSデータの復旧の結果を表します。
+	struct CDFSRecoveryReport final
+	{
+	public:
+		///	走査した入力の大きさ。(終了フレームを復旧できた場合は終了フレームまでの大きさ)
+		uint64_t scanned;
+		///	復旧したフレーム数。
+		uint64_t frames;
+		///	フレームとして認識できず読み飛ばした入力の範囲。(昇順)
+		std::vector<CDFSSkippedRange> skipped;
+		///	復旧できなかったフレームとデータの範囲。(昇順)
+		std::vector<CDFSRecoveryGap> gaps;
+		///	開始フレームを復旧できたか。
+		bool hashead;
+		///	終了フレームを復旧できたか。
+		bool hasfinf;
+		///	開始フレームに記録されたラベル。
+		std::string label;
+		///	書き出したデータの大きさ。(失われたデータの範囲を埋めた分を含みます)
+		UInt128 datasize;
+		///	書き出したデータのハッシュ値が終了フレームと一致したか。
+		///	@details
+		///	開始フレームにハッシュ値の種類が記録されていない場合や、開始フレーム・終了フレームを復旧できなかった場合は @a std::nullopt 。
+		std::optional<bool> hashmatch;
+
+		///	CDFSデータ全体を欠落なく復旧できたかを取得します。
+		[[nodiscard]] bool IsComplete() const noexcept;
+	};
+
+	///	破損したCDFSデータからフレームを探し出し、データを復旧します。
+	class CDFSRecoveryScanner final
+	{
+		CDFSRecoveryScanner() = delete;
+		~CDFSRecoveryScanner() = delete;
+	public:
+		///	一度に入力から読み込む大きさ。
+		static constexpr size_t BlockSize = sizeof(CDFSFrame) * 16384U;
+
+		///	指定されたバイト列からCDFSフレームの種類のシグネチャ(HEAD/FINF/DATA/CONT/META/CMPR)を探します。
+		///	@details
+		///	SIMD命令を使用して1バイトずつずらした位置を一度に比較します。
+		///	@return	最初に見つかったシグネチャの位置。見つからなかった場合は @a size 。
+		static size_t FindSignature(const uint8_t* data, const size_t& size) noexcept;
+		///	ストリームからCDFSデータを読み込み、復旧できたデータを書き出します。
+		///	@details
+		///	フレームの位置が揃っている間はフレームをまとめて検証し、チェックサムまたはシーケンス番号が一致しないフレームが現れた場合は
+		///	以降のバイト列からシグネチャを探して、チェックサムとシーケンス番号が一致するフレームの位置に揃え直します。
+		///	シーケンス番号が飛んでいるフレームは、後続のフレームの検証にも成功した場合のみ受け入れます。
+		///	失われたデータの範囲は0で埋めて書き出すため、復旧したデータ上の位置は元のデータ上の位置と一致します。
+		///	(失われたデータの大きさを推定した範囲がある場合は @a CDFSRecoveryGap::exact を参照してください)
+		///	最後のデータフレームは終了フレームを復旧できた場合のみ総サイズに合わせて切り詰めます。
+		///	圧縮フレームのブロックはすべてのフレームを復旧できた場合のみ展開し、一部が失われたブロックはブロック全体を失われた範囲とします。
+		///	(その大きさはブロックの先頭のフレームを復旧できた場合のみ正確に求まります)
+		///	入力・出力ともに先頭から順に読み書きするため、シークできないストリームも使用できます。
+		///	@param	source	破損したCDFSデータを読み込むストリーム。
+		///	@param	payload	復旧したデータの書き込み先。
+		static CDFSRecoveryReport Recover(std::istream& source, std::ostream& payload);
+	};
+}
+#endif // __cdfs_recovery__
@@ -0,0 +1,68 @@
+//	cdfs/span
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_span__
+#define __cdfs_span__
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <type_traits>
+namespace zawa_ch::CDFS
+{
+	///	連続した要素の列を所有せずに参照します。
+	///	@details
+	///	参照先の要素の寿命は管理しないため、参照先が有効な間のみ使用できます。
+	template<typename T>
+	class Span final
+	{
+	public:
+		typedef T element_type;
+		typedef std::remove_cv_t<T> value_type;
+		typedef size_t size_type;
+		typedef T* pointer;
+		typedef T& reference;
+		typedef T* iterator;
+	private:
+		pointer pointer_;
+		size_type length;
+	public:
+		///	空の @a Span を作成します。
+		constexpr Span() noexcept : pointer_(), length() {}
+		///	先頭と要素数を指定して @a Span を作成します。
+		constexpr Span(pointer data, const size_type& size) noexcept : pointer_(data), length(size) {}
+		///	先頭と末尾を指定して @a Span を作成します。
+		constexpr Span(pointer begin, pointer end) noexcept : pointer_(begin), length(size_type(end - begin)) {}
+		///	配列を参照する @a Span を作成します。
+		template<size_t N>
+		constexpr Span(std::array<value_type, N>& array) noexcept : pointer_(array.data()), length(N) {}
+		///	配列を参照する @a Span を作成します。
+		template<size_t N, typename U = T, std::enable_if_t<std::is_const_v<U>, std::nullptr_t> = nullptr>
+		constexpr Span(const std::array<value_type, N>& array) noexcept : pointer_(array.data()), length(N) {}
+		///	@a std::vector を参照する @a Span を作成します。
+		template<typename Allocator>
+		Span(std::vector<value_type, Allocator>& vector) noexcept : pointer_(vector.data()), length(vector.size()) {}
+		///	@a std::vector を参照する @a Span を作成します。
+		template<typename Allocator, typename U = T, std::enable_if_t<std::is_const_v<U>, std::nullptr_t> = nullptr>
+		Span(const std::vector<value_type, Allocator>& vector) noexcept : pointer_(vector.data()), length(vector.size()) {}
+		///	要素の型が変更可能な @a Span から変換します。
+		template<typename U = T, std::enable_if_t<std::is_const_v<U>, std::nullptr_t> = nullptr>
+		constexpr Span(const Span<value_type>& other) noexcept : pointer_(other.data()), length(other.size()) {}
+
+		[[nodiscard]] constexpr pointer data() const noexcept { return pointer_; }
+		[[nodiscard]] constexpr size_type size() const noexcept { return length; }
+		[[nodiscard]] constexpr bool empty() const noexcept { return length == 0U; }
+		[[nodiscard]] constexpr iterator begin() const noexcept { return pointer_; }
+		[[nodiscard]] constexpr iterator end() const noexcept { return pointer_ + length; }
+		[[nodiscard]] constexpr reference operator[](const size_type& index) const noexcept { return pointer_[index]; }
+
+		///	この @a Span の一部分を参照する @a Span を取得します。
+		///	@details
+		///	範囲が @a Span の大きさを超える場合は末尾までに切り詰めます。
+		[[nodiscard]] constexpr Span Subspan(const size_type& offset, const size_type& count = size_type(-1)) const noexcept
+		{
+			if (length <= offset) { return Span(pointer_ + length, size_type(0U)); }
+			return Span(pointer_ + offset, ((length - offset) < count)?(length - offset):count);
+		}
+	};
+}
+#endif // __cdfs_span__
@@ -0,0 +1,87 @@
+//	cdfs/validator
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_validator__
+#define __cdfs_validator__
+#include <array>
+#include "cdfs.hpp"
+#include "span.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSフレームの種類の分類。
+	enum class CDFSFrameKinds : uint8_t
+	{
+		///	種類を特定できなかったフレーム。
+		Unknown = 0,
+		HEAD,
+		FINF,
+		DATA,
+		CONT,
+		META,
+		CMPR,
+	};
+
+	///	1フレーム分の検証結果を表します。
+	struct CDFSFrameStatus final
+	{
+	public:
+		///	チェックサムが一致していることを表すビット。
+		static constexpr uint8_t ChecksumBit = 0x01;
+		///	シーケンス番号が一致していることを表すビット。
+		static constexpr uint8_t SequenceBit = 0x02;
+		///	フレームの種類を格納するビット位置。
+		static constexpr uint8_t KindShift = 4;
+
+		///	検証結果のビット表現。
+		uint8_t value;
+
+		///	チェックサムが一致しているかを取得します。
+		[[nodiscard]] constexpr bool IsChecksumValid() const noexcept { return (value & ChecksumBit) != 0; }
+		///	シーケンス番号が一致しているかを取得します。
+		[[nodiscard]] constexpr bool IsSequenceValid() const noexcept { return (value & SequenceBit) != 0; }
+		///	チェックサムとシーケンス番号がともに一致しているかを取得します。
+		[[nodiscard]] constexpr bool IsValid() const noexcept { return (value & (ChecksumBit | SequenceBit)) == (ChecksumBit | SequenceBit); }
+		///	フレームの種類を取得します。
+		[[nodiscard]] constexpr CDFSFrameKinds Kind() const noexcept { return CDFSFrameKinds(value >> KindShift); }
+	};
+	static_assert(sizeof(CDFSFrameStatus) == 1, "CDFSFrameStatusの大きさが1バイトではありません。");
+
+	///	複数フレームの検証結果の集計を表します。
+	struct CDFSValidationSummary final
+	{
+	public:
+		///	フレームの種類ごとのフレーム数。( @a CDFSFrameKinds の値をインデックスとします)
+		std::array<size_t, 7> frames;
+		///	チェックサムが一致しなかったフレーム数。
+		size_t checksumfault;
+		///	シーケンス番号が一致しなかったフレーム数。
+		size_t sequencefault;
+
+		///	指定された種類のフレーム数を取得します。
+		[[nodiscard]] size_t Count(const CDFSFrameKinds& kind) const noexcept { return frames[size_t(kind)]; }
+		///	検証に失敗したフレームが存在しないかを取得します。
+		[[nodiscard]] bool IsValid() const noexcept { return (checksumfault == 0U)&&(sequencefault == 0U); }
+		///	他の集計結果をこの集計結果に加算します。
+		CDFSValidationSummary& operator+=(const CDFSValidationSummary& other) noexcept;
+	};
+
+	///	連続したCDFSフレームの検証と分類を一括して行います。
+	class CDFSValidator final
+	{
+		CDFSValidator() = delete;
+		~CDFSValidator() = delete;
+	public:
+		///	指定されたフレーム列を検証・分類します。
+		///	@param	frames	検証するフレーム列。
+		///	@param	sequence	@a frames の先頭フレームに期待するシーケンス番号。
+		///	@param	result	フレームごとの検証結果の書き込み先。 @a frames と同じ大きさが必要です。
+		///	@param	order	@a frames のバイト順序。( @a CDFSByteOrderConverter::Detect で開始フレームから判定します)
+		///	@return	検証結果の集計。
+		static CDFSValidationSummary Validate(const Span<const CDFSFrame>& frames, const uint64_t& sequence, const Span<CDFSFrameStatus>& result, const CDFSByteOrder& order = CDFSByteOrder::Native) noexcept;
+		///	指定されたフレーム列を検証・分類し、集計結果のみを返します。
+		static CDFSValidationSummary Validate(const Span<const CDFSFrame>& frames, const uint64_t& sequence, const CDFSByteOrder& order = CDFSByteOrder::Native) noexcept;
+		///	指定されたフレームの種類を分類します。
+		static CDFSFrameKinds Classify(const CDFSFrame& frame, const CDFSByteOrder& order = CDFSByteOrder::Native) noexcept;
+	};
+}
+#endif // __cdfs_validator__
@@ -0,0 +1,89 @@
+//	cdfs/verifier
+//	Copyright 2020 zawa-ch.
+//
+#ifndef __cdfs_verifier__
+#define __cdfs_verifier__
+#include <vector>
+#include <string>
+#include <optional>
+#include "cdfs.hpp"
+#include "span.hpp"
+#include "validator.hpp"
+namespace zawa_ch::CDFS
+{
+	///	CDFSデータ全体の整合性検証の結果を表します。
+	struct CDFSVerificationReport final
+	{
+	public:
+		///	検証したフレーム数。
+		size_t frames;
+		///	開始フレームから判定したCDFSデータのバイト順序。
+		CDFSByteOrder byteorder;
+		///	フレームの種類ごとの集計結果。
+		CDFSValidationSummary summary;
+		///	チェックサムまたはシーケンス番号の検証に失敗したフレームのインデックス。(昇順)
+		std::vector<size_t> badframes;
+		///	最初のフレームが有効な開始フレームであるか。
+		bool hashead;
+		///	最後のフレームが有効な終了フレームであるか。
+		bool hasfinf;
+		///	開始フレームに記録された総フレーム数。
+		UInt128 headcount;
+		///	開始フレームに記録された総サイズ。
+		UInt128 headsize;
+		///	終了フレームに記録された総フレーム数。
+		UInt128 finfcount;
+		///	終了フレームに記録された総サイズ。
+		UInt128 finfsize;
+		///	総フレーム数が開始フレーム・終了フレームの記録と一致しているか。
+		bool countmatch;
+		///	総サイズが開始フレーム・終了フレームの記録およびデータフレーム数・圧縮フレームのブロックの展開後の大きさと一致しているか。
+		bool sizematch;
+		///	開始フレームがデータフレームのみで構成されていることを示す場合( @a CDFSHEADFrame::DenseFlag )に、その通りに構成されているか。
+		bool layoutmatch;
+		///	展開に失敗した圧縮フレームのブロックの最初のフレームのインデックス。(昇順)
+		std::vector<size_t> badblocks;
+		///	圧縮フレームのブロックの展開後の大きさの合計。
+		UInt128 blocksize;
+		///	フレーム長に満たない末尾のデータの大きさ。
+		size_t trailing;
+		///	データフレームに格納されたデータ全体のCRC32ダイジェスト値。
+		///	@details
+		///	圧縮フレームのブロックは展開した内容をデータとして含めます。
+		///	総サイズが整合している場合は最後のデータフレームの余白を除いたデータ全体の値、
+		///	そうでない場合はデータフレームのデータ領域をすべて連結した値を表します。
+		uint32_t payloadcrc;
+
+		///	CDFSデータ全体が整合しているかを取得します。
+		[[nodiscard]] bool IsValid() const noexcept;
+	};
+
+	///	CDFSデータ全体の整合性を複数のスレッドで検証します。
+	class CDFSVerifier final
+	{
+		CDFSVerifier() = delete;
+		~CDFSVerifier() = delete;
+	public:
+		///	一度に検証するフレーム数。
+		static constexpr size_t ChunkSize = 16384;
+
+		///	指定されたフレーム列をCDFSデータ全体として検証します。
+		///	@details
+		///	フレーム列を @a ChunkSize フレームごとに分割し、チェックサムとシーケンス番号を並行して検証した後、
+		///	開始フレーム・終了フレームに記録されたフレーム数と総サイズを検証します。
+		///	データ全体のCRC32はチャンクごとに並行して計算したものを結合して求めます。
+		///	圧縮フレームのブロックは、最初のフレームを含むチャンクを検証するスレッドで展開します。
+		///	実行環境と異なるバイト順序のフレーム列は、実行環境のバイト順序に変換した複製を検証します。
+		///	@param	threads	使用するスレッド数。 0 の場合は実行環境のスレッド数を使用します。
+		static CDFSVerificationReport Verify(const Span<const CDFSFrame>& frames, const size_t& threads = 0U);
+#ifdef CDFS_HAS_MMAP
+		///	指定されたファイルをCDFSデータ全体として検証します。
+		///	@details
+		///	ファイルは @a CDFSMappedLoader でマップして検証します。
+		///	実行環境と異なるバイト順序のファイルはマップできないため、ファイル全体を読み込んで変換したものを検証します。(ファイルと同じ大きさのメモリを使用します)
+		///	@return	ファイルを開けなかった場合は @a std::nullopt 。
+		static std::optional<CDFSVerificationReport> VerifyFile(const std::string& path, const size_t& threads = 0U);
+#endif
+	};
+}
+#endif // __cdfs_verifier__
@@ -1,59 +1,298 @@
 //	zawa-ch/cdfs:/src/builder
 //	Copyright 2020 zawa-ch.
 //
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <vector>
 #include "cdfs/builder.hpp"
+#include "cdfs/loader.hpp"
 using namespace zawa_ch::CDFS;
 
-CDFSBuilder::CDFSBuilder() : label(), frameindex(), datasize(), wrotehead(), wrotefinf() {}
-CDFSBuilder::CDFSBuilder(const std::string& label) : label(label), frameindex(), datasize(), wrotehead(), wrotefinf() {}
+CDFSBuilder::CDFSBuilder() : label(), frameindex(), datasize(), wrotehead(), wrotefinf(), batch(), batchcount(), pending(), pendingsize(), hash(), hashtype(CDFSHashTypes::XXH3), index(), streaming(), compression(), block(), blocksize(), encoded(), channel(), openchannel(0U), multiplexed(), extended(), dense(true), channels() {}
+CDFSBuilder::CDFSBuilder(const std::string& label) : label(label), frameindex(), datasize(), wrotehead(), wrotefinf(), batch(), batchcount(), pending(), pendingsize(), hash(), hashtype(CDFSHashTypes::XXH3), index(), streaming(), compression(), block(), blocksize(), encoded(), channel(), openchannel(0U), multiplexed(), extended(), dense(true), channels() {}
 
 const std::string& CDFSBuilder::Label() const { return label; }
 const UInt128& CDFSBuilder::FrameIndex() const { return frameindex; }
 const UInt128& CDFSBuilder::DataSize() const { return datasize; }
-void CDFSBuilder::WriteHEADFrame(std::ostream& stream) { WriteHEADFrame(stream, frameindex + 1, datasize); }
+#if defined(CDFS_ENABLE_COUNTERS)
+CDFSCounters CDFSBuilder::Counters() const noexcept { return counters; }
+void CDFSBuilder::ResetCounters() noexcept { counters = CDFSCounters(); }
+void CDFSBuilder::SetCounterCallback(const CDFSCounterCallback& callback) { countercallback = callback; }
+#endif
+void CDFSBuilder::WriteHEADFrame(std::ostream& stream)
+{
+	// ストリーミングプロファイルでは開始フレームを書き直さないため、フレーム数・総サイズは記録しない
+	if (streaming) { WriteHEADFrame(stream, 0U, 0U); }
+	else { WriteHEADFrame(stream, frameindex + 1, datasize); }
+}
 void CDFSBuilder::WriteHEADFrame(std::ostream& stream, const UInt128& framecount, const UInt128& datasize)
 {
+	// 書き込み待ちのデータフレームを先に書き込む
+	FlushBatch(stream);
 	///	書き込むCDFS開始フレーム
-	CDFSHEADFrame frame = CDFSHEADFrame();
-	// コンストラクタを明示的に呼び出し、内容をすべて0でフィルしておく
-	frame.sequence() = 0U;
-	frame.data_version() = CDFS::FormatVersion;
-	frame.data_count() = framecount;
-	// ボリュームラベルのコピー
-	// データ境界を超えないようイテレータを使ってC/P
-	{
-		///	source iterator
-		auto si = label.cbegin();
-		///	destination iterator
-		auto di = frame.data_label().begin();
-		///	source end
-		auto se = label.cend();
-		///	destination end
-		auto de = frame.data_label().end();
-		while((si != se)&&(di != de)) { *(di++) = *(si++); }
-	}
-	frame.data_size() = datasize;
-	frame.Validate();
+	// 最初の書き込みでは以降に書き込むフレームが分からないため、対応している最新のバージョンを記録する
+	auto version = wrotehead?RequiredVersion():CDFS::FormatVersion;
+	// 終了フレームまでデータフレームのみで構成されていればその旨を記録する
+	// (フラグの領域は 0x00000100 では予約済みのため、そのバージョンでは記録しない)
+	auto layout = (wrotefinf)&&(dense)&&(!extended)&&(CDFS::BaseFormatVersion < version)&&(framecount == (((datasize + 239U) / 240U) + 2U));
+	auto frame = BuildHEADFrame(label, framecount, datasize, hashtype, version, layout?CDFSHEADFrame::DenseFlag:0U);
 	// ストリーム書き込み
-	WriteToStream(stream, frame.Frame());
+	WriteFrame(stream, frame.Frame());
 	// 開始フレーム書き込みフラグを立てる
 	wrotehead = true;
 	if (!wrotefinf) { ++frameindex; }
 }
+bool CDFSBuilder::Resume(std::iostream& stream, const bool& rehash)
+{
+	// 書き込み待ち・保留しているデータは破棄する
+	batchcount = 0U;
+	pendingsize = 0U;
+	blocksize = 0U;
+	channels.clear();
+	stream.clear();
+	stream.seekg(0, std::ios_base::end);
+	auto end = stream.tellg();
+	if ((stream.fail())||(end < std::streamoff(sizeof(CDFSFrame)))) { return false; }
+	///	ストリームに含まれるフレーム数
+	auto count = uint64_t(end / std::streamoff(sizeof(CDFSFrame)));
+	///	フレームの読み込みに使用するバッファ
+	auto frames = std::vector<CDFSFrame>(BatchSize);
+	///	指定された位置から指定された数のフレームを読み込む
+	auto read = [&](const uint64_t& first, const size_t& length) -> bool
+	{
+		stream.clear();
+		stream.seekg(std::streamoff(first * sizeof(CDFSFrame)), std::ios_base::beg);
+		stream.read((std::istream::char_type*)frames.data(), std::streamsize(sizeof(CDFSFrame) * length));
+		return size_t(stream.gcount()) == (sizeof(CDFSFrame) * length);
+	};
+	// 開始フレームの検証
+	if (!read(0U, 1U)) { return false; }
+	if ((!CDFSHEADFrame::IsHEADFrame(frames[0]))||(!frames[0].IsValid())||(!CDFSLoader::VerifySequence(frames[0], 0U))) { return false; }
+	auto head = CDFSHEADFrame(frames[0]);
+	if (!CDFSLoader::IsVersionCompatible(head)) { return false; }
+	// 最後の有効なフレームを末尾の @a BatchSize フレームから探す
+	// (書き込み途中で中断された末尾のフレームは破棄して上書きする)
+	///	最後の有効なフレーム
+	auto last = count;
+	{
+		auto length = (count < BatchSize)?size_t(count):BatchSize;
+		auto first = count - length;
+		if (!read(first, length)) { return false; }
+		for (auto i = length; i != 0U; i--)
+		{
+			if ((frames[i - 1U].IsValid())&&(CDFSLoader::VerifySequence(frames[i - 1U], first + i - 1U))) { last = first + i - 1U; break; }
+		}
+		// ブロックの途中で中断された圧縮フレームはブロックの先頭から破棄する
+		if ((last != count)&&(CDFSCMPRFrame::IsCMPRFrame(frames[last - first])))
+		{
+			auto cmpr = CDFSCMPRView(frames[last - first]);
+			if ((cmpr.data_part() + 1U) != cmpr.data_parts())
+			{
+				if (last <= cmpr.data_part()) { return false; }
+				last -= cmpr.data_part() + 1U;
+			}
+		}
+	}
+	if (last == count) { return false; }
+	// 最後の有効なフレームから、データサイズが記録された継続フレームまたは開始フレームまでのデータフレームを数える
+	///	数えたデータフレームより前のデータサイズ
+	auto base = UInt128(0U);
+	///	数えたデータフレームの数
+	uint64_t datacount = 0U;
+	///	数えた圧縮フレームのブロックの展開後の大きさ
+	auto rawsize = UInt128(0U);
+	///	大きさが示されたデータフレームが満たしていないデータの大きさ
+	uint64_t shortfall = 0U;
+	///	チャンネル切り替えフレームが含まれていたか
+	auto chanfound = false;
+	///	直後のフレームの種類
+	auto following = CDFSFrameTypes::FINF;
+	auto found = false;
+	for (auto tail = last + 1U; (!found)&&(tail != 1U);)
+	{
+		auto length = ((tail - 1U) < BatchSize)?size_t(tail - 1U):BatchSize;
+		auto first = tail - length;
+		if (!read(first, length)) { return false; }
+		for (auto i = length; (!found)&&(i != 0U); i--)
+		{
+			const auto& frame = frames[i - 1U];
+			if ((!frame.IsValid())||(!CDFSLoader::VerifySequence(frame, first + i - 1U))) { return false; }
+			switch (frame.frametype)
+			{
+			case CDFSFrameTypes::DATA: { ++datacount; break; }
+			case CDFSFrameTypes::CMPR:
+			{
+				// 展開後の大きさはブロックの先頭のフレームに記録されている
+				auto cmpr = CDFSCMPRView(frame);
+				if (cmpr.data_part() == 0U)
+				{
+					auto size = CDFSCompression::DecodedSize(cmpr.data_content().data(), cmpr.data_content().size());
+					if (!size.has_value()) { return false; }
+					rawsize += *size;
+				}
+				break;
+			}
+			// 終了フレームが書き込まれている場合は再開できない
+			case CDFSFrameTypes::FINF: { return false; }
+			case CDFSFrameTypes::CONT:
+			{
+				auto cont = CDFSCONTView(frame);
+				if (cont.data_size() != 0U)
+				{
+					base = cont.data_size();
+					found = true;
+				}
+				break;
+			}
+			case CDFSFrameTypes::META:
+			{
+				// 直後のデータフレームの大きさが示されている場合は満たしていない分を差し引く
+				auto size = CDFSMETAFrame::DeclaredSize(frame);
+				if ((size != 0U)&&(following == CDFSFrameTypes::DATA)) { shortfall += frame.data.size() - size; }
+				if (CDFSMETAFrame::IsCHANFrame(frame)) { chanfound = true; }
+				break;
+			}
+			default: { break; }
+			}
+			following = frame.frametype;
+		}
+		tail = first;
+	}
+	// ラベルとハッシュ値の種類を開始フレームから復元する
+	const auto& headlabel = head.data_label();
+	label = std::string(headlabel.data(), std::find(headlabel.begin(), headlabel.end(), '\0'));
+	hashtype = head.data_hashtype();
+	hash = XXH3();
+	// 遡らなかったフレームの内容は分からないため、開始フレームのバージョンから拡張の使用を推定する
+	extended = (head.data_version() > CDFS::BaseFormatVersion)||(chanfound)||(rawsize != 0U);
+	dense = false;
+	if (hashtype == CDFSHashTypes::XXH3)
+	{
+		if (rehash)
+		{
+			// 書き込み済みのデータを先頭から読み直してハッシュ値を復元する
+			///	展開中の圧縮フレームのブロック
+			auto encodedblock = std::vector<uint8_t>();
+			///	展開したブロックの内容
+			auto rawblock = std::vector<uint8_t>(CDFSCompression::BlockSize);
+			///	直前のフレームが示したデータフレームの大きさ
+			size_t declared = 0U;
+			for (uint64_t first = 1U; first <= last;)
+			{
+				auto length = ((last + 1U - first) < BatchSize)?size_t(last + 1U - first):BatchSize;
+				if (!read(first, length)) { return false; }
+				for (size_t i = 0; i < length; i++)
+				{
+					if (!frames[i].IsValid()) { return false; }
+					if (CDFSDATAFrame::IsDATAFrame(frames[i])) { hash.Push(frames[i].data.data(), frames[i].data.data() + ((declared != 0U)?declared:frames[i].data.size())); }
+					declared = CDFSMETAFrame::DeclaredSize(frames[i]);
+					if (CDFSCMPRFrame::IsCMPRFrame(frames[i]))
+					{
+						auto cmpr = CDFSCMPRView(frames[i]);
+						if (cmpr.data_part() == 0U) { encodedblock.clear(); }
+						encodedblock.insert(encodedblock.end(), cmpr.data_content().begin(), cmpr.data_content().end());
+						if ((cmpr.data_part() + 1U) == cmpr.data_parts())
+						{
+							auto size = CDFSCompression::DecodeBlock(encodedblock.data(), encodedblock.size(), rawblock.data());
+							if (!size.has_value()) { return false; }
+							hash.Push(rawblock.data(), rawblock.data() + *size);
+						}
+					}
+				}
+				first += length;
+			}
+		}
+		else
+		{
+			// ハッシュ値を復元できないため、開始フレームをハッシュ値を持たないものとして書き直す
+			hashtype = CDFSHashTypes::None;
+			stream.clear();
+			stream.seekp(0, std::ios_base::beg);
+			WriteToStream(stream, BuildHEADFrame(label, head.data_count(), head.data_size(), hashtype, RequiredVersion()).Frame());
+		}
+	}
+	frameindex = last + 1U;
+	datasize = base + (UInt128(datacount) * 240U) - shortfall + rawsize;
+	wrotehead = true;
+	wrotefinf = false;
+	// チャンネル切り替えフレームが含まれていた場合は、多重化したまま最初のフレームの前にチャンネルを示す
+	channel = 0U;
+	multiplexed = chanfound;
+	openchannel = multiplexed?std::nullopt:std::optional<uint32_t>(0U);
+	// 索引は途中から構築できないため破棄する
+	index.reset();
+	// 最後の有効なフレームの直後から書き込みを再開する
+	stream.clear();
+	stream.seekp(std::streamoff((last + 1U) * sizeof(CDFSFrame)), std::ios_base::beg);
+	return !stream.fail();
+}
+uint32_t CDFSBuilder::RequiredVersion() const noexcept
+{
+	if (streaming) { return CDFS::FormatVersion; }
+	return ((hashtype != CDFSHashTypes::None)||(extended))?CDFS::FormatVersion:CDFS::BaseFormatVersion;
+}
+void CDFSBuilder::EnableIndex(const size_t& interval) { index = CDFSIndex(interval); }
+const std::optional<CDFSIndex>& CDFSBuilder::GetIndex() const noexcept { return index; }
+void CDFSBuilder::EnableStreaming() { streaming = true; }
+bool CDFSBuilder::IsStreaming() const noexcept { return streaming; }
+void CDFSBuilder::SetCompression(const uint32_t& level) { compression = (level < CDFSCompression::MaxLevel)?level:CDFSCompression::MaxLevel; }
+uint32_t CDFSBuilder::Compression() const noexcept { return compression; }
+void CDFSBuilder::SelectChannel(std::ostream& stream, const uint32_t& channel)
+{
+	if ((wrotefinf)||(channel == this->channel)) { return; }
+	if (!multiplexed)
+	{
+		// 多重化を開始する前に保留しているデータはハッシュ値に追加済みのため、多重化を開始する前に書き込む
+		// (データフレームを満たさないデータはその大きさを示して書き込む)
+		if (pendingsize != 0U)
+		{
+			PushCHANFrame(stream, uint32_t(pendingsize));
+			openchannel.reset();
+		}
+		PushPending(stream);
+		PushBlock(stream);
+		multiplexed = true;
+	}
+	// 現在のチャンネルの保留しているデータを退避し、切り替え先のチャンネルの保留しているデータを復元する
+	// (頻繁に切り替えても確保し直さないよう、チャンネルの領域は削除せずに使い回す)
+	auto& parked = channels[this->channel];
+	std::memcpy(parked.pending.data(), pending.data(), pendingsize);
+	parked.pendingsize = pendingsize;
+	parked.block.swap(block);
+	parked.blocksize = blocksize;
+	auto& next = channels[channel];
+	std::memcpy(pending.data(), next.pending.data(), next.pendingsize);
+	pendingsize = next.pendingsize;
+	block.swap(next.block);
+	blocksize = next.blocksize;
+	next.pendingsize = 0U;
+	next.blocksize = 0U;
+	this->channel = channel;
+}
+uint32_t CDFSBuilder::Channel() const noexcept { return channel; }
 void CDFSBuilder::WriteFINFFrame(std::ostream& stream)
 {
 	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
 	if ((!wrotehead)||(wrotefinf)) { return; }
+	// 保留しているデータを最後のデータフレームとして書き込む
+	// (多重化している場合はチャンネルごとに書き込む)
+	if (multiplexed)
+	{
+		PushChannels(stream, true);
+		// 終了フレームの直前のチャンネル切り替えで、最後のデータフレームを切り詰めないことを示す
+		PushCHANFrame(stream, 0U);
+	}
+	else
+	{
+		PushPending(stream);
+		PushBlock(stream);
+	}
+	FlushBatch(stream);
 	///	書き込むCDFS終了フレーム
-	CDFSFINFFrame frame = CDFSFINFFrame();
-	frame.sequence() = uint64_t(frameindex);
-	frame.data_count() = frameindex + 1;
-	// TODO: チェックサムの仕様策定と実装
-	// frame.data_hash;
-	frame.data_size() = datasize;
-	frame.Validate();
+	auto frame = (hashtype == CDFSHashTypes::XXH3)?BuildFINFFrame(frameindex, datasize, hash.GetValue()):BuildFINFFrame(frameindex, datasize);
 	// ストリーム書き込み
-	WriteToStream(stream, frame.Frame());
+	WriteFrame(stream, frame.Frame());
 	// 終了フレーム書き込みフラグを立てる
 	wrotefinf = true;
 }
@@ -61,27 +300,328 @@ void CDFSBuilder::WriteDATAFrame(std::ostream& stream, const ContainsType& data,
 {
 	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
 	if ((!wrotehead)||(wrotefinf)) { return; }
+	// データの順序を保つため、保留しているデータを先に書き込む
+	PushPending(stream);
+	PushBlock(stream);
+	if ((datasize % 240U) != 0U) { dense = false; }
+	if (multiplexed)
+	{
+		// データフレームを満たさない場合はチャンネル切り替えフレームでその大きさを示す
+		auto declared = size < data.size();
+		if ((declared)||(openchannel != channel)) { PushCHANFrame(stream, declared?uint32_t(size):0U); }
+		openchannel = declared?std::nullopt:std::optional<uint32_t>(channel);
+	}
+	FlushBatch(stream);
 	///	書き込むCDFSデータフレーム
 	CDFSDATAFrame frame = CDFSDATAFrame();
 	frame.sequence() = uint64_t(frameindex);
 	frame.data() = data;
-	frame.Validate();
+	{
+#if defined(CDFS_ENABLE_COUNTERS)
+		auto timer = CDFSCounterTimer(counters.crctime);
+#endif
+		frame.Validate();
+	}
+#if defined(CDFS_ENABLE_COUNTERS)
+	counters.data.bytes += size;
+#endif
 	// ストリーム書き込み
-	WriteToStream(stream, frame.Frame());
+	WriteFrame(stream, frame.Frame());
 	if ((wrotehead)&&(!wrotefinf))
 	{
 		++frameindex;
 		datasize += size;
+		hash.Push(data.data(), data.data() + size);
 	}
 }
 void CDFSBuilder::WriteCONTFrame(std::ostream& stream)
 {
 	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
 	if ((!wrotehead)||(wrotefinf)) { return; }
+	// 書き込み待ちのデータフレームを先に書き込む
+	// (保留しているデータはデータの順序に影響しないため保留したままにする)
+	FlushBatch(stream);
+	///	書き込むCDFS継続フレーム
+	auto frame = BuildCONTFrame(frameindex, label, datasize);
+	// ストリーム書き込み
+	WriteFrame(stream, frame.Frame());
+	if ((wrotehead)&&(!wrotefinf)) { ++frameindex; }
+	dense = false;
+	// 多重化している場合、再開時にチャンネルを復元できるよう次のフレームの前にチャンネルを示す
+	if (multiplexed) { openchannel.reset(); }
+}
+void CDFSBuilder::Write(std::ostream& stream, const void* data, const size_t& size)
+{
+	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
+	if ((!wrotehead)||(wrotefinf)) { return; }
+	// 書き込むデータがない場合は data が nullptr の場合があるため、コピーを行わずに終了
+	if (size == 0U) { return; }
+	auto current = (const uint8_t*)data;
+	auto remain = size;
+	if (compression != 0U)
+	{
+		if (block.empty()) { block.resize(CDFSCompression::BlockSize); }
+		// データフレームは最後のもの以外を切り詰められないため、データフレームとして保留しているデータはブロックに移す
+		// (保留しているデータはハッシュ値に追加済み、圧縮を保留しているデータとは同時に存在しない)
+		if (pendingsize != 0U)
+		{
+			std::memcpy(block.data() + blocksize, pending.data(), pendingsize);
+			blocksize += pendingsize;
+			pendingsize = 0U;
+		}
+		while (remain != 0U)
+		{
+			auto count = ((block.size() - blocksize) < remain)?(block.size() - blocksize):remain;
+			std::memcpy(block.data() + blocksize, current, count);
+			if (!multiplexed) { hash.Push(current, current + count); }
+			blocksize += count;
+			current += count;
+			remain -= count;
+			if (blocksize == block.size()) { PushBlock(stream); }
+		}
+		return;
+	}
+	// データの順序を保つため、圧縮を保留しているデータを先に書き込む
+	PushBlock(stream);
+	// ハッシュ値はデータフレームをまとめた単位で、データがキャッシュにあるうちに計算する
+	///	ハッシュ値の計算が済んだ位置
+	// (多重化している場合はフレームの構築時に計算する)
+	auto end = current + size;
+	auto hashed = (multiplexed)?end:current;
+	// 保留しているデータがある場合は先に1フレーム分を満たす
+	if (pendingsize != 0U)
+	{
+		auto count = ((pending.size() - pendingsize) < remain)?(pending.size() - pendingsize):remain;
+		std::memcpy(pending.data() + pendingsize, current, count);
+		pendingsize += count;
+		current += count;
+		remain -= count;
+		if (pendingsize == pending.size()) { PushPending(stream); }
+	}
+	// フレームを満たすデータは直接データフレームとして構築する
+	while (pending.size() <= remain)
+	{
+		if (hashed < (current + pending.size()))
+		{
+			auto count = ((pending.size() * BatchSize) < size_t(end - hashed))?(pending.size() * BatchSize):size_t(end - hashed);
+			hash.Push(hashed, hashed + count);
+			hashed += count;
+		}
+		PushDATAFrame(stream, current, pending.size());
+		current += pending.size();
+		remain -= pending.size();
+	}
+	hash.Push(hashed, end);
+	// 残りのデータは保留する
+	if (remain != 0U)
+	{
+		std::memcpy(pending.data(), current, remain);
+		pendingsize = remain;
+	}
+}
+void CDFSBuilder::Write(std::ostream& stream, const uint32_t& channel, const void* data, const size_t& size)
+{
+	SelectChannel(stream, channel);
+	Write(stream, data, size);
+}
+void CDFSBuilder::Flush(std::ostream& stream)
+{
+	if (multiplexed) { PushChannels(stream, false); }
+	else { PushBlock(stream); }
+	FlushBatch(stream);
+#if defined(CDFS_ENABLE_COUNTERS)
+	auto timer = CDFSCounterTimer(counters.iotime);
+#endif
+	stream.flush();
+}
+
+void CDFSBuilder::PushDATAFrame(std::ostream& stream, const uint8_t* data, const size_t& size)
+{
+	if (multiplexed)
+	{
+		// データフレームを満たさない場合はチャンネル切り替えフレームでその大きさを示す
+		auto declared = size < pending.size();
+		if ((declared)||(openchannel != channel)) { PushCHANFrame(stream, declared?uint32_t(size):0U); }
+		openchannel = declared?std::nullopt:std::optional<uint32_t>(channel);
+		hash.Push(data, data + size);
+	}
+	if (!batch) { batch = std::make_unique<FrameBatch>(); }
+	// 240バイトを満たさないデータフレームの後にデータフレームが続く場合は、データの位置からフレームの位置を求められない
+	if ((datasize % 240U) != 0U) { dense = false; }
+	auto& frame = batch->frames[batchcount++];
+	frame.sequence = uint64_t(frameindex);
+	frame.frametype = CDFSFrameTypes::DATA;
+	std::memcpy(frame.data.data(), data, size);
+	std::memset(frame.data.data() + size, 0, frame.data.size() - size);
+	// チェックサムはバッファの書き込み時にまとめて計算する
+	++frameindex;
+	datasize += size;
+#if defined(CDFS_ENABLE_COUNTERS)
+	++counters.data.frames;
+	counters.data.bytes += size;
+#endif
+	if (batchcount == BatchSize) { FlushBatch(stream); }
+}
+void CDFSBuilder::PushPending(std::ostream& stream)
+{
+	if (pendingsize == 0U) { return; }
+	PushDATAFrame(stream, pending.data(), pendingsize);
+	pendingsize = 0U;
+}
+void CDFSBuilder::PushBlock(std::ostream& stream)
+{
+	if (blocksize == 0U) { return; }
+	// ブロックは圧縮フレームの格納領域の倍数になるよう0で埋める
+	if (encoded.empty()) { encoded.resize(CDFSCompression::FrameCount(CDFSCompression::MaxEncodedSize) * CDFSCMPRFrame::ContentSize); }
+	auto size = CDFSCompression::EncodeBlock(block.data(), blocksize, encoded.data(), compression);
+	auto parts = CDFSCompression::FrameCount(size);
+	std::memset(encoded.data() + size, 0, (parts * CDFSCMPRFrame::ContentSize) - size);
+	if (multiplexed)
+	{
+		if (openchannel != channel) { PushCHANFrame(stream, 0U); }
+		openchannel = channel;
+		hash.Push(block.data(), block.data() + blocksize);
+	}
+	if (!batch) { batch = std::make_unique<FrameBatch>(); }
+	extended = true;
+	for (size_t i = 0; i < parts; i++)
+	{
+		auto frame = CDFSCMPRFrame();
+		frame.sequence() = uint64_t(frameindex);
+		frame.data_part(uint16_t(i));
+		frame.data_parts(uint16_t(parts));
+		std::memcpy(frame.data_content().data(), encoded.data() + (i * CDFSCMPRFrame::ContentSize), CDFSCMPRFrame::ContentSize);
+		// チェックサムはバッファの書き込み時にまとめて計算する
+		batch->frames[batchcount++] = frame.Frame();
+		++frameindex;
+		if (batchcount == BatchSize) { FlushBatch(stream); }
+	}
+#if defined(CDFS_ENABLE_COUNTERS)
+	counters.cmpr.frames += parts;
+	counters.cmpr.bytes += blocksize;
+#endif
+	datasize += blocksize;
+	blocksize = 0U;
+}
+void CDFSBuilder::PushCHANFrame(std::ostream& stream, const uint32_t& length)
+{
+	if (!batch) { batch = std::make_unique<FrameBatch>(); }
+	auto frame = CDFSMETAFrame();
+	frame.sequence() = uint64_t(frameindex);
+	frame.data_type(CDFSMetaTypes::CHAN);
+	frame.data_channel(channel);
+	frame.data_length(length);
+	// チェックサムはバッファの書き込み時にまとめて計算する
+	batch->frames[batchcount++] = frame.Frame();
+	++frameindex;
+	extended = true;
+#if defined(CDFS_ENABLE_COUNTERS)
+	++counters.meta.frames;
+#endif
+	if (batchcount == BatchSize) { FlushBatch(stream); }
+}
+void CDFSBuilder::PushChannels(std::ostream& stream, const bool& pending)
+{
+	///	現在のチャンネル
+	auto current = channel;
+	///	保留しているデータを持つチャンネル
+	auto targets = std::vector<uint32_t>{ current };
+	for (const auto& item : channels)
+	{
+		if ((item.second.blocksize != 0U)||((pending)&&(item.second.pendingsize != 0U))) { targets.push_back(item.first); }
+	}
+	for (const auto& target : targets)
+	{
+		SelectChannel(stream, target);
+		if (pending) { PushPending(stream); }
+		PushBlock(stream);
+	}
+	SelectChannel(stream, current);
+}
+void CDFSBuilder::FlushBatch(std::ostream& stream)
+{
+	if (batchcount == 0U) { return; }
+	// 書き込み待ちのフレームのチェックサムをまとめて計算する
+	auto begins = std::array<const uint8_t*, BatchSize>();
+	auto checksums = std::array<uint32_t, BatchSize>();
+	for (size_t i = 0; i < batchcount; i++) { begins[i] = (const uint8_t*)&batch->frames[i]; }
+	{
+#if defined(CDFS_ENABLE_COUNTERS)
+		auto timer = CDFSCounterTimer(counters.crctime);
+#endif
+		CRC32::Calculate(begins.data(), offsetof(CDFSFrame, checksum), checksums.data(), batchcount);
+	}
+	for (size_t i = 0; i < batchcount; i++) { batch->frames[i].checksum = checksums[i]; }
+	// ストリーム書き込み
+	{
+#if defined(CDFS_ENABLE_COUNTERS)
+		auto timer = CDFSCounterTimer(counters.iotime);
+#endif
+		auto sentry = std::ostream::sentry(stream);
+		if (bool(sentry))
+		{
+			stream.write((const std::ostream::char_type*)batch->frames.data(), std::streamsize(sizeof(CDFSFrame) * batchcount));
+		}
+	}
+	if (index.has_value()) { index->Append(Span<const CDFSFrame>(batch->frames.data(), batchcount)); }
+	batchcount = 0U;
+#if defined(CDFS_ENABLE_COUNTERS)
+	Report();
+#endif
+}
+
+CDFSHEADFrame CDFSBuilder::BuildHEADFrame(const std::string& label, const UInt128& framecount, const UInt128& datasize, const CDFSHashTypes& hashtype, const uint32_t& version, const uint32_t& flags)
+{
+	///	書き込むCDFS開始フレーム
+	CDFSHEADFrame frame = CDFSHEADFrame();
+	// コンストラクタを明示的に呼び出し、内容をすべて0でフィルしておく
+	frame.sequence() = 0U;
+	frame.data_version(version);
+	frame.data_count(framecount);
+	// ボリュームラベルのコピー
+	// データ境界を超えないようイテレータを使ってC/P
+	{
+		///	source iterator
+		auto si = label.cbegin();
+		///	destination iterator
+		auto di = frame.data_label().begin();
+		///	source end
+		auto se = label.cend();
+		///	destination end
+		auto de = frame.data_label().end();
+		while((si != se)&&(di != de)) { *(di++) = *(si++); }
+	}
+	frame.data_size(datasize);
+	frame.data_hashtype(hashtype);
+	frame.data_flags(flags);
+	frame.Validate();
+	return frame;
+}
+CDFSFINFFrame CDFSBuilder::BuildFINFFrame(const UInt128& frameindex, const UInt128& datasize)
+{
+	///	書き込むCDFS終了フレーム
+	CDFSFINFFrame frame = CDFSFINFFrame();
+	frame.sequence() = uint64_t(frameindex);
+	frame.data_count(frameindex + 1);
+	frame.data_size(datasize);
+	frame.Validate();
+	return frame;
+}
+CDFSFINFFrame CDFSBuilder::BuildFINFFrame(const UInt128& frameindex, const UInt128& datasize, const XXH3::ValueType& hash)
+{
+	///	書き込むCDFS終了フレーム
+	CDFSFINFFrame frame = BuildFINFFrame(frameindex, datasize);
+	// ハッシュ値はハッシュ値の格納領域の先頭から詰めて格納する
+	std::memcpy(frame.data_hash().data(), hash.data(), hash.size());
+	frame.Validate();
+	return frame;
+}
+CDFSCONTFrame CDFSBuilder::BuildCONTFrame(const UInt128& frameindex, const std::string& label, const UInt128& datasize)
+{
 	///	書き込むCDFS継続フレーム
 	CDFSCONTFrame frame = CDFSCONTFrame();
 	frame.sequence() = uint64_t(frameindex);
-	frame.data_current() = frameindex;
+	frame.data_current(frameindex);
 	// ボリュームラベルのコピー
 	// データ境界を超えないようイテレータを使ってC/P
 	{
@@ -95,12 +635,42 @@ void CDFSBuilder::WriteCONTFrame(std::ostream& stream)
 		auto de = frame.data_label().end();
 		while((si != se)&&(di != de)) { *(di++) = *(si++); }
 	}
+	frame.data_size(datasize);
 	frame.Validate();
-	// ストリーム書き込み
-	WriteToStream(stream, frame.Frame());
-	if ((wrotehead)&&(!wrotefinf)) { ++frameindex; }
+	return frame;
+}
+CDFSMETAFrame CDFSBuilder::BuildCHANFrame(const UInt128& frameindex, const uint32_t& channel, const uint32_t& length)
+{
+	///	書き込むCDFSメタデータフレーム
+	CDFSMETAFrame frame = CDFSMETAFrame();
+	frame.sequence() = uint64_t(frameindex);
+	frame.data_type(CDFSMetaTypes::CHAN);
+	frame.data_channel(channel);
+	frame.data_length(length);
+	frame.Validate();
+	return frame;
 }
 
+void CDFSBuilder::WriteFrame(std::ostream& stream, const CDFSFrame& frame)
+{
+	{
+#if defined(CDFS_ENABLE_COUNTERS)
+		auto timer = CDFSCounterTimer(counters.iotime);
+#endif
+		WriteToStream(stream, frame);
+	}
+	if (index.has_value()) { index->Append(frame); }
+#if defined(CDFS_ENABLE_COUNTERS)
+	++counters.Of(frame.frametype).frames;
+	Report();
+#endif
+}
+#if defined(CDFS_ENABLE_COUNTERS)
+void CDFSBuilder::Report() const
+{
+	if (countercallback) { countercallback(counters); }
+}
+#endif
 void CDFSBuilder::WriteToStream(std::ostream& stream, const CDFSFrame& frame)
 {
 	auto sentry = std::ostream::sentry(stream);
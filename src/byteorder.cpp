@@ -0,0 +1,262 @@
+//	zawa-ch/cdfs:/src/byteorder
+//	Copyright 2020 zawa-ch.
+//
+#include <array>
+#include <cstring>
+#include "cdfs/byteorder.hpp"
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define CDFS_BYTEORDER_SSSE3 1
+#include <immintrin.h>
+#endif
+using namespace zawa_ch::CDFS;
+
+namespace
+{
+	typedef CDFSFrameLayout<CDFSByteOrderConverter::Foreign> ForeignFrame;
+	typedef CDFSHEADLayout<CDFSByteOrderConverter::Foreign> ForeignHEAD;
+	typedef CDFSFINFLayout<CDFSByteOrderConverter::Foreign> ForeignFINF;
+	typedef CDFSCONTLayout<CDFSByteOrderConverter::Foreign> ForeignCONT;
+	typedef CDFSCMPRLayout<CDFSByteOrderConverter::Foreign> ForeignCMPR;
+	typedef CDFSMETALayout<CDFSByteOrderConverter::Foreign> ForeignMETA;
+	typedef CDFSFrameLayout<> NativeFrame;
+	typedef CDFSHEADLayout<> NativeHEAD;
+	typedef CDFSFINFLayout<> NativeFINF;
+	typedef CDFSCONTLayout<> NativeCONT;
+	typedef CDFSCMPRLayout<> NativeCMPR;
+	typedef CDFSMETALayout<> NativeMETA;
+
+	///	フレームの種類ごとの、変換するフィールドを含む先頭からの範囲(チェックサムを除く)
+	constexpr size_t CommonExtent = NativeFrame::FrameType::Position + NativeFrame::FrameType::Size;
+	constexpr size_t HEADExtent = NativeHEAD::HashType::Position + NativeHEAD::HashType::Size;
+	constexpr size_t FINFExtent = NativeFINF::DataSize::Position + NativeFINF::DataSize::Size;
+	constexpr size_t CONTExtent = NativeCONT::DataSize::Position + NativeCONT::DataSize::Size;
+	constexpr size_t CMPRExtent = NativeCMPR::Parts::Position + NativeCMPR::Parts::Size;
+	constexpr size_t METAExtent = NativeMETA::Length::Position + NativeMETA::Length::Size;
+	static_assert(FINFExtent == CONTExtent, "終了フレームと継続フレームの変換範囲が一致しません。");
+	static_assert((FINFExtent <= HEADExtent)&&(CMPRExtent <= HEADExtent)&&(METAExtent <= HEADExtent), "開始フレームの変換範囲が最大ではありません。");
+
+	///	フレームの種類に対応する変換範囲を取得する
+	constexpr size_t Extent(const CDFSFrameTypes& type) noexcept
+	{
+		switch (type)
+		{
+		case CDFSFrameTypes::HEAD: { return HEADExtent; }
+		case CDFSFrameTypes::FINF: { return FINFExtent; }
+		case CDFSFrameTypes::CONT: { return CONTExtent; }
+		case CDFSFrameTypes::CMPR: { return CMPRExtent; }
+		case CDFSFrameTypes::META: { return METAExtent; }
+		default: { return CommonExtent; }
+		}
+	}
+
+	///	フィールドを異なるバイト順序で書き直す
+	template<typename To, typename From>
+	inline void Reorder(uint8_t* frame) noexcept { To::Store(frame, From::Load(frame)); }
+
+	///	先頭から一定の範囲のみが変化したフレームの、チェックサムの変化量を求める
+	///	@details
+	///	CRC32は同じ長さのデータに対して線形であるため、変化量は変化した範囲の差分のCRC32(初期値・最終XORなし)をチェックサムの手前まで0で延長したものになる。
+	///	0での延長は x^(8n) mod P の乗算であり、これも線形であるため範囲ごとにバイト単位の表を用意しておく。
+	class ChecksumShift final
+	{
+	private:
+		std::array<std::array<uint32_t, 256>, 4> table;
+		size_t extent;
+	public:
+		explicit ChecksumShift(const size_t& extent) noexcept : table(), extent(extent)
+		{
+			std::array<uint32_t, 32> basis;
+			for (size_t i = 0; i < basis.size(); i++) { basis[i] = CRC32::Combine(uint32_t(1) << i, 0U, uint64_t(NativeFrame::Checksum::Position - extent)); }
+			for (size_t n = 0; n < table.size(); n++)
+			{
+				for (size_t v = 0; v < 256; v++)
+				{
+					auto value = uint32_t(0U);
+					for (size_t b = 0; b < 8; b++) { if ((v >> b) & 1U) { value ^= basis[(n * 8U) + b]; } }
+					table[n][v] = value;
+				}
+			}
+		}
+		///	変換前後のフレームの先頭からチェックサムの変化量を求める
+		[[nodiscard]] uint32_t Apply(const uint8_t* before, const uint8_t* after) const noexcept
+		{
+			std::array<uint8_t, HEADExtent> difference;
+			for (size_t i = 0; i < extent; i++) { difference[i] = uint8_t(before[i] ^ after[i]); }
+			auto crc = CRC32(0U);
+			crc.Push(difference.data(), difference.data() + extent);
+			auto raw = crc.GetValue() ^ 0xFFFFFFFF;
+			return table[0][raw & 0xFF] ^ table[1][(raw >> 8) & 0xFF] ^ table[2][(raw >> 16) & 0xFF] ^ table[3][raw >> 24];
+		}
+	};
+
+	///	チェックサムの補正に使用するデータセット
+	struct Dataset final
+	{
+		ChecksumShift common = ChecksumShift(CommonExtent);
+		ChecksumShift head = ChecksumShift(HEADExtent);
+		ChecksumShift tail = ChecksumShift(FINFExtent);
+		ChecksumShift cmpr = ChecksumShift(CMPRExtent);
+		ChecksumShift meta = ChecksumShift(METAExtent);
+
+		[[nodiscard]] const ChecksumShift& Shift(const CDFSFrameTypes& type) const noexcept
+		{
+			switch (type)
+			{
+			case CDFSFrameTypes::HEAD: { return head; }
+			case CDFSFrameTypes::FINF:
+			case CDFSFrameTypes::CONT: { return tail; }
+			case CDFSFrameTypes::CMPR: { return cmpr; }
+			case CDFSFrameTypes::META: { return meta; }
+			default: { return common; }
+			}
+		}
+	};
+
+	///	チェックサムを実行環境のバイト順序で書き直し、変換したフィールドに合わせて補正する
+	inline void Reseal(uint8_t* frame, const uint8_t* before, const ChecksumShift& shift) noexcept
+	{
+		Reorder<NativeFrame::Checksum, ForeignFrame::Checksum>(frame);
+		NativeFrame::Checksum::Store(frame, NativeFrame::Checksum::Load(frame) ^ shift.Apply(before, frame));
+	}
+
+	///	1フレームを実行環境のバイト順序に変換する
+	void SwapScalar(uint8_t* frame, const Dataset& data) noexcept
+	{
+		auto type = ForeignFrame::FrameType::Load(frame);
+		std::array<uint8_t, HEADExtent> before;
+		std::memcpy(before.data(), frame, Extent(type));
+		Reorder<NativeFrame::Sequence, ForeignFrame::Sequence>(frame);
+		Reorder<NativeFrame::FrameType, ForeignFrame::FrameType>(frame);
+		switch (type)
+		{
+		case CDFSFrameTypes::HEAD:
+		{
+			Reorder<NativeHEAD::Version, ForeignHEAD::Version>(frame);
+			Reorder<NativeHEAD::Count, ForeignHEAD::Count>(frame);
+			Reorder<NativeHEAD::DataSize, ForeignHEAD::DataSize>(frame);
+			Reorder<NativeHEAD::HashType, ForeignHEAD::HashType>(frame);
+			break;
+		}
+		case CDFSFrameTypes::FINF:
+		{
+			Reorder<NativeFINF::Count, ForeignFINF::Count>(frame);
+			Reorder<NativeFINF::DataSize, ForeignFINF::DataSize>(frame);
+			break;
+		}
+		case CDFSFrameTypes::CONT:
+		{
+			Reorder<NativeCONT::Current, ForeignCONT::Current>(frame);
+			Reorder<NativeCONT::DataSize, ForeignCONT::DataSize>(frame);
+			break;
+		}
+		case CDFSFrameTypes::CMPR:
+		{
+			Reorder<NativeCMPR::Part, ForeignCMPR::Part>(frame);
+			Reorder<NativeCMPR::Parts, ForeignCMPR::Parts>(frame);
+			break;
+		}
+		case CDFSFrameTypes::META:
+		{
+			Reorder<NativeMETA::Type, ForeignMETA::Type>(frame);
+			Reorder<NativeMETA::Channel, ForeignMETA::Channel>(frame);
+			Reorder<NativeMETA::Length, ForeignMETA::Length>(frame);
+			break;
+		}
+		default: { break; }
+		}
+		Reseal(frame, before.data(), data.Shift(type));
+	}
+#if defined(CDFS_BYTEORDER_SSSE3)
+	// SSSE3の実装はフィールドの配置を16バイト単位の並べ替えとして扱う
+	static_assert((NativeFrame::Sequence::Position == 0U)&&(NativeFrame::Sequence::Size == 8U)&&(NativeFrame::FrameType::Position == 8U)&&(NativeFrame::FrameType::Size == 4U), "フレームの基本構造の配置が並べ替えと一致しません。");
+	static_assert((NativeHEAD::Version::Position == 12U)&&(NativeMETA::Type::Position == 12U)&&(NativeCMPR::Part::Position == 12U)&&(NativeCMPR::Parts::Position == 14U), "フレームの内容の先頭の配置が並べ替えと一致しません。");
+	static_assert((NativeHEAD::Count::Position == 16U)&&(NativeFINF::Count::Position == 16U)&&(NativeCONT::Current::Position == 16U), "フレーム数の配置が並べ替えと一致しません。");
+	static_assert((NativeHEAD::DataSize::Position == 64U)&&(NativeFINF::DataSize::Position == 64U)&&(NativeCONT::DataSize::Position == 64U), "総サイズの配置が並べ替えと一致しません。");
+	static_assert((NativeMETA::Channel::Position == 16U)&&(NativeMETA::Length::Position == 20U), "チャンネル切り替えの配置が並べ替えと一致しません。");
+
+	///	16バイトを指定された並べ替えで書き直す
+	__attribute__((target("ssse3")))
+	inline void Shuffle(uint8_t* position, const __m128i& mask) noexcept
+	{
+		auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(position), _mm_shuffle_epi8(value, mask));
+	}
+	///	1フレームを実行環境のバイト順序に変換する(SSSE3)
+	///	@details
+	///	シーケンス番号・フレームの種類とフレームの内容の先頭4バイトを1回の並べ替えで、 @a UInt128 のフィールドを下位・上位の8バイトごとの反転で変換する
+	__attribute__((target("ssse3")))
+	void SwapSSSE3(uint8_t* frame, const Dataset& data) noexcept
+	{
+		///	シーケンス番号・フレームの種類のみ
+		const auto common = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 12, 13, 14, 15);
+		///	シーケンス番号・フレームの種類と、続く4バイトの値
+		const auto word = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 15, 14, 13, 12);
+		///	シーケンス番号・フレームの種類と、続く2バイトの値2つ
+		const auto halves = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 13, 12, 15, 14);
+		///	16バイトの値(下位・上位の8バイトの順序は変わらない)
+		const auto whole = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+		///	4バイトの値2つ
+		const auto pair = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 8, 9, 10, 11, 12, 13, 14, 15);
+		auto type = ForeignFrame::FrameType::Load(frame);
+		std::array<uint8_t, HEADExtent> before;
+		std::memcpy(before.data(), frame, Extent(type));
+		switch (type)
+		{
+		case CDFSFrameTypes::HEAD:
+		{
+			Shuffle(frame, word);
+			Shuffle(frame + NativeHEAD::Count::Position, whole);
+			Shuffle(frame + NativeHEAD::DataSize::Position, whole);
+			Reorder<NativeHEAD::HashType, ForeignHEAD::HashType>(frame);
+			break;
+		}
+		case CDFSFrameTypes::FINF:
+		case CDFSFrameTypes::CONT:
+		{
+			Shuffle(frame, common);
+			Shuffle(frame + NativeFINF::Count::Position, whole);
+			Shuffle(frame + NativeFINF::DataSize::Position, whole);
+			break;
+		}
+		case CDFSFrameTypes::CMPR: { Shuffle(frame, halves); break; }
+		case CDFSFrameTypes::META:
+		{
+			Shuffle(frame, word);
+			Shuffle(frame + NativeMETA::Channel::Position, pair);
+			break;
+		}
+		default: { Shuffle(frame, common); break; }
+		}
+		Reseal(frame, before.data(), data.Shift(type));
+	}
+	///	実行環境でSSSE3が使用できるか
+	bool ByteOrderSupportsSSSE3() noexcept
+	{
+		static const bool supported = []
+		{
+			__builtin_cpu_init();
+			return bool(__builtin_cpu_supports("ssse3"));
+		}();
+		return supported;
+	}
+#endif
+}
+
+void CDFSByteOrderConverter::Swap(CDFSFrame* frames, const size_t& count) noexcept
+{
+	static const Dataset data;
+#if defined(CDFS_BYTEORDER_SSSE3)
+	if (ByteOrderSupportsSSSE3())
+	{
+		for (size_t i = 0; i < count; i++) { SwapSSSE3(frames[i].Bytes(), data); }
+		return;
+	}
+#endif
+	for (size_t i = 0; i < count; i++) { SwapScalar(frames[i].Bytes(), data); }
+}
+std::optional<CDFSByteOrder> CDFSByteOrderConverter::Detect(const CDFSFrame& frame) noexcept
+{
+	if (NativeFrame::FrameType::Load(frame.Bytes()) == CDFSFrameTypes::HEAD) { return CDFSByteOrder::Native; }
+	if (ForeignFrame::FrameType::Load(frame.Bytes()) == CDFSFrameTypes::HEAD) { return Foreign; }
+	return std::nullopt;
+}
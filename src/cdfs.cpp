@@ -1,6 +1,7 @@
 //	zawa-ch/cdfs:/src/cdfs
 //	Copyright 2020 zawa-ch.
 //
+#include <cstddef>
 #include "cdfs/cdfs.hpp"
 using namespace zawa_ch::CDFS;
 
@@ -9,6 +10,50 @@ static_assert(sizeof(CDFSHEADFrame) == 256, "CDFSHEADFrameの大きさが256バ
 static_assert(sizeof(CDFSFINFFrame) == 256, "CDFSFINFFrameの大きさが256バイトではありません。");
 static_assert(sizeof(CDFSDATAFrame) == 256, "CDFSDATAFrameの大きさが256バイトではありません。");
 static_assert(sizeof(CDFSCONTFrame) == 256, "CDFSCONTFrameの大きさが256バイトではありません。");
+static_assert(sizeof(CDFSCMPRFrame) == 256, "CDFSCMPRFrameの大きさが256バイトではありません。");
+static_assert(sizeof(CDFSMETAFrame) == 256, "CDFSMETAFrameの大きさが256バイトではありません。");
+static_assert(CDFSFrameLayout<>::Size == sizeof(CDFSFrame), "CDFSFrameLayoutの大きさがCDFSFrameと一致しません。");
+static_assert(CDFSFrameLayout<>::FrameType::Position == offsetof(CDFSFrame, frametype), "CDFSFrameLayoutの配置がCDFSFrameと一致しません。");
+static_assert(CDFSFrameLayout<>::Data::Position == offsetof(CDFSFrame, data), "CDFSFrameLayoutの配置がCDFSFrameと一致しません。");
+static_assert(CDFSFrameLayout<>::Checksum::Position == offsetof(CDFSFrame, checksum), "CDFSFrameLayoutの配置がCDFSFrameと一致しません。");
+static_assert(CDFSHEADLayout<>::Flags::Position + CDFSHEADLayout<>::Flags::Size <= CDFSFrameLayout<>::Checksum::Position, "CDFSHEADLayoutがフレームの内容に収まっていません。");
+static_assert(CDFSCMPRLayout<>::Content::Position + CDFSCMPRLayout<>::Content::Size == CDFSFrameLayout<>::Checksum::Position, "CDFSCMPRLayoutがフレームの内容に収まっていません。");
+static_assert(CDFSCMPRLayout<>::Content::Size == CDFSCMPRFrame::ContentSize, "CDFSCMPRLayoutの大きさがCDFSCMPRFrameと一致しません。");
+
+namespace
+{
+	///	定数式の中で開始フレームを構築します。
+	template<CDFSByteOrder Order>
+	constexpr CDFSFrameImage BuildHEADImage(const UInt128& framecount, const UInt128& datasize) noexcept
+	{
+		auto image = CDFSFrameImage();
+		CDFSFrameLayout<Order>::Sequence::Store(image.data(), 0U);
+		CDFSFrameLayout<Order>::FrameType::Store(image.data(), CDFSFrameTypes::HEAD);
+		CDFSHEADLayout<Order>::Version::Store(image.data(), CDFS::FormatVersion);
+		CDFSHEADLayout<Order>::Count::Store(image.data(), framecount);
+		CDFSHEADLayout<Order>::DataSize::Store(image.data(), datasize);
+		CDFSHEADLayout<Order>::HashType::Store(image.data(), CDFSHashTypes::XXH3);
+		CDFSFrameLayout<Order>::Seal(image.data());
+		return image;
+	}
+	///	定数式の中で構築した開始フレームを解析し、構築時の値と一致するか検証します。
+	template<CDFSByteOrder Order>
+	constexpr bool VerifyHEADImage(const UInt128& framecount, const UInt128& datasize) noexcept
+	{
+		auto image = BuildHEADImage<Order>(framecount, datasize);
+		return (CDFSFrameLayout<Order>::Verify(image.data()))
+			&&(CDFSFrameLayout<Order>::FrameType::Load(image.data()) == CDFSFrameTypes::HEAD)
+			&&(CDFSHEADLayout<Order>::Version::Load(image.data()) == CDFS::FormatVersion)
+			&&(CDFSHEADLayout<Order>::Count::Load(image.data()) == framecount)
+			&&(CDFSHEADLayout<Order>::DataSize::Load(image.data()) == datasize)
+			&&(CDFSHEADLayout<Order>::HashType::Load(image.data()) == CDFSHashTypes::XXH3);
+	}
+}
+static_assert(VerifyHEADImage<CDFSByteOrder::Little>(3U, (UInt128(1U) << 100) | 240U), "リトルエンディアンのフレームを定数式の中で構築・解析できません。");
+static_assert(VerifyHEADImage<CDFSByteOrder::Big>(3U, (UInt128(1U) << 100) | 240U), "ビッグエンディアンのフレームを定数式の中で構築・解析できません。");
+static_assert(BuildHEADImage<CDFSByteOrder::Little>(0U, 0U)[8] == 0x53, "リトルエンディアンのフレームの種類が下位バイトから格納されていません。");
+static_assert(BuildHEADImage<CDFSByteOrder::Big>(0U, 0U)[8] == 0x43, "ビッグエンディアンのフレームの種類が上位バイトから格納されていません。");
+static_assert((BuildHEADImage<CDFSByteOrder::Big>(3U, 0U)[CDFSHEADLayout<>::Count::Position + 7U] == 3U)&&(BuildHEADImage<CDFSByteOrder::Big>(UInt128(1U) << 64, 0U)[CDFSHEADLayout<>::Count::Position + 15U] == 1U), "ビッグエンディアンの128ビットの値が下位64ビットから格納されていません。");
 
 uint32_t CDFS::GetLibraryVersion() noexcept
 {
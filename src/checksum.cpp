@@ -1,13 +1,32 @@
 //	zawa-ch/cdfs:/src/checksum
 //	Copyright 2020 zawa-ch.
 //
+#include <cstring>
 #include "cdfs/checksum.hpp"
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define CDFS_CRC32_CLMUL 1
+#define CDFS_XXH3_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 using namespace zawa_ch::CDFS;
 
 // TODO: 実装上手くいっていない可能性があるため、実装の再確認と修正
 
 CRC32::Dataset CRC32::data;
 
+namespace
+{
+	///	指定された位置から4バイトをリトルエンディアンの整数として読み出します。
+	///	(ホストのバイト順序によらず同じ結果を返し、リトルエンディアン環境では単一のロード命令になります)
+	inline uint32_t LoadLE32(const uint8_t* p) noexcept
+	{
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+}
+
 CRC32::Dataset::Dataset()
 {
 	// CRC-32 (反転)
@@ -22,11 +41,675 @@ CRC32::Dataset::Dataset()
 		}
 		table[i] = c;
 	}
+	// スライシング用テーブル
+	// slice[n][i] = slice[n-1][i] の後に0を1バイト追加したときの剰余
+	slice[0] = table;
+	for(size_t n = 1; n < slice.size(); n++)
+	{
+		for(size_t i = 0; i < 256; i++)
+		{
+			auto c = slice[n - 1][i];
+			slice[n][i] = table[c & 0xFF] ^ (c >> 8);
+		}
+	}
+	// 結合計算用の多項式
+	// power[n] = x^(2^n) mod P (反転表現では x^0 が最上位ビット)
+	power[0] = uint32_t(1) << 30;
+	for(size_t n = 1; n < power.size(); n++) { power[n] = MultiplyModP(power[n - 1], power[n - 1]); }
+	// 使用する実装の決定
+	implementation = Implementations::Table;
+#ifdef CDFS_CRC32_CLMUL
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2")) { implementation = Implementations::CLMUL; }
+#endif
+}
+
+const uint8_t* CRC32::PushSlice16(uint32_t& crc, const uint8_t* begin, const uint8_t* end) noexcept
+{
+	const auto& t = data.slice;
+	auto c = crc;
+	auto current = begin;
+	while (16 <= (end - current))
+	{
+		auto w0 = LoadLE32(current) ^ c;
+		auto w1 = LoadLE32(current + 4);
+		auto w2 = LoadLE32(current + 8);
+		auto w3 = LoadLE32(current + 12);
+		c = t[15][w0 & 0xFF] ^ t[14][(w0 >> 8) & 0xFF] ^ t[13][(w0 >> 16) & 0xFF] ^ t[12][w0 >> 24]
+			^ t[11][w1 & 0xFF] ^ t[10][(w1 >> 8) & 0xFF] ^ t[9][(w1 >> 16) & 0xFF] ^ t[8][w1 >> 24]
+			^ t[7][w2 & 0xFF] ^ t[6][(w2 >> 8) & 0xFF] ^ t[5][(w2 >> 16) & 0xFF] ^ t[4][w2 >> 24]
+			^ t[3][w3 & 0xFF] ^ t[2][(w3 >> 8) & 0xFF] ^ t[1][(w3 >> 16) & 0xFF] ^ t[0][w3 >> 24];
+		current += 16;
+	}
+	crc = c;
+	return current;
 }
+const uint8_t* CRC32::PushSlice8(uint32_t& crc, const uint8_t* begin, const uint8_t* end) noexcept
+{
+	const auto& t = data.slice;
+	auto c = crc;
+	auto current = begin;
+	while (8 <= (end - current))
+	{
+		auto w0 = LoadLE32(current) ^ c;
+		auto w1 = LoadLE32(current + 4);
+		c = t[7][w0 & 0xFF] ^ t[6][(w0 >> 8) & 0xFF] ^ t[5][(w0 >> 16) & 0xFF] ^ t[4][w0 >> 24]
+			^ t[3][w1 & 0xFF] ^ t[2][(w1 >> 8) & 0xFF] ^ t[1][(w1 >> 16) & 0xFF] ^ t[0][w1 >> 24];
+		current += 8;
+	}
+	crc = c;
+	return current;
+}
+#ifdef CDFS_CRC32_CLMUL
+namespace
+{
+	// 反転表現のCRC-32(0xEDB88320)に対するキャリーレス乗算による畳み込みの定数
+	// 定数は x^n mod P をビット反転したもの(Intel "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" による)
+	///	4x128ビット単位の畳み込み定数 (x^(512+32), x^(512-32))
+	alignas(16) const uint64_t k1k2[] = { 0x0154442BD4, 0x01C6E41596 };
+	///	1x128ビット単位の畳み込み定数 (x^(128+32), x^(128-32))
+	alignas(16) const uint64_t k3k4[] = { 0x01751997D0, 0x00CCAA009E };
+	///	64ビットへの縮約定数 (x^64)
+	alignas(16) const uint64_t k5k0[] = { 0x0163CD6124, 0x0000000000 };
+	///	Barrett縮約用の定数 (P', μ)
+	alignas(16) const uint64_t poly[] = { 0x01DB710641, 0x01F7011641 };
+
+	///	128ビットの剰余を定数 @a k で畳み込み、 @a next と合成します。
+	__attribute__((target("pclmul,sse2")))
+	inline __m128i FoldCLMUL(const __m128i& x, const __m128i& k, const __m128i& next) noexcept
+	{
+		return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), next);
+	}
+	///	128ビットの剰余を32ビットのCRCに縮約します。
+	__attribute__((target("pclmul,sse2")))
+	inline uint32_t ReduceCLMUL(__m128i x1) noexcept
+	{
+		auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+		// 128ビットから64ビットへ縮約
+		auto x0 = _mm_load_si128((const __m128i*)k3k4);
+		auto x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+		x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+		x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+		// Barrett縮約で32ビットへ
+		x0 = _mm_load_si128((const __m128i*)poly);
+		x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x10);
+		x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+		return uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+	}
+}
+
+__attribute__((target("pclmul,sse2")))
+const uint8_t* CRC32::PushCLMUL(uint32_t& crc, const uint8_t* begin, const uint8_t* end) noexcept
+{
+	// 64バイトに満たない場合は処理しない
+	if ((end - begin) < 64) { return begin; }
+	auto current = begin;
+
+	auto x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(current + 0x00)), _mm_cvtsi32_si128(int(crc)));
+	auto x2 = _mm_loadu_si128((const __m128i*)(current + 0x10));
+	auto x3 = _mm_loadu_si128((const __m128i*)(current + 0x20));
+	auto x4 = _mm_loadu_si128((const __m128i*)(current + 0x30));
+	current += 64;
+
+	// 64バイト単位で並列に畳み込む
+	auto k = _mm_load_si128((const __m128i*)k1k2);
+	while (64 <= (end - current))
+	{
+		x1 = FoldCLMUL(x1, k, _mm_loadu_si128((const __m128i*)(current + 0x00)));
+		x2 = FoldCLMUL(x2, k, _mm_loadu_si128((const __m128i*)(current + 0x10)));
+		x3 = FoldCLMUL(x3, k, _mm_loadu_si128((const __m128i*)(current + 0x20)));
+		x4 = FoldCLMUL(x4, k, _mm_loadu_si128((const __m128i*)(current + 0x30)));
+		current += 64;
+	}
+
+	// 128ビットに畳み込み、残りを16バイト単位で畳み込む
+	k = _mm_load_si128((const __m128i*)k3k4);
+	x1 = FoldCLMUL(x1, k, x2);
+	x1 = FoldCLMUL(x1, k, x3);
+	x1 = FoldCLMUL(x1, k, x4);
+	while (16 <= (end - current))
+	{
+		x1 = FoldCLMUL(x1, k, _mm_loadu_si128((const __m128i*)current));
+		current += 16;
+	}
+
+	crc = ReduceCLMUL(x1);
+	return current;
+}
+__attribute__((target("pclmul,sse2")))
+size_t CRC32::PushCLMULx4(uint32_t* crc, const uint8_t* const* begins, const size_t& length) noexcept
+{
+	// 64バイトに満たない場合は処理しない
+	if (length < 64) { return 0U; }
+	constexpr size_t lanes = 4;
+	__m128i x[lanes][4];
+	#pragma GCC unroll 4
+	for (size_t s = 0; s < lanes; s++)
+	{
+		#pragma GCC unroll 4
+		for (size_t j = 0; j < 4; j++) { x[s][j] = _mm_loadu_si128((const __m128i*)(begins[s] + (16 * j))); }
+		x[s][0] = _mm_xor_si128(x[s][0], _mm_cvtsi32_si128(int(crc[s])));
+	}
+	auto offset = size_t(64U);
+
+	// 64バイト単位で並列に畳み込む
+	// 4つのデータの計算を交互に進め、乗算のレイテンシを隠蔽する
+	auto k = _mm_load_si128((const __m128i*)k1k2);
+	while ((offset + 64) <= length)
+	{
+		#pragma GCC unroll 4
+		for (size_t s = 0; s < lanes; s++)
+		{
+			#pragma GCC unroll 4
+			for (size_t j = 0; j < 4; j++) { x[s][j] = FoldCLMUL(x[s][j], k, _mm_loadu_si128((const __m128i*)(begins[s] + offset + (16 * j)))); }
+		}
+		offset += 64;
+	}
+
+	// 128ビットに畳み込み、残りを16バイト単位で畳み込む
+	k = _mm_load_si128((const __m128i*)k3k4);
+	#pragma GCC unroll 4
+	for (size_t j = 1; j < 4; j++)
+	{
+		#pragma GCC unroll 4
+		for (size_t s = 0; s < lanes; s++) { x[s][0] = FoldCLMUL(x[s][0], k, x[s][j]); }
+	}
+	while ((offset + 16) <= length)
+	{
+		#pragma GCC unroll 4
+		for (size_t s = 0; s < lanes; s++) { x[s][0] = FoldCLMUL(x[s][0], k, _mm_loadu_si128((const __m128i*)(begins[s] + offset))); }
+		offset += 16;
+	}
+
+	#pragma GCC unroll 4
+	for (size_t s = 0; s < lanes; s++) { crc[s] = ReduceCLMUL(x[s][0]); }
+	return offset;
+}
+#else
+const uint8_t* CRC32::PushCLMUL(uint32_t&, const uint8_t* begin, const uint8_t*) noexcept { return begin; }
+size_t CRC32::PushCLMULx4(uint32_t*, const uint8_t* const*, const size_t&) noexcept { return 0U; }
+#endif
 
 CRC32::CRC32() noexcept : curr(0xFFFFFFFF) {}
 CRC32::CRC32(const uint32_t& init) noexcept : curr(init) {}
 void CRC32::Push(const uint8_t& value) noexcept { curr = data.table[(curr ^ value) & 0xFF] ^ (curr >> 8); }
-void CRC32::Push(const std::initializer_list<uint8_t>& list) noexcept { for (const auto& item: list) { Push(item); } }
-void CRC32::Push(const uint8_t* begin, const uint8_t* end) noexcept { auto current = begin; while(current != end) { Push(*current); ++current; } }
+void CRC32::Push(const std::initializer_list<uint8_t>& list) noexcept { Push(list.begin(), list.end()); }
+void CRC32::Push(const uint8_t* begin, const uint8_t* end) noexcept { Push(begin, end, data.implementation); }
+void CRC32::Push(const uint8_t* begin, const uint8_t* end, const Implementations& implementation) noexcept
+{
+	auto current = begin;
+	// キャリーレス乗算が使用できる場合は16バイト単位で可能な限り処理する
+	if ((implementation == Implementations::CLMUL)&&(IsSupported(Implementations::CLMUL))) { current = PushCLMUL(curr, current, end); }
+	// 16バイト単位、8バイト単位の順に処理し、残りを1バイトずつ処理する
+	current = PushSlice16(curr, current, end);
+	current = PushSlice8(curr, current, end);
+	while(current != end) { Push(*current); ++current; }
+}
 uint32_t CRC32::GetValue() const noexcept { return curr ^ 0xFFFFFFFF; }
+void CRC32::Calculate(const uint8_t* const* begins, const size_t& length, uint32_t* results, const size_t& count) noexcept
+{
+	size_t i = 0;
+	// キャリーレス乗算が使用できる場合は4つずつまとめて計算する
+	if (data.implementation == Implementations::CLMUL)
+	{
+		for (; (i + 4) <= count; i += 4)
+		{
+			uint32_t crc[4] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+			auto offset = PushCLMULx4(crc, begins + i, length);
+			for (size_t s = 0; s < 4; s++)
+			{
+				auto calculator = CRC32(crc[s]);
+				calculator.Push(begins[i + s] + offset, begins[i + s] + length, Implementations::Table);
+				results[i + s] = calculator.GetValue();
+			}
+		}
+	}
+	for (; i < count; i++)
+	{
+		auto calculator = CRC32();
+		calculator.Push(begins[i], begins[i] + length);
+		results[i] = calculator.GetValue();
+	}
+}
+
+uint32_t CRC32::MultiplyModP(uint32_t a, uint32_t b) noexcept
+{
+	const uint32_t generator = 0xEDB88320;
+	uint32_t product = 0;
+	// a の x^0 の項(最上位ビット)から順に、b に x を掛けながら加算する
+	for (uint32_t m = uint32_t(1) << 31; (m != 0)&&(a != 0); m >>= 1)
+	{
+		if (a & m) { product ^= b; a ^= m; }
+		b = (b & 1) ? ((b >> 1) ^ generator) : (b >> 1);
+	}
+	return product;
+}
+uint32_t CRC32::PowerModP(uint64_t length) noexcept
+{
+	// x^(8 * length) = x^(2^3 * length) を length の2進表現に従って組み立てる
+	// (x^(2^n) は n = 32 で一巡するため、表は32要素で足りる)
+	uint32_t result = uint32_t(1) << 31;
+	for (size_t n = 3; length != 0; length >>= 1, n++)
+	{
+		if (length & 1) { result = MultiplyModP(data.power[n & 31], result); }
+	}
+	return result;
+}
+uint32_t CRC32::Combine(const uint32_t& crcA, const uint32_t& crcB, const uint64_t& lengthB) noexcept
+{
+	// crc(A || B) = crc(A) * x^(8 * |B|) + crc(B) (初期値・最終XORの寄与は打ち消し合う)
+	return MultiplyModP(PowerModP(lengthB), crcA) ^ crcB;
+}
+uint32_t CRC32::Combine(const uint32_t* crcs, const uint64_t* lengths, const size_t& count) noexcept
+{
+	if (count == 0U) { return 0U; }
+	auto result = crcs[0];
+	for (size_t i = 1; i < count; i++) { result = Combine(result, crcs[i], lengths[i]); }
+	return result;
+}
+
+CRC32::Implementations CRC32::ActiveImplementation() noexcept { return data.implementation; }
+bool CRC32::IsSupported(const Implementations& implementation) noexcept
+{
+	switch (implementation)
+	{
+	case Implementations::Table: { return true; }
+	case Implementations::CLMUL: { return data.implementation == Implementations::CLMUL; }
+	default: { return false; }
+	}
+}
+
+namespace
+{
+	constexpr uint64_t XXHPrime32_1 = 0x9E3779B1U;
+	constexpr uint64_t XXHPrime32_2 = 0x85EBCA77U;
+	constexpr uint64_t XXHPrime32_3 = 0xC2B2AE3DU;
+	constexpr uint64_t XXHPrime64_1 = 0x9E3779B185EBCA87U;
+	constexpr uint64_t XXHPrime64_2 = 0xC2B2AE3D27D4EB4FU;
+	constexpr uint64_t XXHPrime64_3 = 0x165667B19E3779F9U;
+	constexpr uint64_t XXHPrime64_4 = 0x85EBCA77C2B2AE63U;
+	constexpr uint64_t XXHPrime64_5 = 0x27D4EB2F165667C5U;
+	constexpr uint64_t XXHPrimeMX1 = 0x165667919E3779F9U;
+	constexpr uint64_t XXHPrimeMX2 = 0x9FB21C651E98DF25U;
+
+	///	128ビットの値
+	struct Hash128 { uint64_t low; uint64_t high; };
+
+	inline uint64_t Rotl64(const uint64_t& value, const int& count) noexcept { return (value << count) | (value >> (64 - count)); }
+	inline uint32_t Rotl32(const uint32_t& value, const int& count) noexcept { return (value << count) | (value >> (32 - count)); }
+	inline uint32_t Swap32(const uint32_t& value) noexcept { return ((value << 24) & 0xFF000000U) | ((value << 8) & 0x00FF0000U) | ((value >> 8) & 0x0000FF00U) | ((value >> 24) & 0x000000FFU); }
+	inline uint64_t Swap64(const uint64_t& value) noexcept { return (uint64_t(Swap32(uint32_t(value))) << 32) | uint64_t(Swap32(uint32_t(value >> 32))); }
+	///	リトルエンディアンの64ビット値を読み込む
+	inline uint64_t ReadLE64(const uint8_t* p) noexcept
+	{
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		value = Swap64(value);
+#endif
+		return value;
+	}
+	///	リトルエンディアンの32ビット値を読み込む
+	inline uint32_t ReadLE32(const uint8_t* p) noexcept
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		value = Swap32(value);
+#endif
+		return value;
+	}
+	///	リトルエンディアンの64ビット値を書き込む
+	inline void WriteLE64(uint8_t* p, const uint64_t& value) noexcept
+	{
+		for (size_t i = 0; i < 8; i++) { p[i] = uint8_t(value >> (i * 8)); }
+	}
+	///	64ビット値同士の乗算を行い、128ビットの結果を得る
+	inline Hash128 Multiply128(const uint64_t& lhs, const uint64_t& rhs) noexcept
+	{
+#if defined(__SIZEOF_INT128__)
+		auto product = (unsigned __int128)lhs * rhs;
+		return Hash128{ uint64_t(product), uint64_t(product >> 64) };
+#else
+		uint64_t lolo = (lhs & 0xFFFFFFFFU) * (rhs & 0xFFFFFFFFU);
+		uint64_t hilo = (lhs >> 32) * (rhs & 0xFFFFFFFFU);
+		uint64_t lohi = (lhs & 0xFFFFFFFFU) * (rhs >> 32);
+		uint64_t hihi = (lhs >> 32) * (rhs >> 32);
+		uint64_t cross = (lolo >> 32) + (hilo & 0xFFFFFFFFU) + lohi;
+		return Hash128{ (cross << 32) | (lolo & 0xFFFFFFFFU), (hilo >> 32) + (cross >> 32) + hihi };
+#endif
+	}
+	inline uint64_t MultiplyFold64(const uint64_t& lhs, const uint64_t& rhs) noexcept
+	{
+		auto product = Multiply128(lhs, rhs);
+		return product.low ^ product.high;
+	}
+	inline uint64_t XXH64Avalanche(uint64_t h) noexcept
+	{
+		h ^= h >> 33;
+		h *= XXHPrime64_2;
+		h ^= h >> 29;
+		h *= XXHPrime64_3;
+		h ^= h >> 32;
+		return h;
+	}
+	inline uint64_t XXH3Avalanche(uint64_t h) noexcept
+	{
+		h ^= h >> 37;
+		h *= XXHPrimeMX1;
+		h ^= h >> 32;
+		return h;
+	}
+	inline uint64_t XXH3Mix16B(const uint8_t* input, const uint8_t* secret, const uint64_t& seed) noexcept
+	{
+		return MultiplyFold64(ReadLE64(input) ^ (ReadLE64(secret) + seed), ReadLE64(input + 8) ^ (ReadLE64(secret + 8) - seed));
+	}
+	inline Hash128 XXH3Mix32B(Hash128 acc, const uint8_t* input1, const uint8_t* input2, const uint8_t* secret, const uint64_t& seed) noexcept
+	{
+		acc.low += XXH3Mix16B(input1, secret, seed);
+		acc.low ^= ReadLE64(input2) + ReadLE64(input2 + 8);
+		acc.high += XXH3Mix16B(input2, secret + 16, seed);
+		acc.high ^= ReadLE64(input1) + ReadLE64(input1 + 8);
+		return acc;
+	}
+	inline uint64_t XXH3MergeAccs(const uint64_t* acc, const uint8_t* secret, const uint64_t& start) noexcept
+	{
+		uint64_t result = start;
+		for (size_t i = 0; i < 4; i++) { result += MultiplyFold64(acc[(i * 2)] ^ ReadLE64(secret + (i * 16)), acc[(i * 2) + 1] ^ ReadLE64(secret + (i * 16) + 8)); }
+		return XXH3Avalanche(result);
+	}
+	///	ストライプを累積値に追加する
+	inline void XXH3Accumulate512(uint64_t* acc, const uint8_t* input, const uint8_t* secret) noexcept
+	{
+#if defined(__SSE2__)
+		auto xacc = reinterpret_cast<__m128i*>(acc);
+		for (size_t i = 0; i < 4; i++)
+		{
+			auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+			auto key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+			auto datakey = _mm_xor_si128(data, key);
+			auto product = _mm_mul_epu32(datakey, _mm_shuffle_epi32(datakey, _MM_SHUFFLE(0, 3, 0, 1)));
+			auto sum = _mm_add_epi64(_mm_load_si128(xacc + i), _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+			_mm_store_si128(xacc + i, _mm_add_epi64(product, sum));
+		}
+#else
+		for (size_t i = 0; i < 8; i++)
+		{
+			uint64_t data = ReadLE64(input + (i * 8));
+			uint64_t datakey = data ^ ReadLE64(secret + (i * 8));
+			acc[i ^ 1] += data;
+			acc[i] += (datakey & 0xFFFFFFFFU) * (datakey >> 32);
+		}
+#endif
+	}
+	///	累積値をかき混ぜる
+	inline void XXH3Scramble(uint64_t* acc, const uint8_t* secret) noexcept
+	{
+#if defined(__SSE2__)
+		auto xacc = reinterpret_cast<__m128i*>(acc);
+		auto prime = _mm_set1_epi32(int(XXHPrime32_1));
+		for (size_t i = 0; i < 4; i++)
+		{
+			auto value = _mm_load_si128(xacc + i);
+			value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+			value = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+			auto productlow = _mm_mul_epu32(value, prime);
+			auto producthigh = _mm_mul_epu32(_mm_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+			_mm_store_si128(xacc + i, _mm_add_epi64(productlow, _mm_slli_epi64(producthigh, 32)));
+		}
+#else
+		for (size_t i = 0; i < 8; i++)
+		{
+			uint64_t value = acc[i];
+			value ^= value >> 47;
+			value ^= ReadLE64(secret + (i * 8));
+			acc[i] = value * XXHPrime32_1;
+		}
+#endif
+	}
+	///	ストライプをまとめて累積値に追加する
+	///	@param	stripes	現在のブロック内で処理したストライプ数。
+	void XXH3AccumulateStripes(uint64_t* acc, const uint8_t* input, const size_t& count, const uint8_t* secret, size_t& stripes) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			XXH3Accumulate512(acc, input + (i * XXH3::StripeSize), secret + (stripes * 8U));
+			// ブロックの最後のストライプを処理したら累積値をかき混ぜる
+			if (++stripes == ((XXH3::SecretSize - XXH3::StripeSize) / 8U))
+			{
+				XXH3Scramble(acc, secret + (XXH3::SecretSize - XXH3::StripeSize));
+				stripes = 0U;
+			}
+		}
+	}
+#if defined(CDFS_XXH3_AVX2)
+	///	ストライプをまとめて累積値に追加する(AVX2)
+	__attribute__((target("avx2")))
+	void XXH3AccumulateStripesAVX2(uint64_t* acc, const uint8_t* input, const size_t& count, const uint8_t* secret, size_t& stripes) noexcept
+	{
+		auto xacc = reinterpret_cast<__m256i*>(acc);
+		__m256i a[2] = { _mm256_loadu_si256(xacc), _mm256_loadu_si256(xacc + 1) };
+		auto prime = _mm256_set1_epi32(int(XXHPrime32_1));
+		for (size_t i = 0; i < count; i++)
+		{
+			auto stripe = reinterpret_cast<const __m256i*>(input + (i * XXH3::StripeSize));
+			auto keys = reinterpret_cast<const __m256i*>(secret + (stripes * 8U));
+			for (size_t l = 0; l < 2; l++)
+			{
+				auto data = _mm256_loadu_si256(stripe + l);
+				auto datakey = _mm256_xor_si256(data, _mm256_loadu_si256(keys + l));
+				auto product = _mm256_mul_epu32(datakey, _mm256_shuffle_epi32(datakey, _MM_SHUFFLE(0, 3, 0, 1)));
+				a[l] = _mm256_add_epi64(a[l], _mm256_add_epi64(_mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)), product));
+			}
+			if (++stripes == ((XXH3::SecretSize - XXH3::StripeSize) / 8U))
+			{
+				auto scramblekeys = reinterpret_cast<const __m256i*>(secret + (XXH3::SecretSize - XXH3::StripeSize));
+				for (size_t l = 0; l < 2; l++)
+				{
+					auto value = _mm256_xor_si256(a[l], _mm256_srli_epi64(a[l], 47));
+					value = _mm256_xor_si256(value, _mm256_loadu_si256(scramblekeys + l));
+					auto productlow = _mm256_mul_epu32(value, prime);
+					auto producthigh = _mm256_mul_epu32(_mm256_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+					a[l] = _mm256_add_epi64(productlow, _mm256_slli_epi64(producthigh, 32));
+				}
+				stripes = 0U;
+			}
+		}
+		_mm256_storeu_si256(xacc, a[0]);
+		_mm256_storeu_si256(xacc + 1, a[1]);
+	}
+	///	実行環境でAVX2が使用できるか
+	bool XXH3SupportsAVX2() noexcept
+	{
+		static const bool supported = []
+		{
+			__builtin_cpu_init();
+			return bool(__builtin_cpu_supports("avx2"));
+		}();
+		return supported;
+	}
+#endif
+}
+
+const std::array<uint8_t, XXH3::SecretSize> XXH3::DefaultSecret =
+{
+	0xB8, 0xFE, 0x6C, 0x39, 0x23, 0xA4, 0x4B, 0xBE, 0x7C, 0x01, 0x81, 0x2C, 0xF7, 0x21, 0xAD, 0x1C,
+	0xDE, 0xD4, 0x6D, 0xE9, 0x83, 0x90, 0x97, 0xDB, 0x72, 0x40, 0xA4, 0xA4, 0xB7, 0xB3, 0x67, 0x1F,
+	0xCB, 0x79, 0xE6, 0x4E, 0xCC, 0xC0, 0xE5, 0x78, 0x82, 0x5A, 0xD0, 0x7D, 0xCC, 0xFF, 0x72, 0x21,
+	0xB8, 0x08, 0x46, 0x74, 0xF7, 0x43, 0x24, 0x8E, 0xE0, 0x35, 0x90, 0xE6, 0x81, 0x3A, 0x26, 0x4C,
+	0x3C, 0x28, 0x52, 0xBB, 0x91, 0xC3, 0x00, 0xCB, 0x88, 0xD0, 0x65, 0x8B, 0x1B, 0x53, 0x2E, 0xA3,
+	0x71, 0x64, 0x48, 0x97, 0xA2, 0x0D, 0xF9, 0x4E, 0x38, 0x19, 0xEF, 0x46, 0xA9, 0xDE, 0xAC, 0xD8,
+	0xA8, 0xFA, 0x76, 0x3F, 0xE3, 0x9C, 0x34, 0x3F, 0xF9, 0xDC, 0xBB, 0xC7, 0xC7, 0x0B, 0x4F, 0x1D,
+	0x8A, 0x51, 0xE0, 0x4B, 0xCD, 0xB4, 0x59, 0x31, 0xC8, 0x9F, 0x7E, 0xC9, 0xD9, 0x78, 0x73, 0x64,
+	0xEA, 0xC5, 0xAC, 0x83, 0x34, 0xD3, 0xEB, 0xC3, 0xC5, 0x81, 0xA0, 0xFF, 0xFA, 0x13, 0x63, 0xEB,
+	0x17, 0x0D, 0xDD, 0x51, 0xB7, 0xF0, 0xDA, 0x49, 0xD3, 0x16, 0x55, 0x26, 0x29, 0xD4, 0x68, 0x9E,
+	0x2B, 0x16, 0xBE, 0x58, 0x7D, 0x47, 0xA1, 0xFC, 0x8F, 0xF8, 0xB8, 0xD1, 0x7A, 0xD0, 0x31, 0xCE,
+	0x45, 0xCB, 0x3A, 0x8F, 0x95, 0x16, 0x04, 0x28, 0xAF, 0xD7, 0xFB, 0xCA, 0xBB, 0x4B, 0x40, 0x7E,
+};
+
+XXH3::XXH3(const uint64_t& seed) noexcept
+	: acc{ XXHPrime32_3, XXHPrime64_1, XXHPrime64_2, XXHPrime64_3, XXHPrime64_4, XXHPrime32_2, XXHPrime64_5, XXHPrime32_1 }, secret(), head(), buffer(), last(), buffersize(), stripes(), seed(seed), length()
+{
+	// シード値から鍵を導出する
+	for (size_t i = 0; i < SecretSize; i += 16)
+	{
+		WriteLE64(secret.data() + i, ReadLE64(DefaultSecret.data() + i) + seed);
+		WriteLE64(secret.data() + i + 8, ReadLE64(DefaultSecret.data() + i + 8) - seed);
+	}
+}
+void XXH3::ConsumeStripes(const uint8_t* begin, const size_t& count) noexcept
+{
+#if defined(CDFS_XXH3_AVX2)
+	if (XXH3SupportsAVX2()) { XXH3AccumulateStripesAVX2(acc.data(), begin, count, secret.data(), stripes); return; }
+#endif
+	XXH3AccumulateStripes(acc.data(), begin, count, secret.data(), stripes);
+}
+void XXH3::Push(const uint8_t& value) noexcept { Push(&value, &value + 1); }
+void XXH3::Push(const uint8_t* begin, const uint8_t* end) noexcept
+{
+	if (begin == end) { return; }
+	auto current = begin;
+	auto size = size_t(end - begin);
+	// 短いデータのハッシュ値の計算のため先頭部分を保持する
+	if (length < ShortLength)
+	{
+		auto count = ((ShortLength - size_t(length)) < size)?(ShortLength - size_t(length)):size;
+		std::memcpy(head.data() + length, begin, count);
+	}
+	length += size;
+	// 最後のストライプは異なる鍵で処理するため、後続のデータが来るまで処理を保留する
+	if ((buffersize + size) <= StripeSize)
+	{
+		std::memcpy(buffer.data() + buffersize, current, size);
+		buffersize += size;
+		return;
+	}
+	if (buffersize != 0U)
+	{
+		auto count = StripeSize - buffersize;
+		std::memcpy(buffer.data() + buffersize, current, count);
+		current += count;
+		ConsumeStripes(buffer.data(), 1U);
+		last = buffer;
+		buffersize = 0U;
+	}
+	if (StripeSize < size_t(end - current))
+	{
+		auto count = (size_t(end - current) - 1U) / StripeSize;
+		ConsumeStripes(current, count);
+		current += count * StripeSize;
+		std::memcpy(last.data(), current - StripeSize, StripeSize);
+	}
+	std::memcpy(buffer.data(), current, size_t(end - current));
+	buffersize = size_t(end - current);
+}
+XXH3::ValueType XXH3::GetShortValue() const noexcept
+{
+	auto input = head.data();
+	auto key = DefaultSecret.data();
+	auto len = size_t(length);
+	auto result = Hash128();
+	if (len == 0U)
+	{
+		result.low = XXH64Avalanche(seed ^ ReadLE64(key + 64) ^ ReadLE64(key + 72));
+		result.high = XXH64Avalanche(seed ^ ReadLE64(key + 80) ^ ReadLE64(key + 88));
+	}
+	else if (len <= 3U)
+	{
+		uint32_t combinedlow = (uint32_t(input[0]) << 16) | (uint32_t(input[len >> 1]) << 24) | uint32_t(input[len - 1]) | (uint32_t(len) << 8);
+		uint32_t combinedhigh = Rotl32(Swap32(combinedlow), 13);
+		uint64_t bitfliplow = (ReadLE32(key) ^ ReadLE32(key + 4)) + seed;
+		uint64_t bitfliphigh = (ReadLE32(key + 8) ^ ReadLE32(key + 12)) - seed;
+		result.low = XXH64Avalanche(uint64_t(combinedlow) ^ bitfliplow);
+		result.high = XXH64Avalanche(uint64_t(combinedhigh) ^ bitfliphigh);
+	}
+	else if (len <= 8U)
+	{
+		uint64_t s = seed ^ (uint64_t(Swap32(uint32_t(seed))) << 32);
+		uint64_t value = uint64_t(ReadLE32(input)) + (uint64_t(ReadLE32(input + len - 4)) << 32);
+		uint64_t bitflip = (ReadLE64(key + 16) ^ ReadLE64(key + 24)) + s;
+		auto m = Multiply128(value ^ bitflip, XXHPrime64_1 + (uint64_t(len) << 2));
+		m.high += (m.low << 1);
+		m.low ^= (m.high >> 3);
+		m.low ^= m.low >> 35;
+		m.low *= XXHPrimeMX2;
+		m.low ^= m.low >> 28;
+		m.high = XXH3Avalanche(m.high);
+		result = m;
+	}
+	else if (len <= 16U)
+	{
+		uint64_t bitfliplow = (ReadLE64(key + 32) ^ ReadLE64(key + 40)) - seed;
+		uint64_t bitfliphigh = (ReadLE64(key + 48) ^ ReadLE64(key + 56)) + seed;
+		uint64_t inputlow = ReadLE64(input);
+		uint64_t inputhigh = ReadLE64(input + len - 8);
+		auto m = Multiply128(inputlow ^ inputhigh ^ bitfliplow, XXHPrime64_1);
+		m.low += uint64_t(len - 1) << 54;
+		inputhigh ^= bitfliphigh;
+		m.high += inputhigh + ((inputhigh & 0xFFFFFFFFU) * (XXHPrime32_2 - 1U));
+		m.low ^= Swap64(m.high);
+		auto h = Multiply128(m.low, XXHPrime64_2);
+		h.high += m.high * XXHPrime64_2;
+		result.low = XXH3Avalanche(h.low);
+		result.high = XXH3Avalanche(h.high);
+	}
+	else
+	{
+		auto a = Hash128{ uint64_t(len) * XXHPrime64_1, 0U };
+		if (len <= 128U)
+		{
+			if (32U < len)
+			{
+				if (64U < len)
+				{
+					if (96U < len) { a = XXH3Mix32B(a, input + 48, input + len - 64, key + 96, seed); }
+					a = XXH3Mix32B(a, input + 32, input + len - 48, key + 64, seed);
+				}
+				a = XXH3Mix32B(a, input + 16, input + len - 32, key + 32, seed);
+			}
+			a = XXH3Mix32B(a, input, input + len - 16, key, seed);
+		}
+		else
+		{
+			for (size_t i = 0; i < 4U; i++) { a = XXH3Mix32B(a, input + (32 * i), input + (32 * i) + 16, key + (32 * i), seed); }
+			a.low = XXH3Avalanche(a.low);
+			a.high = XXH3Avalanche(a.high);
+			for (size_t i = 4; i < (len / 32U); i++) { a = XXH3Mix32B(a, input + (32 * i), input + (32 * i) + 16, key + 3 + (32 * (i - 4)), seed); }
+			a = XXH3Mix32B(a, input + len - 16, input + len - 32, key + 136 - 17 - 16, 0U - seed);
+		}
+		result.low = a.low + a.high;
+		result.high = (a.low * XXHPrime64_1) + (a.high * XXHPrime64_4) + ((uint64_t(len) - seed) * XXHPrime64_2);
+		result.low = XXH3Avalanche(result.low);
+		result.high = 0U - XXH3Avalanche(result.high);
+	}
+	auto value = ValueType();
+	for (size_t i = 0; i < 8; i++)
+	{
+		value[i] = uint8_t(result.high >> (56 - (i * 8)));
+		value[i + 8] = uint8_t(result.low >> (56 - (i * 8)));
+	}
+	return value;
+}
+XXH3::ValueType XXH3::GetValue() const noexcept
+{
+	if (length <= ShortLength) { return GetShortValue(); }
+	// 最後のストライプを処理した累積値を求める
+	alignas(16) auto a = acc;
+	auto stripe = std::array<uint8_t, StripeSize>();
+	std::memcpy(stripe.data(), last.data() + buffersize, StripeSize - buffersize);
+	std::memcpy(stripe.data() + (StripeSize - buffersize), buffer.data(), buffersize);
+	XXH3Accumulate512(a.data(), stripe.data(), secret.data() + (SecretSize - StripeSize - 7U));
+	uint64_t low = XXH3MergeAccs(a.data(), secret.data() + 11, length * XXHPrime64_1);
+	uint64_t high = XXH3MergeAccs(a.data(), secret.data() + (SecretSize - StripeSize - 11U), ~(length * XXHPrime64_2));
+	auto value = ValueType();
+	for (size_t i = 0; i < 8; i++)
+	{
+		value[i] = uint8_t(high >> (56 - (i * 8)));
+		value[i + 8] = uint8_t(low >> (56 - (i * 8)));
+	}
+	return value;
+}
@@ -0,0 +1,408 @@
+//	zawa-ch/cdfs:/src/compression
+//	Copyright 2020 zawa-ch.
+//
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "cdfs/compression.hpp"
+using namespace zawa_ch::CDFS;
+
+namespace
+{
+	///	一致とみなす最小の長さ
+	constexpr size_t MinMatch = 4;
+	///	最後の一致はブロックの末尾からこの大きさより前で始まる必要がある
+	constexpr size_t MatchFindLimit = 12;
+	///	ブロックの末尾のこの大きさはリテラルである必要がある
+	constexpr size_t LastLiterals = 5;
+	///	一致の距離の最大値
+	constexpr size_t MaxDistance = 65535;
+	///	ハッシュ表の大きさ(ビット数)
+	constexpr size_t HashLog = 14;
+
+	///	圧縮に使用する作業領域
+	struct Workspace final
+	{
+		///	ハッシュ値ごとの最後の出現位置
+		std::array<int32_t, size_t(1) << HashLog> table;
+		///	同じハッシュ値を持つ直前の出現位置までの距離
+		std::array<uint16_t, CDFSCompression::BlockSize> chain;
+	};
+
+	uint32_t Read32(const uint8_t* data) noexcept
+	{
+		auto value = uint32_t();
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+	uint16_t ReadLE16(const uint8_t* data) noexcept { return uint16_t(data[0] | (data[1] << 8)); }
+	uint32_t ReadLE32(const uint8_t* data) noexcept { return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24); }
+	void WriteLE16(uint8_t* data, const uint16_t& value) noexcept
+	{
+		data[0] = uint8_t(value);
+		data[1] = uint8_t(value >> 8);
+	}
+	void WriteLE32(uint8_t* data, const uint32_t& value) noexcept
+	{
+		for (size_t i = 0; i < 4; i++) { data[i] = uint8_t(value >> (i * 8U)); }
+	}
+	uint32_t Hash(const uint32_t& value) noexcept { return (value * 2654435761U) >> (32U - HashLog); }
+	///	指定された2つの位置から一致する長さを求める
+	size_t CountMatch(const uint8_t* a, const uint8_t* b, const uint8_t* limit) noexcept
+	{
+		auto begin = a;
+		while ((a + 8) <= limit)
+		{
+			uint64_t x, y;
+			std::memcpy(&x, a, sizeof(x));
+			std::memcpy(&y, b, sizeof(y));
+			if (x != y) { return size_t(a - begin) + size_t(__builtin_ctzll(x ^ y) / 8); }
+			a += 8;
+			b += 8;
+		}
+		while ((a < limit)&&(*a == *b)) { ++a; ++b; }
+		return size_t(a - begin);
+	}
+	///	長さの拡張部分を書き込む
+	uint8_t* WriteLength(uint8_t* op, size_t length) noexcept
+	{
+		while (255U <= length)
+		{
+			*(op++) = 255U;
+			length -= 255U;
+		}
+		*(op++) = uint8_t(length);
+		return op;
+	}
+	///	シーケンスを書き込む
+	///	@return	書き込み先に収まらなかった場合は nullptr 。
+	uint8_t* WriteSequence(uint8_t* op, const uint8_t* oend, const uint8_t* literal, const size_t& literals, const size_t& distance, const size_t& matchlength) noexcept
+	{
+		// 書き込む大きさの上限で容量を確認する
+		auto required = 1U + (literals / 255U) + 1U + literals + ((matchlength != 0U)?(2U + ((matchlength - MinMatch) / 255U) + 1U):0U);
+		if (size_t(oend - op) < required) { return nullptr; }
+		auto token = op++;
+		*token = uint8_t(((literals < 15U)?literals:15U) << 4);
+		if (15U <= literals) { op = WriteLength(op, literals - 15U); }
+		std::memcpy(op, literal, literals);
+		op += literals;
+		if (matchlength == 0U) { return op; }
+		WriteLE16(op, uint16_t(distance));
+		op += 2;
+		auto length = matchlength - MinMatch;
+		*token |= uint8_t((length < 15U)?length:15U);
+		if (15U <= length) { op = WriteLength(op, length - 15U); }
+		return op;
+	}
+}
+
+size_t CDFSCompression::Compress(const uint8_t* source, const size_t& size, uint8_t* destination, const size_t& capacity, const uint32_t& level) noexcept
+{
+	if (BlockSize < size) { return 0U; }
+	auto op = destination;
+	auto oend = destination + capacity;
+	size_t anchor = 0U;
+	if (MatchFindLimit < size)
+	{
+		// 作業領域はスレッドごとに再利用する
+		thread_local auto workspace = std::make_unique<Workspace>();
+		auto& table = workspace->table;
+		auto& chain = workspace->chain;
+		table.fill(-1);
+		///	探索する候補の数
+		auto depth = (level <= 1U)?size_t(1U):(size_t(1U) << ((level < MaxLevel)?level:MaxLevel));
+		auto insert = [&](const size_t& position)
+		{
+			auto& head = table[Hash(Read32(source + position))];
+			auto distance = (head < 0)?size_t(0U):(position - size_t(head));
+			chain[position] = uint16_t((distance <= MaxDistance)?distance:0U);
+			head = int32_t(position);
+		};
+		auto limit = size - MatchFindLimit;
+		auto matchlimit = source + size - LastLiterals;
+		size_t position = 0U;
+		while (position < limit)
+		{
+			auto value = Read32(source + position);
+			// ハッシュ表を辿って最も長く一致する候補を探す
+			size_t bestlength = 0U;
+			size_t bestposition = 0U;
+			auto candidate = table[Hash(value)];
+			for (size_t i = 0; (i < depth)&&(0 <= candidate); i++)
+			{
+				auto c = size_t(candidate);
+				if (MaxDistance < (position - c)) { break; }
+				if (Read32(source + c) == value)
+				{
+					auto length = MinMatch + CountMatch(source + position + MinMatch, source + c + MinMatch, matchlimit);
+					if (bestlength < length)
+					{
+						bestlength = length;
+						bestposition = c;
+					}
+				}
+				if (chain[c] == 0U) { break; }
+				candidate = int32_t(c - chain[c]);
+			}
+			insert(position);
+			if (bestlength == 0U)
+			{
+				// 一致しない区間が続く場合は探索の間隔を広げる(圧縮レベル1のみ)
+				position += (level <= 1U)?(1U + ((position - anchor) >> 6)):1U;
+				continue;
+			}
+			// 一致を後方に伸ばす
+			while ((anchor < position)&&(0U < bestposition)&&(source[position - 1U] == source[bestposition - 1U]))
+			{
+				--position;
+				--bestposition;
+				++bestlength;
+			}
+			op = WriteSequence(op, oend, source + anchor, position - anchor, position - bestposition, bestlength);
+			if (op == nullptr) { return 0U; }
+			// 一致した区間の位置もハッシュ表に追加する(圧縮レベル1では末尾付近のみ)
+			auto end = position + bestlength;
+			for (auto p = (level <= 1U)?((end - 2U < limit)?(end - 2U):limit):(position + 1U); p < end && p < limit; p++) { insert(p); }
+			position = end;
+			anchor = position;
+		}
+	}
+	// 残りのデータはリテラルとして書き込む
+	op = WriteSequence(op, oend, source + anchor, size - anchor, 0U, 0U);
+	if (op == nullptr) { return 0U; }
+	return size_t(op - destination);
+}
+bool CDFSCompression::Decompress(const uint8_t* source, const size_t& size, uint8_t* destination, const size_t& rawsize) noexcept
+{
+	auto ip = source;
+	auto iend = source + size;
+	auto op = destination;
+	auto oend = destination + rawsize;
+	///	長さの拡張部分を読み込む
+	auto readlength = [&](size_t& length) -> bool
+	{
+		uint8_t value;
+		do
+		{
+			if (ip == iend) { return false; }
+			value = *(ip++);
+			length += value;
+		} while (value == 255U);
+		return true;
+	};
+	while (true)
+	{
+		if (ip == iend) { return false; }
+		auto token = *(ip++);
+		size_t literals = token >> 4;
+		if ((literals == 15U)&&(!readlength(literals))) { return false; }
+		if ((size_t(iend - ip) < literals)||(size_t(oend - op) < literals)) { return false; }
+		std::memcpy(op, ip, literals);
+		ip += literals;
+		op += literals;
+		// 最後のシーケンスはリテラルのみで構成される
+		if (ip == iend) { return op == oend; }
+		if (size_t(iend - ip) < 2U) { return false; }
+		auto distance = size_t(ReadLE16(ip));
+		ip += 2;
+		if ((distance == 0U)||(size_t(op - destination) < distance)) { return false; }
+		size_t length = token & 0x0FU;
+		if ((length == 15U)&&(!readlength(length))) { return false; }
+		length += MinMatch;
+		if (size_t(oend - op) < length) { return false; }
+		auto match = op - distance;
+		if (length <= distance) { std::memcpy(op, match, length); }
+		else if (8U <= distance)
+		{
+			// 8バイトずつであれば重ならずにコピーできる
+			size_t i = 0U;
+			for (; (i + 8U) <= length; i += 8U) { std::memcpy(op + i, match + i, 8U); }
+			for (; i < length; i++) { op[i] = match[i]; }
+		}
+		else
+		{
+			for (size_t i = 0; i < length; i++) { op[i] = match[i]; }
+		}
+		op += length;
+	}
+}
+size_t CDFSCompression::EncodeBlock(const uint8_t* data, const size_t& size, uint8_t* destination, const uint32_t& level) noexcept
+{
+	// 元の大きさより小さくならない場合はそのまま格納する
+	auto compressed = (size != 0U)?Compress(data, size, destination + HeaderSize, size - 1U, level):size_t(0U);
+	auto codec = (compressed != 0U)?Codecs::LZ4:Codecs::Stored;
+	if (codec == Codecs::Stored)
+	{
+		std::memcpy(destination + HeaderSize, data, size);
+		compressed = size;
+	}
+	WriteLE16(destination, uint16_t(codec));
+	WriteLE16(destination + 2, 0U);
+	WriteLE32(destination + 4, uint32_t(size));
+	WriteLE32(destination + 8, uint32_t(compressed));
+	return HeaderSize + compressed;
+}
+std::optional<size_t> CDFSCompression::EncodedSize(const uint8_t* block, const size_t& size) noexcept
+{
+	if (size < HeaderSize) { return std::nullopt; }
+	auto compressed = size_t(ReadLE32(block + 8));
+	if (BlockSize < compressed) { return std::nullopt; }
+	return HeaderSize + compressed;
+}
+std::optional<size_t> CDFSCompression::DecodedSize(const uint8_t* block, const size_t& size) noexcept
+{
+	if (size < HeaderSize) { return std::nullopt; }
+	auto rawsize = size_t(ReadLE32(block + 4));
+	// 空のブロックは書き込まれないため不正なものとして扱う
+	if ((rawsize == 0U)||(BlockSize < rawsize)) { return std::nullopt; }
+	return rawsize;
+}
+std::optional<size_t> CDFSCompression::DecodeBlock(const uint8_t* block, const size_t& size, uint8_t* destination) noexcept
+{
+	auto encoded = EncodedSize(block, size);
+	auto rawsize = DecodedSize(block, size);
+	if ((!encoded.has_value())||(!rawsize.has_value())||(size < *encoded)) { return std::nullopt; }
+	auto compressed = *encoded - HeaderSize;
+	switch (Codecs(ReadLE16(block)))
+	{
+	case Codecs::Stored:
+	{
+		if (compressed != *rawsize) { return std::nullopt; }
+		std::memcpy(destination, block + HeaderSize, compressed);
+		return rawsize;
+	}
+	case Codecs::LZ4:
+	{
+		if (!Decompress(block + HeaderSize, compressed, destination, *rawsize)) { return std::nullopt; }
+		return rawsize;
+	}
+	default: { return std::nullopt; }
+	}
+}
+bool CDFSCompression::Extract(const Span<const CDFSFrame>& frames, std::ostream& stream, const size_t& threads)
+{
+	///	書き込む単位となるフレームの範囲
+	struct Segment final
+	{
+		///	最初のフレームのインデックス
+		size_t first;
+		///	フレーム数
+		size_t count;
+		///	圧縮フレームのブロックであるか
+		bool compressed;
+	};
+	// フレーム列をデータフレームの並びと圧縮フレームのブロックに分ける
+	auto segments = std::vector<Segment>();
+	auto blocks = std::vector<size_t>();
+	///	最後のデータフレーム
+	auto lastdata = frames.size();
+	for (size_t i = 0; i < frames.size();)
+	{
+		const auto& frame = frames[i];
+		if (CDFSDATAFrame::IsDATAFrame(frame))
+		{
+			if ((segments.empty())||(segments.back().compressed)||((segments.back().first + segments.back().count) != i)) { segments.push_back(Segment{ i, 0U, false }); }
+			++segments.back().count;
+			lastdata = i++;
+		}
+		else if (CDFSCMPRFrame::IsCMPRFrame(frame))
+		{
+			auto cmpr = CDFSCMPRView(frame);
+			if ((cmpr.data_part() != 0U)||(cmpr.data_parts() == 0U)||((frames.size() - i) < cmpr.data_parts())) { return false; }
+			blocks.push_back(segments.size());
+			segments.push_back(Segment{ i, cmpr.data_parts(), true });
+			i += cmpr.data_parts();
+		}
+		else { ++i; }
+	}
+	// 終了フレームがある場合は最後のデータフレームを総サイズに合わせて切り詰める
+	auto finfsize = std::optional<UInt128>();
+	if ((!frames.empty())&&(CDFSFINFFrame::IsFINFFrame(frames[frames.size() - 1U]))) { finfsize = CDFSFINFView(frames[frames.size() - 1U]).data_size(); }
+
+	// 展開は固定数の領域を順に使い回して行い、書き込みが追いつくまで先の展開を待たせる
+	auto threadcount = (threads != 0U)?threads:size_t(std::thread::hardware_concurrency());
+	if (threadcount == 0U) { threadcount = 1U; }
+	if (blocks.size() < threadcount) { threadcount = (blocks.size() != 0U)?blocks.size():1U; }
+	auto slotcount = threadcount * 4U;
+	auto slots = std::vector<std::unique_ptr<uint8_t[]>>(slotcount);
+	auto results = std::vector<std::optional<size_t>>(slotcount);
+	auto ready = std::vector<bool>(slotcount);
+	size_t claimed = 0U;
+	size_t consumed = 0U;
+	bool aborted = false;
+	auto mutex = std::mutex();
+	auto claimable = std::condition_variable();
+	auto decoded = std::condition_variable();
+	for (auto& slot: slots) { slot = std::make_unique<uint8_t[]>(BlockSize); }
+	auto task = [&]()
+	{
+		auto block = std::vector<uint8_t>(MaxEncodedSize + CDFSCMPRFrame::ContentSize);
+		auto lock = std::unique_lock(mutex);
+		while (true)
+		{
+			claimable.wait(lock, [&]() { return aborted||(blocks.size() <= claimed)||(claimed < (consumed + slotcount)); });
+			if (aborted||(blocks.size() <= claimed)) { return; }
+			auto index = claimed++;
+			lock.unlock();
+			// フレームに分割されたブロックを連結して展開する
+			const auto& segment = segments[blocks[index]];
+			auto size = size_t(0U);
+			auto valid = (segment.count * CDFSCMPRFrame::ContentSize) <= block.size();
+			for (size_t i = 0; valid&&(i < segment.count); i++)
+			{
+				const auto& frame = frames[segment.first + i];
+				auto cmpr = CDFSCMPRView(frame);
+				valid = (CDFSCMPRFrame::IsCMPRFrame(frame))&&(cmpr.data_part() == i)&&(cmpr.data_parts() == segment.count);
+				std::memcpy(block.data() + size, cmpr.data_content().data(), cmpr.data_content().size());
+				size += cmpr.data_content().size();
+			}
+			auto result = valid?DecodeBlock(block.data(), size, slots[index % slotcount].get()):std::nullopt;
+			lock.lock();
+			results[index % slotcount] = result;
+			ready[index % slotcount] = true;
+			decoded.notify_all();
+		}
+	};
+	auto workers = std::vector<std::thread>();
+	for (size_t i = 0; i < threadcount; i++) { workers.emplace_back(task); }
+	auto success = true;
+	auto written = UInt128(0U);
+	for (const auto& segment: segments)
+	{
+		if (!segment.compressed)
+		{
+			for (size_t i = segment.first; i < (segment.first + segment.count); i++)
+			{
+				// 直前のチャンネル切り替えフレームが大きさを示している場合はそれに従う
+				auto size = (i != 0U)?CDFSMETAFrame::DeclaredSize(frames[i - 1U]):size_t(0U);
+				if (size == 0U) { size = 240U; }
+				if ((i == lastdata)&&(finfsize.has_value())) { size = (written < *finfsize)?(((*finfsize - written) < size)?size_t(*finfsize - written):size):size_t(0U); }
+				stream.write((const std::ostream::char_type*)frames[i].data.data(), std::streamsize(size));
+				written += size;
+			}
+			continue;
+		}
+		auto slot = consumed % slotcount;
+		auto lock = std::unique_lock(mutex);
+		decoded.wait(lock, [&]() { return bool(ready[slot]); });
+		auto result = results[slot];
+		lock.unlock();
+		if (!result.has_value()) { success = false; break; }
+		stream.write((const std::ostream::char_type*)slots[slot].get(), std::streamsize(*result));
+		written += *result;
+		lock.lock();
+		ready[slot] = false;
+		++consumed;
+		claimable.notify_all();
+	}
+	{
+		auto lock = std::unique_lock(mutex);
+		aborted = true;
+		claimable.notify_all();
+	}
+	for (auto& worker: workers) { worker.join(); }
+	return success&&(!stream.fail());
+}
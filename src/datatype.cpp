@@ -1,6 +1,7 @@
 //	zawa-ch/cdfs:/src/datatype
 //	Copyright 2020 zawa-ch.
 //
+#include <exception>
 #include "cdfs/datatype.hpp"
 using namespace zawa_ch::CDFS;
 
@@ -38,14 +39,6 @@ CDFSHEADFrame::CDFSHEADFrame(CDFSFrame&& frame) : frame(frame)
 const CDFSFrame& CDFSHEADFrame::Frame() const { return frame; }
 uint64_t& CDFSHEADFrame::sequence() { return frame.sequence; }
 const uint64_t& CDFSHEADFrame::sequence() const { return frame.sequence; }
-uint32_t& CDFSHEADFrame::data_version() { return reinterpret_cast<uint32_t&>(frame.data[0]); }
-const uint32_t& CDFSHEADFrame::data_version() const { return reinterpret_cast<const uint32_t&>(frame.data[0]); }
-UInt128& CDFSHEADFrame::data_count() { return reinterpret_cast<UInt128&>(frame.data[4]); }
-const UInt128& CDFSHEADFrame::data_count() const { return reinterpret_cast<const UInt128&>(frame.data[4]); }
-std::array<char, 32>& CDFSHEADFrame::data_label() { return reinterpret_cast<std::array<char, 32>&>(frame.data[20]); }
-const std::array<char, 32>& CDFSHEADFrame::data_label() const { return reinterpret_cast<const std::array<char, 32>&>(frame.data[20]); }
-UInt128& CDFSHEADFrame::data_size() { return reinterpret_cast<UInt128&>(frame.data[52]); }
-const UInt128& CDFSHEADFrame::data_size() const { return reinterpret_cast<const UInt128&>(frame.data[52]); }
 void CDFSHEADFrame::Validate() { frame.Validate(); }
 bool CDFSHEADFrame::IsValid() const { return frame.IsValid(); }
 bool CDFSHEADFrame::IsHEADFrame(const CDFSFrame& frame) { return frame.frametype == CDFSFrameTypes::HEAD; }
@@ -67,12 +60,6 @@ CDFSFINFFrame::CDFSFINFFrame(CDFSFrame&& frame) : frame(frame)
 const CDFSFrame& CDFSFINFFrame::Frame() const { return frame; }
 uint64_t& CDFSFINFFrame::sequence() { return frame.sequence; }
 const uint64_t& CDFSFINFFrame::sequence() const { return frame.sequence; }
-UInt128& CDFSFINFFrame::data_count() { return reinterpret_cast<UInt128&>(frame.data[4]); }
-const UInt128& CDFSFINFFrame::data_count() const { return reinterpret_cast<const UInt128&>(frame.data[4]); }
-std::array<uint8_t, 32>& CDFSFINFFrame::data_hash() { return reinterpret_cast<std::array<uint8_t, 32>&>(frame.data[20]); }
-const std::array<uint8_t, 32>& CDFSFINFFrame::data_hash() const { return reinterpret_cast<const std::array<uint8_t, 32>&>(frame.data[20]); }
-UInt128& CDFSFINFFrame::data_size() { return reinterpret_cast<UInt128&>(frame.data[52]); }
-const UInt128& CDFSFINFFrame::data_size() const { return reinterpret_cast<const UInt128&>(frame.data[52]); }
 void CDFSFINFFrame::Validate() { frame.Validate(); }
 bool CDFSFINFFrame::IsValid() const { return frame.IsValid(); }
 bool CDFSFINFFrame::IsFINFFrame(const CDFSFrame& frame) { return frame.frametype == CDFSFrameTypes::FINF; }
@@ -117,10 +104,59 @@ CDFSCONTFrame::CDFSCONTFrame(CDFSFrame&& frame) : frame(frame)
 const CDFSFrame& CDFSCONTFrame::Frame() const { return frame; }
 uint64_t& CDFSCONTFrame::sequence() { return frame.sequence; }
 const uint64_t& CDFSCONTFrame::sequence() const { return frame.sequence; }
-UInt128& CDFSCONTFrame::data_current() { return reinterpret_cast<UInt128&>(frame.data[4]); }
-const UInt128& CDFSCONTFrame::data_current() const { return reinterpret_cast<const UInt128&>(frame.data[4]); }
-std::array<char, 32>& CDFSCONTFrame::data_label() { return reinterpret_cast<std::array<char, 32>&>(frame.data[20]); }
-const std::array<char, 32>& CDFSCONTFrame::data_label() const { return reinterpret_cast<const std::array<char, 32>&>(frame.data[20]); }
 void CDFSCONTFrame::Validate() { frame.Validate(); }
 bool CDFSCONTFrame::IsValid() const { return frame.IsValid(); }
 bool CDFSCONTFrame::IsCONTFrame(const CDFSFrame& frame) { return frame.frametype == CDFSFrameTypes::CONT; }
+
+CDFSCMPRFrame::CDFSCMPRFrame() : frame()
+{
+	frame.frametype = CDFSFrameTypes::CMPR;
+}
+CDFSCMPRFrame::CDFSCMPRFrame(const CDFSFrame& frame) : frame(frame)
+{
+	// TODO: 適切な例外の設定
+	if (!IsCMPRFrame(this->frame)) { throw std::exception(); }
+}
+CDFSCMPRFrame::CDFSCMPRFrame(CDFSFrame&& frame) : frame(frame)
+{
+	// TODO: 適切な例外の設定
+	if (!IsCMPRFrame(this->frame)) { throw std::exception(); }
+}
+const CDFSFrame& CDFSCMPRFrame::Frame() const { return frame; }
+uint64_t& CDFSCMPRFrame::sequence() { return frame.sequence; }
+const uint64_t& CDFSCMPRFrame::sequence() const { return frame.sequence; }
+void CDFSCMPRFrame::Validate() { frame.Validate(); }
+bool CDFSCMPRFrame::IsValid() const { return frame.IsValid(); }
+bool CDFSCMPRFrame::IsCMPRFrame(const CDFSFrame& frame) { return frame.frametype == CDFSFrameTypes::CMPR; }
+
+CDFSMETAFrame::CDFSMETAFrame() : frame()
+{
+	frame.frametype = CDFSFrameTypes::META;
+}
+CDFSMETAFrame::CDFSMETAFrame(const CDFSFrame& frame) : frame(frame)
+{
+	// TODO: 適切な例外の設定
+	if (!IsMETAFrame(this->frame)) { throw std::exception(); }
+}
+CDFSMETAFrame::CDFSMETAFrame(CDFSFrame&& frame) : frame(frame)
+{
+	// TODO: 適切な例外の設定
+	if (!IsMETAFrame(this->frame)) { throw std::exception(); }
+}
+const CDFSFrame& CDFSMETAFrame::Frame() const { return frame; }
+uint64_t& CDFSMETAFrame::sequence() { return frame.sequence; }
+const uint64_t& CDFSMETAFrame::sequence() const { return frame.sequence; }
+void CDFSMETAFrame::Validate() { frame.Validate(); }
+bool CDFSMETAFrame::IsValid() const { return frame.IsValid(); }
+bool CDFSMETAFrame::IsMETAFrame(const CDFSFrame& frame) { return frame.frametype == CDFSFrameTypes::META; }
+bool CDFSMETAFrame::IsCHANFrame(const CDFSFrame& frame)
+{
+	return (IsMETAFrame(frame))&&(CDFSMETALayout<>::Type::Load(frame.Bytes()) == CDFSMetaTypes::CHAN);
+}
+size_t CDFSMETAFrame::DeclaredSize(const CDFSFrame& frame)
+{
+	if ((!IsCHANFrame(frame))||(!frame.IsValid())) { return 0U; }
+	auto length = CDFSMETALayout<>::Length::Load(frame.Bytes());
+	// データフレームに収まらない大きさは無効
+	return (length < frame.data.size())?size_t(length):0U;
+}
@@ -0,0 +1,431 @@
+//	zawa-ch/cdfs:/src/filebuffer
+//	Copyright 2020 zawa-ch.
+//
+#include <cerrno>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "cdfs/filebuffer.hpp"
+#if defined(CDFS_HAS_IO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if !defined(__NR_io_uring_setup) || !defined(__NR_io_uring_enter)
+#undef CDFS_HAS_IO_URING
+#endif
+#endif
+using namespace zawa_ch::CDFS;
+
+namespace
+{
+	///	指定された大きさになるまで同期的に読み書きを行います。
+	///	@param	done	既に読み書きが完了した大きさ。
+	///	@return	読み書きが完了した大きさ。エラーが発生した場合は -1 。
+	std::streamsize Transfer(const int& descriptor, const bool& write, char* data, const size_t& size, const off_t& offset, size_t done) noexcept
+	{
+		while (done < size)
+		{
+			auto result = write
+				? ::pwrite(descriptor, data + done, size - done, offset + off_t(done))
+				: ::pread(descriptor, data + done, size - done, offset + off_t(done));
+			if (result < 0)
+			{
+				if (errno == EINTR) { continue; }
+				return -1;
+			}
+			// ファイルの終端
+			if (result == 0) { break; }
+			done += size_t(result);
+		}
+		return std::streamsize(done);
+	}
+}
+
+#if defined(CDFS_HAS_IO_URING)
+struct CDFSFileBuffer::Ring final
+{
+public:
+	int descriptor = -1;
+	void* sqmap = MAP_FAILED;
+	size_t sqmapsize = 0U;
+	void* cqmap = MAP_FAILED;
+	size_t cqmapsize = 0U;
+	io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+	size_t sqessize = 0U;
+	unsigned* sqtail = nullptr;
+	unsigned* sqmask = nullptr;
+	unsigned* sqarray = nullptr;
+	unsigned* cqhead = nullptr;
+	unsigned* cqtail = nullptr;
+	unsigned* cqmask = nullptr;
+	io_uring_cqe* cqes = nullptr;
+	///	各ブロックの読み書きに使用するベクタ。(完了するまで保持する必要があります)
+	std::vector<iovec> vectors;
+
+	Ring() = default;
+	Ring(const Ring&) = delete;
+	Ring& operator=(const Ring&) = delete;
+	~Ring()
+	{
+		if (sqes != MAP_FAILED) { ::munmap(sqes, sqessize); }
+		if ((cqmap != MAP_FAILED)&&(cqmap != sqmap)) { ::munmap(cqmap, cqmapsize); }
+		if (sqmap != MAP_FAILED) { ::munmap(sqmap, sqmapsize); }
+		if (descriptor >= 0) { ::close(descriptor); }
+	}
+
+	///	指定された数のエントリを持つリングを作成します。
+	bool Setup(const size_t& entries) noexcept
+	{
+		auto params = io_uring_params();
+		descriptor = int(::syscall(__NR_io_uring_setup, unsigned(entries), &params));
+		if (descriptor < 0) { return false; }
+		sqmapsize = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+		cqmapsize = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+		// 送信キューと完了キューを一度にマップできる場合はまとめてマップする
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			if (sqmapsize < cqmapsize) { sqmapsize = cqmapsize; }
+			cqmapsize = sqmapsize;
+		}
+		sqmap = ::mmap(nullptr, sqmapsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+		if (sqmap == MAP_FAILED) { return false; }
+		if (params.features & IORING_FEAT_SINGLE_MMAP) { cqmap = sqmap; }
+		else
+		{
+			cqmap = ::mmap(nullptr, cqmapsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+			if (cqmap == MAP_FAILED) { return false; }
+		}
+		sqessize = params.sq_entries * sizeof(io_uring_sqe);
+		sqes = (io_uring_sqe*)::mmap(nullptr, sqessize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED) { return false; }
+		auto sq = (uint8_t*)sqmap;
+		sqtail = (unsigned*)(sq + params.sq_off.tail);
+		sqmask = (unsigned*)(sq + params.sq_off.ring_mask);
+		sqarray = (unsigned*)(sq + params.sq_off.array);
+		auto cq = (uint8_t*)cqmap;
+		cqhead = (unsigned*)(cq + params.cq_off.head);
+		cqtail = (unsigned*)(cq + params.cq_off.tail);
+		cqmask = (unsigned*)(cq + params.cq_off.ring_mask);
+		cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+		vectors.resize(entries);
+		return true;
+	}
+	///	読み込みまたは書き込みを発行します。
+	///	@return	発行に成功した場合は @a true 。
+	bool Submit(const bool& write, const int& file, const size_t& index, void* data, const size_t& size, const off_t& offset) noexcept
+	{
+		vectors[index].iov_base = data;
+		vectors[index].iov_len = size;
+		// 送信キューの操作はこのスレッドのみが行うため、末尾の読み出しに同期は不要
+		auto tail = *sqtail;
+		auto slot = tail & *sqmask;
+		auto& sqe = sqes[slot];
+		sqe = io_uring_sqe();
+		sqe.opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe.fd = file;
+		sqe.off = uint64_t(offset);
+		sqe.addr = uint64_t(uintptr_t(&vectors[index]));
+		sqe.len = 1U;
+		sqe.user_data = uint64_t(index);
+		sqarray[slot] = slot;
+		__atomic_store_n(sqtail, tail + 1U, __ATOMIC_RELEASE);
+		while (true)
+		{
+			auto result = ::syscall(__NR_io_uring_enter, descriptor, 1U, 0U, 0U, nullptr, 0U);
+			if (result == 1) { return true; }
+			if ((result < 0)&&(errno == EINTR)) { continue; }
+			// 発行できなかったエントリは取り消す
+			__atomic_store_n(sqtail, tail, __ATOMIC_RELEASE);
+			return false;
+		}
+	}
+	///	完了した読み書きを1つ取得します。完了したものがない場合は完了するまで待機します。
+	///	@return	取得に成功した場合は @a true 。
+	bool Reap(size_t& index, std::streamsize& result) noexcept
+	{
+		while (true)
+		{
+			auto head = *cqhead;
+			if (head != __atomic_load_n(cqtail, __ATOMIC_ACQUIRE))
+			{
+				const auto& cqe = cqes[head & *cqmask];
+				index = size_t(cqe.user_data);
+				result = std::streamsize(cqe.res);
+				__atomic_store_n(cqhead, head + 1U, __ATOMIC_RELEASE);
+				return true;
+			}
+			auto entered = ::syscall(__NR_io_uring_enter, descriptor, 0U, 1U, IORING_ENTER_GETEVENTS, nullptr, 0U);
+			if ((entered < 0)&&(errno != EINTR)) { return false; }
+		}
+	}
+};
+#else
+struct CDFSFileBuffer::Ring final
+{
+};
+#endif
+
+CDFSFileBuffer::CDFSFileBuffer()
+	: descriptor(-1), mode(), backend(Backends::Blocking), blocksize(), blocks(), ring(), current(), readahead(), fault()
+{}
+CDFSFileBuffer::CDFSFileBuffer(const std::string& path, const std::ios_base::openmode& mode, const Backends& backend, const size_t& blocksize, const size_t& depth)
+	: CDFSFileBuffer()
+{
+	Open(path, mode, backend, blocksize, depth);
+}
+CDFSFileBuffer::~CDFSFileBuffer() { Close(); }
+
+bool CDFSFileBuffer::Open(const std::string& path, const std::ios_base::openmode& mode, const Backends& backend, const size_t& blocksize, const size_t& depth)
+{
+	Close();
+	auto input = bool(mode & std::ios_base::in);
+	auto output = bool(mode & std::ios_base::out);
+	// 読み込みと書き込みのいずれか一方のみを受け付ける
+	if (input == output) { return false; }
+	auto flags = input ? (O_RDONLY | O_CLOEXEC) : (O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC);
+	descriptor = ::open(path.c_str(), flags, 0666);
+	if (descriptor < 0) { return false; }
+	this->mode = input ? std::ios_base::in : std::ios_base::out;
+	// ブロックの大きさはフレームの大きさの倍数とする
+	this->blocksize = (blocksize < sizeof(CDFSFrame)) ? sizeof(CDFSFrame) : ((blocksize + sizeof(CDFSFrame) - 1U) / sizeof(CDFSFrame) * sizeof(CDFSFrame));
+	blocks.resize((depth == 0U) ? 1U : depth);
+	for (auto& block : blocks)
+	{
+		block.data = std::make_unique<char_type[]>(this->blocksize);
+		block.offset = 0;
+		block.size = 0U;
+		block.result = 0;
+		block.pending = false;
+	}
+	this->backend = Backends::Blocking;
+#if defined(CDFS_HAS_IO_URING)
+	if (backend == Backends::IOUring)
+	{
+		auto created = std::make_unique<Ring>();
+		if (created->Setup(blocks.size()))
+		{
+			ring = std::move(created);
+			this->backend = Backends::IOUring;
+		}
+	}
+#else
+	(void)backend;
+#endif
+	current = 0U;
+	fault = false;
+	if (input) { RestartRead(0); }
+	else { setp(blocks[0].data.get(), blocks[0].data.get() + this->blocksize); }
+	return true;
+}
+bool CDFSFileBuffer::Close()
+{
+	if (descriptor < 0) { return true; }
+	if (mode & std::ios_base::out) { FlushPut(); }
+	WaitAll();
+	auto result = !fault;
+	if (::close(descriptor) != 0) { result = false; }
+	descriptor = -1;
+	ring.reset();
+	blocks.clear();
+	setg(nullptr, nullptr, nullptr);
+	setp(nullptr, nullptr);
+	return result;
+}
+bool CDFSFileBuffer::IsOpen() const noexcept { return descriptor >= 0; }
+CDFSFileBuffer::Backends CDFSFileBuffer::ActiveBackend() const noexcept { return backend; }
+bool CDFSFileBuffer::IsSupported(const Backends& backend) noexcept
+{
+	switch (backend)
+	{
+	case Backends::Blocking: { return true; }
+	case Backends::IOUring:
+	{
+#if defined(CDFS_HAS_IO_URING)
+		// カーネルの設定やサンドボックスにより無効化されている場合があるため、実際に作成して確認する
+		static const bool supported = []() { auto ring = Ring(); return ring.Setup(1U); }();
+		return supported;
+#else
+		return false;
+#endif
+	}
+	default: { return false; }
+	}
+}
+
+void CDFSFileBuffer::SubmitRead(const size_t& index, const off_type& offset)
+{
+	auto& block = blocks[index];
+	block.offset = offset;
+	block.size = blocksize;
+	block.result = 0;
+#if defined(CDFS_HAS_IO_URING)
+	if ((ring)&&(ring->Submit(false, descriptor, index, block.data.get(), block.size, off_t(offset))))
+	{
+		block.pending = true;
+		return;
+	}
+#endif
+	block.result = Transfer(descriptor, false, block.data.get(), block.size, off_t(offset), 0U);
+	block.pending = false;
+}
+void CDFSFileBuffer::SubmitWrite(const size_t& index, const off_type& offset, const size_t& size)
+{
+	auto& block = blocks[index];
+	block.offset = offset;
+	block.size = size;
+	block.result = 0;
+#if defined(CDFS_HAS_IO_URING)
+	if ((ring)&&(ring->Submit(true, descriptor, index, block.data.get(), block.size, off_t(offset))))
+	{
+		block.pending = true;
+		return;
+	}
+#endif
+	block.result = Transfer(descriptor, true, block.data.get(), block.size, off_t(offset), 0U);
+	block.pending = false;
+	if (block.result != std::streamsize(block.size)) { fault = true; }
+}
+void CDFSFileBuffer::Wait(const size_t& index)
+{
+#if defined(CDFS_HAS_IO_URING)
+	auto write = bool(mode & std::ios_base::out);
+	while (blocks[index].pending)
+	{
+		size_t completed;
+		std::streamsize result;
+		if (!ring->Reap(completed, result))
+		{
+			// 完了を取得できない場合は発行中のものをすべて失敗として扱う
+			for (auto& block : blocks)
+			{
+				if (block.pending) { block.result = -1; block.pending = false; }
+			}
+			fault = true;
+			break;
+		}
+		auto& block = blocks[completed];
+		block.pending = false;
+		// 一度で読み書きできなかった残りは同期的に処理する
+		if (result < 0) { block.result = -1; }
+		else { block.result = Transfer(descriptor, write, block.data.get(), block.size, off_t(block.offset), size_t(result)); }
+		if ((write)&&(block.result != std::streamsize(block.size))) { fault = true; }
+	}
+#else
+	(void)index;
+#endif
+}
+void CDFSFileBuffer::WaitAll()
+{
+	for (size_t i = 0; i < blocks.size(); i++) { Wait(i); }
+}
+void CDFSFileBuffer::RestartRead(const off_type& offset)
+{
+	WaitAll();
+	current = 0U;
+	readahead = offset;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		SubmitRead(i, readahead);
+		readahead += off_type(blocksize);
+	}
+	setg(nullptr, nullptr, nullptr);
+}
+void CDFSFileBuffer::FlushPut()
+{
+	auto size = size_t(pptr() - pbase());
+	auto offset = blocks[current].offset;
+	if (size != 0U) { SubmitWrite(current, offset, size); }
+	// 次のブロックの書き込みの完了を待ってからバッファとして使用する
+	current = (current + 1U) % blocks.size();
+	Wait(current);
+	blocks[current].offset = offset + off_type(size);
+	setp(blocks[current].data.get(), blocks[current].data.get() + blocksize);
+}
+CDFSFileBuffer::off_type CDFSFileBuffer::Position() const noexcept
+{
+	if (mode & std::ios_base::out) { return blocks[current].offset + off_type(pptr() - pbase()); }
+	if (eback() == nullptr) { return blocks[current].offset; }
+	return blocks[current].offset + off_type(gptr() - eback());
+}
+
+CDFSFileBuffer::int_type CDFSFileBuffer::underflow()
+{
+	if ((descriptor < 0)||(!(mode & std::ios_base::in))) { return traits_type::eof(); }
+	if (gptr() < egptr()) { return traits_type::to_int_type(*gptr()); }
+	if (eback() != nullptr)
+	{
+		// 短い読み込みはファイルの終端を表す
+		if (blocks[current].result != std::streamsize(blocks[current].size)) { return traits_type::eof(); }
+		// 読み終えたブロックで次の先読みを発行する
+		SubmitRead(current, readahead);
+		readahead += off_type(blocksize);
+		current = (current + 1U) % blocks.size();
+	}
+	Wait(current);
+	auto& block = blocks[current];
+	auto size = (block.result < 0) ? 0 : block.result;
+	setg(block.data.get(), block.data.get(), block.data.get() + size);
+	if (size == 0) { return traits_type::eof(); }
+	return traits_type::to_int_type(*gptr());
+}
+CDFSFileBuffer::int_type CDFSFileBuffer::overflow(int_type c)
+{
+	if ((descriptor < 0)||(!(mode & std::ios_base::out))) { return traits_type::eof(); }
+	FlushPut();
+	if (fault) { return traits_type::eof(); }
+	if (!traits_type::eq_int_type(c, traits_type::eof()))
+	{
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+int CDFSFileBuffer::sync()
+{
+	if (descriptor < 0) { return -1; }
+	if (mode & std::ios_base::out)
+	{
+		FlushPut();
+		WaitAll();
+	}
+	return fault ? -1 : 0;
+}
+CDFSFileBuffer::pos_type CDFSFileBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	if ((descriptor < 0)||(!(which & mode))) { return pos_type(off_type(-1)); }
+	auto base = off_type(0);
+	if (dir == std::ios_base::cur) { base = Position(); }
+	else if (dir == std::ios_base::end)
+	{
+		// 書き込み中のデータをファイルの大きさに反映する
+		if (mode & std::ios_base::out) { sync(); }
+		struct stat status = {};
+		if (::fstat(descriptor, &status) != 0) { return pos_type(off_type(-1)); }
+		base = off_type(status.st_size);
+	}
+	return seekpos(pos_type(base + off), which);
+}
+CDFSFileBuffer::pos_type CDFSFileBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	auto target = off_type(pos);
+	if ((descriptor < 0)||(!(which & mode))||(target < 0)) { return pos_type(off_type(-1)); }
+	// 現在の位置の取得ではバッファを破棄しない
+	if (target == Position()) { return pos; }
+	if (mode & std::ios_base::out)
+	{
+		if (sync() != 0) { return pos_type(off_type(-1)); }
+		blocks[current].offset = target;
+		return pos;
+	}
+	// 読み込み済みのブロック内であれば読み込み位置のみを移動する
+	auto& block = blocks[current];
+	if ((eback() != nullptr)&&(block.offset <= target)&&(target <= (block.offset + off_type(egptr() - eback()))))
+	{
+		setg(eback(), eback() + (target - block.offset), egptr());
+		return pos;
+	}
+	RestartRead(target);
+	return pos;
+}
@@ -0,0 +1,145 @@
+//	zawa-ch/cdfs:/src/framerange
+//	Copyright 2020 zawa-ch.
+//
+#include <cstring>
+#include "cdfs/framerange.hpp"
+#include "cdfs/compression.hpp"
+using namespace zawa_ch::CDFS;
+
+CDFSFrameRange::CDFSFrameRange() noexcept : frames(), datasize(), lastdata() {}
+CDFSFrameRange::CDFSFrameRange(const Span<const CDFSFrame>& frames) noexcept
+	: frames(frames), datasize(), lastdata()
+{
+	if (frames.empty()) { return; }
+	// 終了フレームがあればその総サイズを、なければ開始フレームの総サイズを使用する
+	const auto& last = frames[frames.size() - 1U];
+	const auto& first = frames[0];
+	if ((CDFSFINFFrame::IsFINFFrame(last))&&(last.IsValid())) { datasize = CDFSFINFView(last).data_size(); }
+	else if ((CDFSHEADFrame::IsHEADFrame(first))&&(first.IsValid())) { datasize = CDFSHEADView(first).data_size(); }
+	Locate();
+}
+CDFSFrameRange::CDFSFrameRange(const Span<const CDFSFrame>& frames, const UInt128& datasize) noexcept
+	: frames(frames), datasize(datasize), lastdata()
+{
+	Locate();
+}
+void CDFSFrameRange::Locate() noexcept
+{
+	lastdata = nullptr;
+	// 総サイズが不明な場合はすべてのデータフレームが240バイトを保持しているものとみなす
+	if (datasize == 0U) { return; }
+	// 終了フレームの直前にチャンネル切り替えがある場合、240バイトを満たさないデータフレームはすべて大きさが示されている
+	auto count = frames.size();
+	if ((2U <= count)&&(CDFSFINFFrame::IsFINFFrame(frames[count - 1U]))&&(CDFSMETAFrame::IsCHANFrame(frames[count - 2U]))) { return; }
+	// 最後のデータフレームを末尾から探す
+	// (後に圧縮フレームが続くデータフレームは満たされている)
+	for (auto i = count; 0U < i; i--)
+	{
+		if (CDFSCMPRFrame::IsCMPRFrame(frames[i - 1U])) { break; }
+		if (CDFSDATAFrame::IsDATAFrame(frames[i - 1U])) { lastdata = &frames[i - 1U]; break; }
+	}
+}
+size_t CDFSFrameRange::LastDataSize(const UInt128* preceding) const noexcept
+{
+	if (preceding != nullptr) { return Remain(*preceding); }
+	///	最後のデータフレームより前のデータの大きさ
+	auto counted = UInt128(0U);
+	auto anchored = false;
+	for (auto i = size_t(lastdata - frames.begin()); 0U < i; i--)
+	{
+		const auto& frame = frames[i - 1U];
+		if (CDFSHEADFrame::IsHEADFrame(frame))
+		{
+			anchored = true;
+			break;
+		}
+		if ((CDFSCONTFrame::IsCONTFrame(frame))&&(frame.IsValid()))
+		{
+			// 継続フレームがそれまでのデータサイズを記録している場合はそこから数える
+			auto cont = CDFSCONTView(frame);
+			if (cont.data_size() != 0U)
+			{
+				counted += cont.data_size();
+				anchored = true;
+				break;
+			}
+		}
+		else if (CDFSDATAFrame::IsDATAFrame(frame))
+		{
+			auto declared = ((1U < i)&&(CDFSMETAFrame::IsMETAFrame(frames[i - 2U])))?CDFSMETAFrame::DeclaredSize(frames[i - 2U]):size_t(0U);
+			counted += (declared != 0U)?declared:frame.data.size();
+		}
+		else if (CDFSCMPRFrame::IsCMPRFrame(frame))
+		{
+			auto cmpr = CDFSCMPRView(frame);
+			if (cmpr.data_part() == 0U) { counted += CDFSCompression::DecodedSize(cmpr.data_content().data(), cmpr.data_content().size()).value_or(0U); }
+		}
+	}
+	// 数え始める位置が見つからない場合は、すべてのデータフレームが240バイトを保持しているものとみなす
+	if (!anchored) { return size_t((datasize - 1U) % 240U) + 1U; }
+	return Remain(counted);
+}
+size_t CDFSFrameRange::Remain(const UInt128& preceding) const noexcept
+{
+	if ((datasize < preceding)||(UInt128(240U) <= (datasize - preceding))) { return 240U; }
+	return size_t(datasize - preceding);
+}
+uint32_t CDFSFrameRange::Announce(const CDFSFrame& frame, const uint32_t& channel) noexcept
+{
+	if ((!CDFSMETAFrame::IsCHANFrame(frame))||(!frame.IsValid())) { return channel; }
+	return CDFSMETAView(frame).data_channel();
+}
+CDFSPayloadRange CDFSFrameRange::Payload() const { return CDFSPayloadRange(*this); }
+
+CDFSPayloadRange::CDFSPayloadRange(const CDFSFrameRange& frames) : frames(frames), block(), raw(), fault() {}
+Span<const uint8_t> CDFSPayloadRange::Expand(const CDFSFrame& first, CDFSFrameRange::Iterator& next)
+{
+	auto cmpr = CDFSCMPRView(first);
+	auto parts = size_t(cmpr.data_parts());
+	// ブロックの途中から始まる場合は次のブロックの先頭まで読み飛ばす
+	if (cmpr.data_part() != 0U) { return Span<const uint8_t>(); }
+	if (block.empty())
+	{
+		block.resize(CDFSCompression::FrameCount(CDFSCompression::MaxEncodedSize) * CDFSCMPRFrame::ContentSize);
+		raw.resize(CDFSCompression::BlockSize);
+	}
+	if ((parts == 0U)||(block.size() < (parts * CDFSCMPRFrame::ContentSize)))
+	{
+		fault = true;
+		return Span<const uint8_t>();
+	}
+	// フレームに分割されたブロックを連結する
+	std::memcpy(block.data(), cmpr.data_content().data(), cmpr.data_content().size());
+	auto size = cmpr.data_content().size();
+	auto last = frames.end();
+	for (size_t i = 1U; i < parts; i++)
+	{
+		if (next == last)
+		{
+			fault = true;
+			return Span<const uint8_t>();
+		}
+		const auto& frame = (*next).Frame();
+		if (!CDFSCMPRFrame::IsCMPRFrame(frame))
+		{
+			fault = true;
+			return Span<const uint8_t>();
+		}
+		auto part = CDFSCMPRView(frame);
+		if ((part.data_part() != i)||(part.data_parts() != parts))
+		{
+			fault = true;
+			return Span<const uint8_t>();
+		}
+		std::memcpy(block.data() + size, part.data_content().data(), part.data_content().size());
+		size += part.data_content().size();
+		++next;
+	}
+	auto decoded = CDFSCompression::DecodeBlock(block.data(), size, raw.data());
+	if (!decoded.has_value())
+	{
+		fault = true;
+		return Span<const uint8_t>();
+	}
+	return Span<const uint8_t>(raw.data(), *decoded);
+}
@@ -0,0 +1,358 @@
+//	zawa-ch/cdfs:/src/index
+//	Copyright 2020 zawa-ch.
+//
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <limits>
+#include "cdfs/index.hpp"
+#include "cdfs/loader.hpp"
+#include "cdfs/compression.hpp"
+using namespace zawa_ch::CDFS;
+
+namespace
+{
+	///	索引ファイルのヘッダの大きさ。
+	constexpr size_t HeaderSize = 0x48;
+	///	索引ファイルのチェックポイント1つあたりの大きさ。
+	constexpr size_t CheckpointSize = 24;
+	///	索引ファイルのデータフレーム以外のフレーム1つあたりの大きさ。
+	constexpr size_t MarkerSize = 32;
+	///	終了フレームまで追加されていることを表すフラグ。
+	constexpr uint32_t CompleteFlag = 0x00000001;
+	///	索引ファイルのヘッダ以降を一度に読み込む最大の大きさ。
+	constexpr size_t ReadChunkSize = 0x100000;
+
+	///	指定された値をバッファに書き込みます。
+	template<typename T>
+	void Store(std::vector<uint8_t>& buffer, const size_t& offset, const T& value) { std::memcpy(buffer.data() + offset, &value, sizeof(T)); }
+	///	バッファから値を読み込みます。
+	template<typename T>
+	T Load(const std::vector<uint8_t>& buffer, const size_t& offset) { auto value = T(); std::memcpy(&value, buffer.data() + offset, sizeof(T)); return value; }
+}
+
+CDFSIndex::CDFSIndex(const size_t& interval)
+	: interval((interval != 0U)?interval:DefaultInterval), framecount(), datasize(), headchecksum(), finfchecksum(), complete(), checkpoints(), markers(), summary(), blockrawsize(), declared()
+{}
+
+void CDFSIndex::Append(const CDFSFrame& frame)
+{
+	// 書き直された開始フレーム
+	if ((frame.sequence == 0U)&&(framecount != 0U)&&(CDFSHEADFrame::IsHEADFrame(frame)))
+	{
+		headchecksum = frame.checksum;
+		return;
+	}
+	if ((complete)||(frame.sequence != framecount)) { return; }
+	// ブロックの先頭ではチェックポイントを追加する
+	if ((framecount % interval) == 0U)
+	{
+		checkpoints.push_back(Checkpoint{ datasize, 0U });
+		summary = CRC32();
+	}
+	// 開始フレームは書き直される場合があるため要約に含めず、チェックサムを個別に保持する
+	if (framecount != 0U)
+	{
+		auto checksum = (const uint8_t*)&frame.checksum;
+		summary.Push(checksum, checksum + sizeof(frame.checksum));
+		checkpoints.back().summary = summary.GetValue();
+	}
+	///	圧縮フレームのブロック内での位置
+	uint16_t part = 0U;
+	///	圧縮フレームのブロックを構成するフレーム数
+	uint16_t parts = 0U;
+	///	直前のフレームが示したデータフレームの大きさ
+	auto length = declared;
+	declared = 0U;
+	switch (frame.frametype)
+	{
+	case CDFSFrameTypes::DATA: { datasize += (length != 0U)?length:frame.data.size(); break; }
+	case CDFSFrameTypes::META: { declared = CDFSMETAFrame::DeclaredSize(frame); break; }
+	case CDFSFrameTypes::CMPR:
+	{
+		// ブロックの展開後の大きさは先頭のフレームから取得し、最後のフレームでデータの大きさに加える
+		auto cmpr = CDFSCMPRView(frame);
+		part = cmpr.data_part();
+		parts = cmpr.data_parts();
+		// 圧縮フレームはブロックの最初のフレームのみをブロックのデータを含めて記録する
+		if (part == 0U)
+		{
+			blockrawsize = CDFSCompression::DecodedSize(cmpr.data_content().data(), cmpr.data_content().size()).value_or(0U);
+			markers.push_back(Marker{ frame.sequence, frame.frametype, part, parts, datasize + blockrawsize });
+		}
+		if ((part + 1U) == parts)
+		{
+			datasize += blockrawsize;
+			blockrawsize = 0U;
+		}
+		break;
+	}
+	case CDFSFrameTypes::HEAD: { headchecksum = frame.checksum; break; }
+	case CDFSFrameTypes::FINF:
+	{
+		finfchecksum = frame.checksum;
+		datasize = CDFSFINFView(frame).data_size();
+		complete = true;
+		// 最後のデータフレームは240バイトとして数えているため、終了フレームがブロックの先頭の場合はチェックポイントも総サイズに置き換える
+		if ((framecount % interval) == 0U) { checkpoints.back().dataoffset = datasize; }
+		break;
+	}
+	default: { break; }
+	}
+	if ((frame.frametype != CDFSFrameTypes::DATA)&&(frame.frametype != CDFSFrameTypes::CMPR)) { markers.push_back(Marker{ frame.sequence, frame.frametype, part, parts, datasize }); }
+	++framecount;
+}
+void CDFSIndex::Append(const Span<const CDFSFrame>& frames)
+{
+	for (const auto& frame : frames) { Append(frame); }
+}
+
+size_t CDFSIndex::Interval() const noexcept { return interval; }
+uint64_t CDFSIndex::FrameCount() const noexcept { return framecount; }
+const UInt128& CDFSIndex::DataSize() const noexcept { return datasize; }
+uint32_t CDFSIndex::HEADChecksum() const noexcept { return headchecksum; }
+uint32_t CDFSIndex::FINFChecksum() const noexcept { return finfchecksum; }
+bool CDFSIndex::IsComplete() const noexcept { return complete; }
+const std::vector<CDFSIndex::Checkpoint>& CDFSIndex::Checkpoints() const noexcept { return checkpoints; }
+const std::vector<CDFSIndex::Marker>& CDFSIndex::Markers() const noexcept { return markers; }
+
+std::vector<CDFSIndex::Marker>::const_iterator CDFSIndex::FirstMarker(const uint64_t& first) const
+{
+	auto result = std::lower_bound(markers.cbegin(), markers.cend(), first, [](const Marker& marker, const uint64_t& frame) { return marker.frame < frame; });
+	if ((result != markers.cbegin())&&(first < MarkerEnd(*std::prev(result)))) { --result; }
+	return result;
+}
+uint64_t CDFSIndex::MarkerEnd(const Marker& marker) noexcept
+{
+	return marker.frame + ((marker.type == CDFSFrameTypes::CMPR)?uint64_t(marker.parts):1U);
+}
+bool CDFSIndex::IsConsistent() const noexcept
+{
+	// チェックポイントは最初のブロックのデータの位置 0 から単調に増加する
+	if ((checkpoints.empty())||(checkpoints.front().dataoffset != 0U)) { return false; }
+	for (size_t i = 1U; i < checkpoints.size(); i++)
+	{
+		if (checkpoints[i].dataoffset < checkpoints[i - 1U].dataoffset) { return false; }
+	}
+	if (datasize < checkpoints.back().dataoffset) { return false; }
+	///	直前のマーカーが表すフレームの範囲の次のフレーム
+	uint64_t base = 0U;
+	///	@a base より前に格納されたデータの大きさ
+	auto basedata = UInt128(0U);
+	for (const auto& marker : markers)
+	{
+		if ((marker.frame < base)||(framecount <= marker.frame)||(marker.part != 0U)) { return false; }
+		// 圧縮フレームのブロックはフレーム数の範囲に収まる1つ以上のフレームで構成される
+		if (marker.type == CDFSFrameTypes::CMPR)
+		{
+			if ((marker.parts == 0U)||((framecount - marker.frame) < marker.parts)) { return false; }
+		}
+		else if (marker.parts != 0U) { return false; }
+		// 間にあるデータフレームと圧縮フレームのブロックに格納できる大きさを超えてデータの位置が増加することはない
+		auto capacity = (UInt128(marker.frame - base) * 240U) + ((marker.type == CDFSFrameTypes::CMPR)?CDFSCompression::BlockSize:0U);
+		if ((marker.dataoffset < basedata)||((marker.dataoffset - basedata) > capacity)) { return false; }
+		base = MarkerEnd(marker);
+		basedata = marker.dataoffset;
+	}
+	return (basedata <= datasize)&&((datasize - basedata) <= (UInt128(framecount - base) * 240U));
+}
+UInt128 CDFSIndex::DataOffset(const uint64_t& frame) const
+{
+	if (framecount <= frame) { return datasize; }
+	auto block = size_t(frame / interval);
+	///	データフレームのみが続く範囲の最初のフレーム
+	auto base = uint64_t(block) * interval;
+	///	@a base より前に格納されたデータの大きさ
+	auto basedata = checkpoints[block].dataoffset;
+	// チェックポイントから指定されたフレームまでのデータフレーム以外のフレームを読み飛ばす
+	for (auto marker = FirstMarker(base); (marker != markers.cend())&&(marker->frame <= frame); ++marker)
+	{
+		// データフレーム以外のフレームは記録した位置を返す
+		// (大きさが示されたデータフレームの次のフレームは必ずデータフレーム以外のフレームになる)
+		if ((marker->frame == frame)&&(marker->type != CDFSFrameTypes::CMPR)) { return marker->dataoffset; }
+		// 指定されたフレームが圧縮フレームのブロックに含まれる場合はブロックより前のデータの大きさを返す
+		// (チェックポイントがブロックの途中にある場合、チェックポイントのデータの位置はブロックより前のものになる)
+		if (frame < MarkerEnd(*marker)) { return (base <= marker->frame)?(basedata + (UInt128(marker->frame - base) * 240U)):basedata; }
+		base = MarkerEnd(*marker);
+		basedata = marker->dataoffset;
+	}
+	auto result = basedata + (UInt128(frame - base) * 240U);
+	return (result < datasize)?result:datasize;
+}
+std::optional<CDFSIndex::Location> CDFSIndex::Locate(const UInt128& offset) const
+{
+	if ((datasize <= offset)||(checkpoints.empty())) { return std::nullopt; }
+	// データの位置が指定された位置以下である最後のチェックポイント
+	auto checkpoint = std::upper_bound(checkpoints.cbegin(), checkpoints.cend(), offset, [](const UInt128& value, const Checkpoint& item) { return value < item.dataoffset; });
+	auto block = size_t(checkpoint - checkpoints.cbegin()) - 1U;
+	auto base = uint64_t(block) * interval;
+	auto basedata = checkpoints[block].dataoffset;
+	// 指定された位置より前にあるデータフレーム以外のフレームを読み飛ばす
+	// (以降のチェックポイントのデータの位置は指定された位置より後にあるため、走査はブロック内で終わる)
+	for (auto marker = FirstMarker(base); marker != markers.cend(); ++marker)
+	{
+		if (offset < marker->dataoffset)
+		{
+			// 指定された位置が圧縮フレームのブロックに含まれる場合はブロックの最初のフレームを返す
+			if (marker->type == CDFSFrameTypes::CMPR)
+			{
+				auto blockdata = (base <= marker->frame)?(basedata + (UInt128(marker->frame - base) * 240U)):basedata;
+				if (blockdata <= offset) { return Location{ marker->frame, size_t(offset - blockdata) }; }
+			}
+			break;
+		}
+		base = MarkerEnd(*marker);
+		basedata = marker->dataoffset;
+	}
+	auto distance = offset - basedata;
+	return Location{ base + uint64_t(distance / 240U), size_t(distance % 240U) };
+}
+bool CDFSIndex::VerifyBlock(const size_t& block, const Span<const CDFSFrame>& frames) const
+{
+	if (checkpoints.size() <= block) { return false; }
+	auto first = uint64_t(block) * interval;
+	auto count = ((framecount - first) < interval)?size_t(framecount - first):interval;
+	if (frames.size() != count) { return false; }
+	auto crc = CRC32();
+	for (size_t i = 0; i < count; i++)
+	{
+		const auto& frame = frames[i];
+		if ((!frame.IsValid())||(!CDFSLoader::VerifySequence(frame, first + i))) { return false; }
+		if ((first + i) == 0U)
+		{
+			if (frame.checksum != headchecksum) { return false; }
+			continue;
+		}
+		auto checksum = (const uint8_t*)&frame.checksum;
+		crc.Push(checksum, checksum + sizeof(frame.checksum));
+	}
+	return crc.GetValue() == checkpoints[block].summary;
+}
+bool CDFSIndex::Matches(const CDFSFrame& head, const CDFSFrame& finf) const
+{
+	return (complete)&&(head.sequence == 0U)&&(head.checksum == headchecksum)
+		&&(finf.sequence == (framecount - 1U))&&(finf.checksum == finfchecksum);
+}
+
+bool CDFSIndex::Write(std::ostream& stream) const
+{
+	auto buffer = std::vector<uint8_t>(HeaderSize + (checkpoints.size() * CheckpointSize) + (markers.size() * MarkerSize) + sizeof(uint32_t));
+	std::memcpy(buffer.data(), Signature.data(), Signature.size());
+	Store(buffer, 0x08, Version);
+	Store(buffer, 0x0C, uint32_t(interval));
+	Store(buffer, 0x10, framecount);
+	Store(buffer, 0x18, datasize);
+	Store(buffer, 0x28, headchecksum);
+	Store(buffer, 0x2C, finfchecksum);
+	Store(buffer, 0x30, uint32_t((complete)?CompleteFlag:0U));
+	Store(buffer, 0x38, uint64_t(checkpoints.size()));
+	Store(buffer, 0x40, uint64_t(markers.size()));
+	auto offset = HeaderSize;
+	for (const auto& checkpoint : checkpoints)
+	{
+		Store(buffer, offset, checkpoint.dataoffset);
+		Store(buffer, offset + 16U, checkpoint.summary);
+		offset += CheckpointSize;
+	}
+	for (const auto& marker : markers)
+	{
+		Store(buffer, offset, marker.frame);
+		Store(buffer, offset + 8U, marker.type);
+		Store(buffer, offset + 12U, marker.part);
+		Store(buffer, offset + 14U, marker.parts);
+		Store(buffer, offset + 16U, marker.dataoffset);
+		offset += MarkerSize;
+	}
+	// 末尾に索引全体のチェックサムを付ける
+	auto crc = CRC32();
+	crc.Push(buffer.data(), buffer.data() + offset);
+	Store(buffer, offset, crc.GetValue());
+	auto sentry = std::ostream::sentry(stream);
+	if (!bool(sentry)) { return false; }
+	stream.write((const std::ostream::char_type*)buffer.data(), std::streamsize(buffer.size()));
+	return !stream.fail();
+}
+std::optional<CDFSIndex> CDFSIndex::Read(std::istream& stream)
+{
+	auto buffer = std::vector<uint8_t>(HeaderSize);
+	stream.read((std::istream::char_type*)buffer.data(), std::streamsize(buffer.size()));
+	if (size_t(stream.gcount()) != buffer.size()) { return std::nullopt; }
+	if ((std::memcmp(buffer.data(), Signature.data(), Signature.size()) != 0)||(Load<uint32_t>(buffer, 0x08) != Version)) { return std::nullopt; }
+	auto result = CDFSIndex(Load<uint32_t>(buffer, 0x0C));
+	result.framecount = Load<uint64_t>(buffer, 0x10);
+	result.datasize = Load<UInt128>(buffer, 0x18);
+	result.headchecksum = Load<uint32_t>(buffer, 0x28);
+	result.finfchecksum = Load<uint32_t>(buffer, 0x2C);
+	result.complete = (Load<uint32_t>(buffer, 0x30) & CompleteFlag) != 0U;
+	auto checkpointcount = Load<uint64_t>(buffer, 0x38);
+	auto markercount = Load<uint64_t>(buffer, 0x40);
+	// チェックポイントの数はフレーム数から定まる
+	if ((Load<uint32_t>(buffer, 0x0C) == 0U)||(checkpointcount != ((result.framecount + result.interval - 1U) / result.interval))||(result.framecount < markercount)) { return std::nullopt; }
+	// ヘッダの数は信頼できないため、大きさがオーバーフローしないことを確かめる
+	constexpr auto limit = std::numeric_limits<size_t>::max() - sizeof(uint32_t);
+	if (((limit / CheckpointSize) < checkpointcount)||((limit / MarkerSize) < markercount)) { return std::nullopt; }
+	auto checkpointsize = size_t(checkpointcount) * CheckpointSize;
+	auto markersize = size_t(markercount) * MarkerSize;
+	if ((limit - checkpointsize) < markersize) { return std::nullopt; }
+	auto bodysize = checkpointsize + markersize + sizeof(uint32_t);
+	// 実際に読み込めた分のみを確保するよう、一定の大きさずつ読み込む
+	auto body = std::vector<uint8_t>();
+	while (body.size() < bodysize)
+	{
+		auto position = body.size();
+		auto chunk = std::min(bodysize - position, ReadChunkSize);
+		body.resize(position + chunk);
+		stream.read((std::istream::char_type*)body.data() + position, std::streamsize(chunk));
+		if (size_t(stream.gcount()) != chunk) { return std::nullopt; }
+	}
+	auto offset = bodysize - sizeof(uint32_t);
+	auto crc = CRC32();
+	crc.Push(buffer.data(), buffer.data() + buffer.size());
+	crc.Push(body.data(), body.data() + offset);
+	if (crc.GetValue() != Load<uint32_t>(body, offset)) { return std::nullopt; }
+	offset = 0U;
+	result.checkpoints.resize(size_t(checkpointcount));
+	for (auto& checkpoint : result.checkpoints)
+	{
+		checkpoint.dataoffset = Load<UInt128>(body, offset);
+		checkpoint.summary = Load<uint32_t>(body, offset + 16U);
+		offset += CheckpointSize;
+	}
+	result.markers.resize(size_t(markercount));
+	for (auto& marker : result.markers)
+	{
+		marker.frame = Load<uint64_t>(body, offset);
+		marker.type = Load<CDFSFrameTypes>(body, offset + 8U);
+		marker.part = Load<uint16_t>(body, offset + 12U);
+		marker.parts = Load<uint16_t>(body, offset + 14U);
+		marker.dataoffset = Load<UInt128>(body, offset + 16U);
+		offset += MarkerSize;
+	}
+	// チェックサムが一致しても内容が矛盾している索引は、読み出し位置を誤るため使用しない
+	if (!result.IsConsistent()) { return std::nullopt; }
+	return result;
+}
+std::optional<CDFSIndex> CDFSIndex::Build(std::istream& stream, const size_t& interval)
+{
+	auto result = CDFSIndex(interval);
+	auto batch = std::vector<CDFSFrame>(CDFSLoader::BatchSize);
+	auto order = std::optional<CDFSByteOrder>();
+	stream.clear();
+	stream.seekg(0, std::ios_base::beg);
+	while ((!result.complete)&&(stream.good()))
+	{
+		stream.read((std::istream::char_type*)batch.data(), std::streamsize(sizeof(CDFSFrame) * batch.size()));
+		auto count = size_t(stream.gcount()) / sizeof(CDFSFrame);
+		// 実行環境と異なるバイト順序のCDFSデータは変換したフレームから構築する
+		if ((!order.has_value())&&(count != 0U)) { order = CDFSByteOrderConverter::Detect(batch[0]).value_or(CDFSByteOrder::Native); }
+		if (order.has_value()) { CDFSByteOrderConverter::ToNative(batch.data(), count, *order); }
+		for (size_t i = 0; (i < count)&&(!result.complete); i++)
+		{
+			// 壊れたフレームがある場合は索引を構築できない
+			if ((!batch[i].IsValid())||(!CDFSLoader::VerifySequence(batch[i], result.framecount))) { return std::nullopt; }
+			result.Append(batch[i]);
+		}
+	}
+	if (!result.complete) { return std::nullopt; }
+	return result;
+}
@@ -1,87 +1,408 @@
 //	zawa-ch/cdfs:/src/loader
 //	Copyright 2020 zawa-ch.
 //
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
 #include "cdfs/loader.hpp"
+#include "cdfs/compression.hpp"
 using namespace zawa_ch::CDFS;
 
 CDFSLoader::CDFSLoader()
-	: buffer(), label(), framecount(), frameindex(), datasize(), dataindex(), readhead(), readfinf(), fault()
+	: buffer(), label(), framecount(), frameindex(), datasize(), dataindex(), readhead(), readfinf(), fault(), valid(), payloadsize(), batch(), batchhead(), batchtail(), payload(), payloadremain(), hashtype(), hash(), hashing(), hashfault(), hashpending(), hashpendingsize(), payloadhashed(), index(), streaming(), withheld(), withheldside(), withheldsize(), nextpayload(), nextremain(), blockdata(), blockdatasize(), blockpart(), blockraw(), channel(), declared(), withheldchannel(), dense(), byteorder(CDFSByteOrder::Native), released()
 {}
 
+void CDFSLoader::EnableStreaming() { streaming = true; }
+bool CDFSLoader::IsStreaming() const noexcept { return streaming; }
 bool CDFSLoader::HasHEAD() const { return readhead; }
 bool CDFSLoader::HasFINF() const { return readfinf; }
 const UInt128& CDFSLoader::FrameIndex() const { return frameindex; }
 const UInt128& CDFSLoader::FrameCount() const { return framecount; }
 const UInt128& CDFSLoader::DataIndex() const { return dataindex; }
 const UInt128& CDFSLoader::DataSize() const { return datasize; }
+const std::optional<uint32_t>& CDFSLoader::Channel() const noexcept { return channel; }
+const CDFSByteOrder& CDFSLoader::ByteOrder() const noexcept { return byteorder; }
+#if defined(CDFS_ENABLE_COUNTERS)
+CDFSCounters CDFSLoader::Counters() const noexcept { return counters; }
+void CDFSLoader::ResetCounters() noexcept { counters = CDFSCounters(); }
+void CDFSLoader::SetCounterCallback(const CDFSCounterCallback& callback) { countercallback = callback; }
+#endif
 bool CDFSLoader::ReadNext(std::istream& stream)
 {
 	// 終了フレームが読み込まれている場合は何もしない
 	if (readfinf) { return false; }
+	// 読み出し途中のデータは破棄する
+	// (ハッシュ値に追加されていない場合は追加しておく)
+	if ((!payloadhashed)&&(hashing)&&(payloadremain != 0U)) { hash.Push(payload, payload + payloadremain); }
+	payload = nullptr;
+	payloadremain = 0U;
+	nextremain = 0U;
 	// シーケンス番号送り
 	if (buffer.has_value()) { ++frameindex; }
-	// ストリームからフレーム取得
-	buffer = ReadFrameFromStream(stream);
+	// 先読みしたフレームがある場合はそれを使用し、ない場合はストリームからフレーム取得
+	if (batchhead < batchtail) { buffer = batch[batchhead++]; }
+	else { buffer = ReadFrame(stream); }
 	// 取得に失敗した場合は処理終了
-	if (!buffer.has_value()) { return false; }
-	// フレームの検証に失敗した場合は検証失敗のフラグを立てて処理終了
-	if (!IsValidData())
+	if (!buffer.has_value()) { valid = false; return false; }
+	Accept(*buffer);
+	// 開始フレームに総サイズが記録されていない場合、シーク可能なストリームでは先に終了フレームから取得する
+	if ((!streaming)&&(valid)&&(frameindex == 0U)&&(datasize == 0U)&&(CDFSHEADFrame::IsHEADFrame(*buffer)))
 	{
-		fault = true;
-		return buffer.has_value();
+		auto position = stream.tellg();
+		if (position != std::istream::pos_type(-1))
+		{
+			LoadFINF(stream);
+			stream.clear();
+			stream.seekg(position);
+		}
 	}
-	// 開始フレームの読み込み
-	if ((!readhead)&&(CDFSHEADFrame::IsHEADFrame(*buffer)))
+	// 総サイズが分かっていない場合は ReadData と同様にデータフレームの内容を保留し、保留を解除したデータを現在のフレームのデータとする
+	released.reset();
+	if ((withheldsize != 0U)||((payloadsize != 0U)&&(datasize == 0U)))
 	{
-		auto header = CDFSHEADFrame(*buffer);
-		// フォーマットバージョン確認
-		// (対応していないフォーマットバージョンのCDFSデータが来た場合の処理は未規定)
-		if (IsVersionCompatible(header))
+		Withhold(*buffer);
+		released = std::vector<uint8_t>(payload, payload + payloadremain);
+		released->insert(released->end(), nextpayload, nextpayload + nextremain);
+		payload = nullptr;
+		payloadremain = 0U;
+		nextremain = 0U;
+	}
+	return true;
+}
+size_t CDFSLoader::ReadData(std::istream& stream, uint8_t* buffer, const size_t& capacity)
+{
+	///	コピーしたデータの大きさ
+	size_t copied = 0U;
+	///	最後に処理したフレームを現在のフレームとして保持していないか
+	// (先読みしたフレームは次の読み込みで上書きされるため、参照を残さずに読み込みの前に保持する)
+	bool pending = false;
+	///	ハッシュ値に追加していないコピーしたデータの開始位置
+	// (ハッシュ値はフレームごとではなく、コピーしたデータに対してまとめて計算する)
+	size_t hashbegin = 0U;
+	while (copied < capacity)
+	{
+		// 現在のフレームに残っているデータをコピー
+		if (payloadremain != 0U)
 		{
-			label = std::string(header.data_label().data());
-			framecount = header.data_count();
-			datasize = header.data_size();
-			readhead = true;
+			auto count = (payloadremain < (capacity - copied))?payloadremain:(capacity - copied);
+			// ハッシュ値に追加済みのデータは、それまでにコピーしたデータを追加してから読み飛ばす
+			if ((payloadhashed)&&(hashing)&&(hashbegin != copied)) { hash.Push(buffer + hashbegin, buffer + copied); }
+			std::memcpy(buffer + copied, payload, count);
+			payload += count;
+			payloadremain -= count;
+			copied += count;
+			if (payloadhashed) { hashbegin = copied; }
+			continue;
+		}
+		// 続けて読み出すデータがある場合はそれをコピー
+		if (nextremain != 0U)
+		{
+			payload = nextpayload;
+			payloadremain = nextremain;
+			nextremain = 0U;
+			continue;
+		}
+		// 終了フレームが読み込まれている場合はこれ以上読み出さない
+		if (readfinf) { break; }
+		// ストリーミングプロファイルでは、到着済みのフレームを処理し終えた時点でコピーしたデータを返す
+		if ((batchhead == batchtail)&&(streaming)&&(copied != 0U)) { break; }
+		// 先読みしたフレームがない場合はまとめてストリームから読み込む
+		if (batchhead == batchtail)
+		{
+			if (pending) { KeepFrame(); }
+			pending = false;
+			if (!FillBatch(stream)) { break; }
+		}
+		const auto& frame = batch[batchhead++];
+		// シーケンス番号送り
+		if ((this->buffer.has_value())||(pending)) { ++frameindex; }
+		pending = true;
+		// 終了フレームの照合の前に、コピーしたデータをハッシュ値に追加しておく
+		if ((hashing)&&(hashbegin != copied)&&(!CDFSDATAFrame::IsDATAFrame(frame)))
+		{
+			hash.Push(buffer + hashbegin, buffer + copied);
+			hashbegin = copied;
+		}
+		Accept(frame, false);
+		// 総サイズが分かっていない場合はデータフレームの内容を保留する
+		if ((withheldsize != 0U)||((payloadsize != 0U)&&(datasize == 0U))) { Withhold(frame); }
+		// データフレーム以外(ブロックが揃っていない圧縮フレームを含む)はデータを持たないため読み飛ばす
+		else if (payloadsize != 0U)
+		{
+			payload = PayloadData(frame);
+			payloadremain = payloadsize;
 		}
 	}
-	// 終了フレームの読み込み
-	if ((readhead)&&(!readfinf)&&(CDFSFINFFrame::IsFINFFrame(*buffer)))
+	if ((hashing)&&(hashbegin != copied)) { hash.Push(buffer + hashbegin, buffer + copied); }
+	if (pending) { KeepFrame(); }
+	return copied;
+}
+size_t CDFSLoader::Demultiplex(std::istream& stream, const ChannelConsumer& consumer)
+{
+	// 読み出し途中のデータは破棄する
+	// (ハッシュ値に追加されていない場合は追加しておく)
+	if ((!payloadhashed)&&(hashing)&&(payloadremain != 0U)) { hash.Push(payload, payload + payloadremain); }
+	payload = nullptr;
+	payloadremain = 0U;
+	nextremain = 0U;
+	///	渡したデータの大きさ
+	size_t delivered = 0U;
+	///	最後に処理したフレームを現在のフレームとして保持していないか
+	bool pending = false;
+	auto deliver = [&](const uint32_t& target, const uint8_t* data, const size_t& size)
 	{
-		auto finf = CDFSFINFFrame(*buffer);
-		if (framecount == 0) { framecount = finf.data_count(); }
-		if (datasize == 0) { datasize = finf.data_size(); }
-		readfinf = true;
+		if (size == 0U) { return; }
+		consumer(target, data, size);
+		delivered += size;
+	};
+	///	保留していたデータを渡す
+	auto release = [&](const size_t& size)
+	{
+		auto count = withheldsize;
+		withheldsize = 0U;
+		deliver(withheldchannel, withheld[withheldside].data(), (size < count)?size:count);
+	};
+	while (!readfinf)
+	{
+		// ストリーミングプロファイルでは、到着済みのフレームを処理し終えた時点で戻る
+		// (ストリーミングプロファイルではフレームを処理した後に読み込まないため、保持していないフレームがあればこの呼び出しで処理している)
+		if ((batchhead == batchtail)&&(streaming)&&(pending)) { break; }
+		// 先読みしたフレームがない場合はまとめてストリームから読み込む
+		if (batchhead == batchtail)
+		{
+			if (pending) { KeepFrame(); }
+			pending = false;
+			if (!FillBatch(stream)) { break; }
+		}
+		const auto& frame = batch[batchhead++];
+		// シーケンス番号送り
+		if ((this->buffer.has_value())||(pending)) { ++frameindex; }
+		pending = true;
+		Accept(frame);
+		if (payloadsize != 0U)
+		{
+			// 次のデータが来たため、保留していたデータフレームは切り詰められないことが確定する
+			release(SIZE_MAX);
+			// 総サイズが分かっていない場合はデータフレームの内容を保留する
+			if ((CDFSDATAFrame::IsDATAFrame(frame))&&(datasize == 0U))
+			{
+				std::memcpy(withheld[withheldside].data(), frame.data.data(), payloadsize);
+				withheldsize = payloadsize;
+				withheldchannel = channel.value_or(0U);
+			}
+			else { deliver(channel.value_or(0U), PayloadData(frame), payloadsize); }
+		}
+		else if ((readfinf)&&(withheldsize != 0U))
+		{
+			// 保留していたデータフレームを総サイズに合わせて切り詰めて渡す
+			auto excess = (datasize < dataindex)?(dataindex - datasize):UInt128(0U);
+			release((excess < withheldsize)?(withheldsize - size_t(excess)):size_t(0U));
+			dataindex -= excess;
+		}
 	}
-	// データフレームの読み込み
-	if ((readhead)&&(!readfinf)&&(CDFSDATAFrame::IsDATAFrame(*buffer)))
+	if (pending) { KeepFrame(); }
+	return delivered;
+}
+bool CDFSLoader::SeekToFrame(std::istream& stream, const UInt128& index)
+{
+	// 開始フレームが読み込まれていない場合は先に読み込む
+	if ((!readhead)&&(index != 0U))
 	{
-		dataindex += 240U;
+		if ((!SeekToFrame(stream, 0U))||(!readhead)) { return false; }
 	}
+	// 直前のフレームがチャンネル切り替えフレームの場合は、チャンネルと次のデータフレームの大きさを引き継ぐ
+	// (データフレームのみで構成されている場合はチャンネル切り替えフレームを含まない)
+	channel.reset();
+	declared = 0U;
+	if ((UInt128(1U) < index)&&((this->index.has_value())||(!IsDenseLayout())))
+	{
+		if (!SeekStream(stream, index - 1U)) { return false; }
+		auto previous = ReadFrame(stream);
+		if ((previous.has_value())&&(previous->IsValid())&&(CDFSMETAFrame::IsCHANFrame(*previous)))
+		{
+			channel = CDFSMETAView(*previous).data_channel();
+			declared = CDFSMETAFrame::DeclaredSize(*previous);
+		}
+	}
+	else if (!SeekStream(stream, index)) { return false; }
+	// 読み込み位置を指定されたフレームの直前に戻す
+	buffer.reset();
+	released.reset();
+	batchhead = 0U;
+	batchtail = 0U;
+	payload = nullptr;
+	payloadremain = 0U;
+	nextremain = 0U;
+	withheldsize = 0U;
+	blockpart = 0U;
+	readfinf = false;
+	frameindex = index;
+	// データを先頭から読み直す場合のみハッシュ値を計算できる
+	if (index == 0U)
+	{
+		dataindex = 0U;
+		ResetHash();
+	}
+	else { hashing = false; }
+	// 索引がある場合、またはデータフレームのみで構成されている場合はデータの位置も復元する
+	if (this->index.has_value()) { dataindex = this->index->DataOffset(uint64_t(index)); }
+	else if (IsDenseLayout()) { dataindex = (index != 0U)?((index - 1U) * 240U):UInt128(0U); }
+	return ReadNext(stream);
+}
+size_t CDFSLoader::ReadAt(std::istream& stream, const UInt128& offset, uint8_t* buffer, const size_t& length)
+{
+	// 開始フレームが読み込まれていない場合は先に読み込む
+	if (!readhead)
+	{
+		if ((!SeekToFrame(stream, 0U))||(!readhead)) { return 0U; }
+	}
+	// 開始フレームにフレーム数・総サイズが記録されていない場合は索引または終了フレームから取得する
+	if ((framecount == 0U)||(datasize == 0U))
+	{
+		if (index.has_value())
+		{
+			framecount = index->FrameCount();
+			datasize = index->DataSize();
+		}
+		else { LoadFINF(stream); }
+	}
+	if (datasize <= offset) { return 0U; }
+	///	読み出すデータの大きさ
+	auto size = ((datasize - offset) < length)?size_t(datasize - offset):length;
+	///	最初のデータフレーム内での読み出し開始位置
+	size_t inner;
+	///	データの位置から直接フレームの位置を求められたか
+	auto located = false;
+	if (index.has_value())
+	{
+		// 索引からデータの位置に対応するフレームの位置を求める
+		// (圧縮フレームの場合はブロックの先頭のフレームの位置とブロック内での位置が求まる)
+		auto location = index->Locate(offset);
+		if ((!location.has_value())||(!SeekToFrame(stream, location->frame))) { return 0U; }
+		inner = location->inner;
+		located = true;
+	}
+	else if (IsDenseLayout())
+	{
+		// データの位置から直接フレームの位置を求める
+		if (!SeekToFrame(stream, (offset / 240U) + 1U)) { return 0U; }
+		inner = size_t(offset % 240U);
+		located = true;
+	}
+	if (!located)
+	{
+		// データフレーム以外のフレームが含まれる場合はデータの位置を数えながら走査する
+		dataindex = 0U;
+		if (!SeekToFrame(stream, 1U)) { return 0U; }
+		while ((payloadsize == 0U)||(dataindex <= offset))
+		{
+			if (!ReadNext(stream)) { return 0U; }
+		}
+		inner = payloadsize - size_t(dataindex - offset);
+	}
+	// 必要なフレームを順に読み込みながらデータをコピーする
+	size_t copied = 0U;
+	///	読み出し開始位置を含むフレームを読み込んでいるか
+	auto started = false;
+	while (copied < size)
+	{
+		if (!valid) { break; }
+		if (payloadsize != 0U)
+		{
+			// 読み出し開始位置がフレームの内容に含まれない場合は、索引またはCDFSデータが不正
+			if ((!started)&&(payloadsize <= inner)) { break; }
+			started = true;
+			auto count = ((payloadsize - inner) < (size - copied))?(payloadsize - inner):(size - copied);
+			std::memcpy(buffer + copied, PayloadData(*this->buffer) + inner, count);
+			copied += count;
+			inner = 0U;
+		}
+		// 圧縮フレームのブロックの途中以外で内容を持たないフレームに位置付けられた場合も不正
+		else if ((!started)&&(blockpart == 0U)) { break; }
+		if ((copied < size)&&(!ReadNext(stream))) { break; }
+	}
+	return copied;
+}
+bool CDFSLoader::LoadIndex(std::istream& stream, std::istream& indexstream)
+{
+	auto loaded = CDFSIndex::Read(indexstream);
+	if ((!loaded.has_value())||(!loaded->IsComplete())) { return false; }
+	// 索引が記録している開始フレーム・終了フレームと照合する
+	auto position = stream.tellg();
+	auto head = std::optional<CDFSFrame>();
+	auto finf = std::optional<CDFSFrame>();
+	if (SeekStream(stream, 0U)) { head = ReadFrameFromStream(stream); }
+	if (SeekStream(stream, loaded->FrameCount() - 1U)) { finf = ReadFrameFromStream(stream); }
+	stream.clear();
+	stream.seekg(position);
+	if ((!head.has_value())||(!finf.has_value())) { return false; }
+	// 索引は実行環境のバイト順序に変換したフレームを記録している
+	auto order = CDFSByteOrderConverter::Detect(*head).value_or(CDFSByteOrder::Native);
+	CDFSByteOrderConverter::ToNative(&*head, 1U, order);
+	CDFSByteOrderConverter::ToNative(&*finf, 1U, order);
+	if (!loaded->Matches(*head, *finf)) { return false; }
+	index = std::move(loaded);
 	return true;
 }
+bool CDFSLoader::BuildIndex(std::istream& stream, const size_t& interval)
+{
+	auto position = stream.tellg();
+	auto built = CDFSIndex::Build(stream, interval);
+	stream.clear();
+	stream.seekg(position);
+	if (!built.has_value()) { return false; }
+	index = std::move(built);
+	return true;
+}
+const std::optional<CDFSIndex>& CDFSLoader::GetIndex() const noexcept { return index; }
+std::optional<bool> CDFSLoader::VerifyBlock(std::istream& stream, const size_t& block)
+{
+	if (!index.has_value()) { return std::nullopt; }
+	if (index->Checkpoints().size() <= block) { return false; }
+	auto first = uint64_t(block) * index->Interval();
+	auto count = ((index->FrameCount() - first) < index->Interval())?size_t(index->FrameCount() - first):index->Interval();
+	auto frames = std::vector<CDFSFrame>(count);
+	auto position = stream.tellg();
+	auto read = size_t(0U);
+	auto order = byteorder;
+	// 開始フレームを読み込む前はバイト順序を開始フレームから判定する
+	if ((!readhead)&&(SeekStream(stream, 0U)))
+	{
+		auto head = ReadFrameFromStream(stream);
+		if (head.has_value()) { order = CDFSByteOrderConverter::Detect(*head).value_or(order); }
+	}
+	if (SeekStream(stream, first))
+	{
+		stream.read((std::istream::char_type*)frames.data(), std::streamsize(sizeof(CDFSFrame) * count));
+		read = size_t(stream.gcount()) / sizeof(CDFSFrame);
+	}
+	stream.clear();
+	stream.seekg(position);
+	frames.resize(read);
+	CDFSByteOrderConverter::ToNative(frames.data(), frames.size(), order);
+	return index->VerifyBlock(block, Span<const CDFSFrame>(frames.data(), frames.size()));
+}
 bool CDFSLoader::HasValue() const noexcept { return buffer.has_value(); }
 bool CDFSLoader::IsValidData() const noexcept
 {
 	if(!HasValue()) { return false; }
-	return buffer->IsValid()&&VerifySequence(*buffer, uint64_t(frameindex));
+	// フレームの検証はフレームの読み込み時に行っている
+	return valid;
 }
 std::vector<uint8_t> CDFSLoader::GetData(const size_t& size) const
 {
 	// フレームを取得していない場合は空のオブジェクトを渡す
 	if (!HasValue()) { return std::vector<uint8_t>(); }
-	// データフレームが来ている場合はデータフレームの内容を渡す
-	if (CDFSDATAFrame::IsDATAFrame(*buffer))
+	// データフレームの内容を保留している場合は、保留を解除したデータを渡す
+	if (released.has_value()) { return std::vector<uint8_t>(released->begin(), released->begin() + std::ptrdiff_t((size < released->size())?size:released->size())); }
+	// データフレーム(またはブロックが揃った圧縮フレーム)が来ている場合はその内容を渡す
+	if (payloadsize != 0U)
 	{
-		auto result = CDFSDATAFrame(*buffer);
-		// 要求されたデータの大きさとデータフレーム内のデータの大きさを比較、いずれか小さい領域をコピー
-		if ((result.data().cbegin() + size) <= (result.data().cend()))
-		{
-			return std::vector<uint8_t>(result.data().cbegin(), result.data().cbegin() + size);
-		}
-		else
-		{
-			return std::vector<uint8_t>(result.data().cbegin(), result.data().cend());
-		}
+		// 要求されたデータの大きさとフレーム内のデータの大きさを比較、いずれか小さい領域をコピー
+		auto count = (size < payloadsize)?size:payloadsize;
+		auto data = PayloadData(*buffer);
+		return std::vector<uint8_t>(data, data + count);
 	}
 	// データフレームではない場合は空のオブジェクトを渡す
 	return std::vector<uint8_t>();
@@ -91,7 +412,7 @@ std::optional<bool> CDFSLoader::CheckIntegrity() const
 {
 	// 終了フレームが来ていない場合は検証できないためnulloptを渡す
 	if (!readfinf) { return std::nullopt; }
-	return (!fault)&&((frameindex+1) == framecount);
+	return (!fault)&&(!hashfault)&&((frameindex+1) == framecount)&&(dataindex == datasize);
 }
 
 std::optional<CDFSFrame> CDFSLoader::ReadFrameFromStream(std::istream& stream)
@@ -105,10 +426,351 @@ std::optional<CDFSFrame> CDFSLoader::ReadFrameFromStream(std::istream& stream)
 	}
 	return std::nullopt;
 }
+void CDFSLoader::Accept(const CDFSFrame& frame, const bool& hashpayload)
+{
+	payloadsize = 0U;
+	payloadhashed = true;
+	///	直前のフレームが示したデータフレームの大きさ
+	auto length = declared;
+	declared = 0U;
+	// フレームの検証に失敗した場合は検証失敗のフラグを立てる
+#if defined(CDFS_ENABLE_COUNTERS)
+	auto intact = Verify(frame);
+	auto ordered = VerifySequence(frame, uint64_t(frameindex));
+	if (!intact) { ++counters.validationfailures; }
+	else if (!ordered) { ++counters.sequencemismatches; }
+	++counters.Of(frame.frametype).frames;
+	valid = intact&&ordered;
+#else
+	valid = frame.IsValid()&&VerifySequence(frame, uint64_t(frameindex));
+#endif
+	if (!valid) { fault = true; }
+	// 開始フレームの読み込み
+	if ((valid)&&(!readhead)&&(CDFSHEADFrame::IsHEADFrame(frame)))
+	{
+		auto header = CDFSHEADView(frame);
+		// フォーマットバージョン確認
+		// (対応していないフォーマットバージョンのCDFSデータが来た場合の処理は未規定)
+		if (IsVersionCompatible(header))
+		{
+			label = std::string(header.data_label().data());
+			framecount = header.data_count();
+			datasize = header.data_size();
+			hashtype = header.data_hashtype();
+			readhead = true;
+			channel = 0U;
+			// 0x00000100 ではフラグの領域は予約済み
+			dense = (CDFS::BaseFormatVersion < header.data_version())&&((header.data_flags() & CDFSHEADFrame::DenseFlag) != 0U);
+			ResetHash();
+		}
+	}
+	// 終了フレームの読み込み
+	if ((valid)&&(readhead)&&(!readfinf)&&(CDFSFINFFrame::IsFINFFrame(frame)))
+	{
+		auto finf = CDFSFINFView(frame);
+		if (framecount == 0) { framecount = finf.data_count(); }
+		if (datasize == 0) { datasize = finf.data_size(); }
+		if (hashing)
+		{
+			// 保留していたデータを総サイズに合わせて切り詰めてから追加する
+			auto excess = (finf.data_size() < dataindex)?(dataindex - finf.data_size()):UInt128(0U);
+			auto count = (excess < hashpendingsize)?(hashpendingsize - size_t(excess)):size_t(0U);
+			hash.Push(hashpending.data(), hashpending.data() + count);
+			hashpendingsize = 0U;
+			auto expected = std::array<uint8_t, 32>();
+			auto value = hash.GetValue();
+			std::memcpy(expected.data(), value.data(), value.size());
+			hashfault = !std::equal(expected.begin(), expected.end(), finf.data_hash().begin());
+			hashing = false;
+		}
+		readfinf = true;
+	}
+	// チャンネル切り替えフレームの読み込み
+	if ((valid)&&(readhead)&&(!readfinf)&&(CDFSMETAFrame::IsCHANFrame(frame)))
+	{
+		channel = CDFSMETAView(frame).data_channel();
+		declared = CDFSMETAFrame::DeclaredSize(frame);
+	}
+	// データフレームの読み込み
+	// 検証に失敗したフレームもデータの位置を保つためデータフレームとして扱う
+	if ((readhead)&&(!readfinf)&&(CDFSDATAFrame::IsDATAFrame(frame)))
+	{
+		// 直前のチャンネル切り替えフレームが大きさを示している場合はそれに従う
+		// 総サイズが分かっている場合は最後のデータフレームを総サイズに合わせて切り詰める
+		if (length != 0U) { payloadsize = length; }
+		else if ((datasize != 0U)&&(dataindex <= datasize)&&((datasize - dataindex) < 240U)) { payloadsize = size_t(datasize - dataindex); }
+		else { payloadsize = 240U; }
+		dataindex += payloadsize;
+		if ((hashing)&&(!hashpayload)&&(datasize != 0U)) { payloadhashed = false; }
+		else if (hashing)
+		{
+			if (hashpendingsize != 0U)
+			{
+				hash.Push(hashpending.data(), hashpending.data() + hashpendingsize);
+				hashpendingsize = 0U;
+			}
+			// 総サイズが分かっていない場合は最後のデータフレームか判断できないため、次のフレームまで追加を保留する
+			if (datasize != 0U) { hash.Push(frame.data.data(), frame.data.data() + payloadsize); }
+			else
+			{
+				std::memcpy(hashpending.data(), frame.data.data(), payloadsize);
+				hashpendingsize = payloadsize;
+			}
+		}
+	}
+	// 圧縮フレームの読み込み
+	if ((readhead)&&(!readfinf)&&(CDFSCMPRFrame::IsCMPRFrame(frame)))
+	{
+		payloadsize = AcceptBlock(frame);
+		dataindex += payloadsize;
+		if ((payloadsize == 0U)||(!hashing)) {}
+		else if ((!hashpayload)&&(datasize != 0U)) { payloadhashed = false; }
+		else
+		{
+			// ブロックは切り詰められないため、保留しているデータとともにそのまま追加する
+			if (hashpendingsize != 0U)
+			{
+				hash.Push(hashpending.data(), hashpending.data() + hashpendingsize);
+				hashpendingsize = 0U;
+			}
+			hash.Push(blockraw.data(), blockraw.data() + payloadsize);
+		}
+	}
+#if defined(CDFS_ENABLE_COUNTERS)
+	counters.Of(frame.frametype).bytes += payloadsize;
+	if ((readfinf)&&(valid)&&(CDFSFINFFrame::IsFINFFrame(frame))) { Report(); }
+#endif
+}
+size_t CDFSLoader::AcceptBlock(const CDFSFrame& frame)
+{
+	auto cmpr = CDFSCMPRView(frame);
+	auto part = size_t(cmpr.data_part());
+	auto parts = size_t(cmpr.data_parts());
+	if (blockdata.empty())
+	{
+		blockdata.resize(CDFSCompression::FrameCount(CDFSCompression::MaxEncodedSize) * CDFSCMPRFrame::ContentSize);
+		blockraw.resize(CDFSCompression::BlockSize);
+	}
+	// ブロックの途中から読み込み始めた場合などは、次のブロックの先頭まで読み飛ばす
+	if (part == 0U) { blockdatasize = 0U; }
+	else if (part != blockpart) { blockpart = 0U; return 0U; }
+	if ((parts <= part)||(blockdata.size() < (parts * CDFSCMPRFrame::ContentSize)))
+	{
+		fault = true;
+		blockpart = 0U;
+		return 0U;
+	}
+	std::memcpy(blockdata.data() + blockdatasize, cmpr.data_content().data(), cmpr.data_content().size());
+	blockdatasize += cmpr.data_content().size();
+	blockpart = part + 1U;
+	if (blockpart != parts) { return 0U; }
+	blockpart = 0U;
+	auto size = CDFSCompression::DecodeBlock(blockdata.data(), blockdatasize, blockraw.data());
+	if (!size.has_value())
+	{
+		fault = true;
+		return 0U;
+	}
+	return *size;
+}
+const uint8_t* CDFSLoader::PayloadData(const CDFSFrame& frame) const noexcept
+{
+	return CDFSCMPRFrame::IsCMPRFrame(frame)?blockraw.data():frame.data.data();
+}
+void CDFSLoader::ResetHash()
+{
+	hash = XXH3();
+	hashing = (hashtype == CDFSHashTypes::XXH3);
+	hashfault = false;
+	hashpendingsize = 0U;
+}
+bool CDFSLoader::FillBatch(std::istream& stream)
+{
+	if (batch.empty()) { batch.resize(BatchSize); }
+	batchhead = 0U;
+	batchtail = 0U;
+	if (!stream.good()) { return false; }
+	auto data = (std::istream::char_type*)batch.data();
+	auto capacity = std::streamsize(sizeof(CDFSFrame) * batch.size());
+#if defined(CDFS_ENABLE_COUNTERS)
+	auto timer = std::optional<CDFSCounterTimer>();
+	timer.emplace(counters.iotime);
+#endif
+	if (!streaming)
+	{
+		stream.read(data, capacity);
+		// CDFSフレーム長に満たない末尾のデータは捨てる
+		batchtail = size_t(stream.gcount()) / sizeof(CDFSFrame);
+#if defined(CDFS_ENABLE_COUNTERS)
+		timer.reset();
+		Report();
+#endif
+		Normalize(batch.data(), batchtail);
+#if defined(CDFS_ENABLE_COUNTERS)
+		VerifyBatch();
+#endif
+		return batchtail != 0U;
+	}
+	// 最初の1フレームは到着を待ち、以降は待たずに読み込める分のみを読み込む
+	stream.read(data, std::streamsize(sizeof(CDFSFrame)));
+	auto size = stream.gcount();
+	if (size == std::streamsize(sizeof(CDFSFrame)))
+	{
+		while (size < capacity)
+		{
+			auto count = stream.readsome(data + size, capacity - size);
+			if (count <= 0) { break; }
+			size += count;
+		}
+		// 読み込みがフレームの途中で終わった場合はそのフレームの残りを待つ
+		auto remain = size % std::streamsize(sizeof(CDFSFrame));
+		if (remain != 0)
+		{
+			stream.read(data + size, std::streamsize(sizeof(CDFSFrame)) - remain);
+			size += stream.gcount();
+		}
+	}
+	batchtail = size_t(size) / sizeof(CDFSFrame);
+#if defined(CDFS_ENABLE_COUNTERS)
+	timer.reset();
+	Report();
+#endif
+	Normalize(batch.data(), batchtail);
+#if defined(CDFS_ENABLE_COUNTERS)
+	VerifyBatch();
+#endif
+	return batchtail != 0U;
+}
+void CDFSLoader::KeepFrame()
+{
+	this->buffer = batch[batchhead - 1U];
+	released.reset();
+}
+void CDFSLoader::Normalize(CDFSFrame* frames, const size_t& count) noexcept
+{
+	if ((count != 0U)&&(!readhead)) { byteorder = CDFSByteOrderConverter::Detect(frames[0]).value_or(byteorder); }
+	CDFSByteOrderConverter::ToNative(frames, count, byteorder);
+}
+std::optional<CDFSFrame> CDFSLoader::ReadFrame(std::istream& stream)
+{
+	auto result = std::optional<CDFSFrame>();
+	{
+#if defined(CDFS_ENABLE_COUNTERS)
+		auto timer = CDFSCounterTimer(counters.iotime);
+#endif
+		result = ReadFrameFromStream(stream);
+	}
+#if defined(CDFS_ENABLE_COUNTERS)
+	Report();
+#endif
+	if (result.has_value()) { Normalize(&*result, 1U); }
+	return result;
+}
+#if defined(CDFS_ENABLE_COUNTERS)
+void CDFSLoader::Report() const
+{
+	if (countercallback) { countercallback(counters); }
+}
+void CDFSLoader::VerifyBatch()
+{
+	auto begins = std::array<const uint8_t*, BatchSize>();
+	auto checksums = std::array<uint32_t, BatchSize>();
+	for (size_t i = 0; i < batchtail; i++) { begins[i] = batch[i].Bytes(); }
+	{
+		auto timer = CDFSCounterTimer(counters.crctime);
+		CRC32::Calculate(begins.data(), offsetof(CDFSFrame, checksum), checksums.data(), batchtail);
+	}
+	for (size_t i = 0; i < batchtail; i++) { batchintact[i] = (checksums[i] == batch[i].checksum); }
+}
+bool CDFSLoader::Verify(const CDFSFrame& frame)
+{
+	auto begin = (const CDFSFrame*)batch.data();
+	if ((std::less_equal<const CDFSFrame*>()(begin, &frame))&&(std::less<const CDFSFrame*>()(&frame, begin + batchtail))) { return batchintact[size_t(&frame - begin)]; }
+	auto timer = CDFSCounterTimer(counters.crctime);
+	return frame.IsValid();
+}
+#endif
+void CDFSLoader::Withhold(const CDFSFrame& frame)
+{
+	if (CDFSDATAFrame::IsDATAFrame(frame))
+	{
+		// 次のデータフレームが来たため、保留していたデータフレームは切り詰められないことが確定する
+		if (withheldsize != 0U)
+		{
+			payload = withheld[withheldside].data();
+			payloadremain = withheldsize;
+			withheldside ^= 1U;
+		}
+		std::memcpy(withheld[withheldside].data(), frame.data.data(), payloadsize);
+		withheldsize = payloadsize;
+		withheldchannel = channel.value_or(0U);
+	}
+	else if (CDFSCMPRFrame::IsCMPRFrame(frame))
+	{
+		// 圧縮フレームのブロックは切り詰められないため、保留していたデータフレームに続けて保留せずに読み出す
+		// (保留していたデータフレームも最後のデータフレームではないことが確定する)
+		if (payloadsize == 0U) { return; }
+		if (withheldsize != 0U)
+		{
+			payload = withheld[withheldside].data();
+			payloadremain = withheldsize;
+			withheldsize = 0U;
+			nextpayload = blockraw.data();
+			nextremain = payloadsize;
+		}
+		else
+		{
+			payload = blockraw.data();
+			payloadremain = payloadsize;
+		}
+	}
+	else if (readfinf)
+	{
+		// 保留していたデータフレームを総サイズに合わせて切り詰めて読み出す
+		auto excess = (datasize < dataindex)?(dataindex - datasize):UInt128(0U);
+		payload = withheld[withheldside].data();
+		payloadremain = (excess < withheldsize)?(withheldsize - size_t(excess)):size_t(0U);
+		withheldsize = 0U;
+		dataindex -= excess;
+	}
+}
+bool CDFSLoader::SeekStream(std::istream& stream, const UInt128& index)
+{
+	// std::streamoff で表現できない位置へはシークできない
+	if ((UInt128(uint64_t(std::numeric_limits<std::streamoff>::max())) / sizeof(CDFSFrame)) < index) { return false; }
+	stream.clear();
+	stream.seekg(std::streamoff(uint64_t(index) * sizeof(CDFSFrame)), std::ios_base::beg);
+	return !stream.fail();
+}
+bool CDFSLoader::LoadFINF(std::istream& stream)
+{
+	stream.clear();
+	stream.seekg(0, std::ios_base::end);
+	auto end = stream.tellg();
+	if ((stream.fail())||(end < std::streamoff(sizeof(CDFSFrame) * 2U))) { return false; }
+	///	終了フレームのインデックス
+	auto index = uint64_t(end / std::streamoff(sizeof(CDFSFrame))) - 1U;
+	if (!SeekStream(stream, index)) { return false; }
+	auto frame = ReadFrame(stream);
+	if ((!frame.has_value())||(!CDFSFINFFrame::IsFINFFrame(*frame))||(!frame->IsValid())||(!VerifySequence(*frame, index))) { return false; }
+	auto finf = CDFSFINFView(*frame);
+	framecount = finf.data_count();
+	datasize = finf.data_size();
+	return true;
+}
+bool CDFSLoader::IsDenseLayout() const noexcept
+{
+	// 開始フレーム・終了フレームと、データを格納するのに必要な数のデータフレームのみで構成されているか
+	return (dense)&&(framecount != 0U)&&(framecount == (((datasize + 239U) / 240U) + 2U));
+}
 bool CDFSLoader::IsVersionCompatible(const CDFSHEADFrame& frame)
 {
 	return frame.data_version() <= CDFS::FormatVersion;
 }
+bool CDFSLoader::IsVersionCompatible(const CDFSHEADView& frame) noexcept
+{
+	return frame.data_version() <= CDFS::FormatVersion;
+}
 bool CDFSLoader::VerifySequence(const CDFSFrame& frame, const uint64_t& seq)
 {
 	return frame.sequence == seq;
@@ -0,0 +1,150 @@
+//	zawa-ch/cdfs:/src/mappedloader
+//	Copyright 2020 zawa-ch.
+//
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cdfs/mappedloader.hpp"
+#include "cdfs/loader.hpp"
+using namespace zawa_ch::CDFS;
+
+CDFSMappedLoader::CDFSMappedLoader()
+	: mapping(), length(), label(), framecount(), datasize(), readhead(), readfinf(), range()
+{}
+CDFSMappedLoader::CDFSMappedLoader(const std::string& path) : CDFSMappedLoader() { Open(path); }
+CDFSMappedLoader::CDFSMappedLoader(CDFSMappedLoader&& other) noexcept
+	: mapping(std::exchange(other.mapping, nullptr)), length(std::exchange(other.length, 0U)), label(std::move(other.label)), framecount(other.framecount), datasize(other.datasize), readhead(other.readhead), readfinf(other.readfinf), range(std::exchange(other.range, CDFSFrameRange()))
+{}
+CDFSMappedLoader& CDFSMappedLoader::operator=(CDFSMappedLoader&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		mapping = std::exchange(other.mapping, nullptr);
+		length = std::exchange(other.length, 0U);
+		label = std::move(other.label);
+		framecount = other.framecount;
+		datasize = other.datasize;
+		readhead = other.readhead;
+		readfinf = other.readfinf;
+		range = std::exchange(other.range, CDFSFrameRange());
+	}
+	return *this;
+}
+CDFSMappedLoader::~CDFSMappedLoader() { Close(); }
+
+bool CDFSMappedLoader::Open(const std::string& path)
+{
+	Close();
+	auto descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (descriptor < 0) { return false; }
+	struct stat status = {};
+	if ((::fstat(descriptor, &status) != 0)||(status.st_size < off_t(sizeof(CDFSFrame))))
+	{
+		::close(descriptor);
+		return false;
+	}
+	auto size = size_t(status.st_size);
+	auto address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+	if (address == MAP_FAILED)
+	{
+		::close(descriptor);
+		return false;
+	}
+	// マップした領域はファイル記述子を閉じても有効
+	::close(descriptor);
+	// 実行環境と異なるバイト順序のファイルは、変換にファイル全体の読み込みと複製が必要になるため開かない
+	if (CDFSByteOrderConverter::Detect(*(const CDFSFrame*)address).value_or(CDFSByteOrder::Native) != CDFSByteOrder::Native)
+	{
+		::munmap(address, size);
+		return false;
+	}
+	mapping = (const uint8_t*)address;
+	length = size;
+	LoadMetadata();
+	// 最後のデータフレームは総サイズに合わせて切り詰める
+	range = CDFSFrameRange(Frames(), datasize);
+	return true;
+}
+void CDFSMappedLoader::Close() noexcept
+{
+	if (mapping != nullptr) { ::munmap((void*)mapping, length); }
+	mapping = nullptr;
+	length = 0U;
+	label.clear();
+	framecount = 0U;
+	datasize = 0U;
+	readhead = false;
+	readfinf = false;
+	range = CDFSFrameRange();
+}
+bool CDFSMappedLoader::IsOpen() const noexcept { return mapping != nullptr; }
+void CDFSMappedLoader::LoadMetadata()
+{
+	auto frames = Frames();
+	if (frames.empty()) { return; }
+	// 開始フレームの読み込み
+	const auto& head = frames[0];
+	if ((CDFSHEADFrame::IsHEADFrame(head))&&(head.IsValid())&&(CDFSLoader::VerifySequence(head, 0U)))
+	{
+		auto header = CDFSHEADView(head);
+		if (CDFSLoader::IsVersionCompatible(header))
+		{
+			// ラベルはnull終端されていない可能性があるため領域内で切り詰める
+			auto l = header.data_label();
+			auto e = l.begin();
+			while((e != l.end())&&(*e != '\0')) { ++e; }
+			label = std::string(l.begin(), e);
+			framecount = header.data_count();
+			datasize = header.data_size();
+			readhead = true;
+		}
+	}
+	if (!readhead) { return; }
+	// 終了フレームの読み込み
+	// 終了フレームはCDFSデータの最後にあるため末尾のみを確認する
+	const auto& last = frames[frames.size() - 1];
+	if ((CDFSFINFFrame::IsFINFFrame(last))&&(last.IsValid())&&(CDFSLoader::VerifySequence(last, uint64_t(frames.size() - 1))))
+	{
+		auto finf = CDFSFINFView(last);
+		framecount = finf.data_count();
+		datasize = finf.data_size();
+		readfinf = true;
+	}
+}
+
+bool CDFSMappedLoader::HasHEAD() const noexcept { return readhead; }
+bool CDFSMappedLoader::HasFINF() const noexcept { return readfinf; }
+const std::string& CDFSMappedLoader::Label() const noexcept { return label; }
+const UInt128& CDFSMappedLoader::FrameCount() const noexcept { return framecount; }
+const UInt128& CDFSMappedLoader::DataSize() const noexcept { return datasize; }
+
+size_t CDFSMappedLoader::Length() const noexcept { return length; }
+size_t CDFSMappedLoader::Size() const noexcept { return length / sizeof(CDFSFrame); }
+Span<const CDFSFrame> CDFSMappedLoader::Frames() const noexcept { return Span<const CDFSFrame>((const CDFSFrame*)mapping, Size()); }
+const CDFSFrameRange& CDFSMappedLoader::Range() const noexcept { return range; }
+const CDFSFrame& CDFSMappedLoader::GetFrame(const size_t& index) const noexcept { return Frames()[index]; }
+Span<const uint8_t> CDFSMappedLoader::GetData(const size_t& index) const noexcept { return range.GetData(index); }
+
+bool CDFSMappedLoader::Advise(const AccessPatterns& pattern) const noexcept { return Advise(pattern, 0U, Size()); }
+bool CDFSMappedLoader::Advise(const AccessPatterns& pattern, const size_t& index, const size_t& count) const noexcept
+{
+	if ((!IsOpen())||(Size() <= index)) { return false; }
+	auto advice = MADV_NORMAL;
+	switch (pattern)
+	{
+	case AccessPatterns::Normal: { advice = MADV_NORMAL; break; }
+	case AccessPatterns::Sequential: { advice = MADV_SEQUENTIAL; break; }
+	case AccessPatterns::Random: { advice = MADV_RANDOM; break; }
+	case AccessPatterns::WillNeed: { advice = MADV_WILLNEED; break; }
+	case AccessPatterns::DontNeed: { advice = MADV_DONTNEED; break; }
+	default: { return false; }
+	}
+	// madviseの範囲はページ境界に揃える必要がある
+	auto page = size_t(::sysconf(_SC_PAGESIZE));
+	auto first = (index * sizeof(CDFSFrame)) / page * page;
+	auto last = ((Size() - index) < count)?length:((index + count) * sizeof(CDFSFrame));
+	return ::madvise((void*)(mapping + first), last - first, advice) == 0;
+}
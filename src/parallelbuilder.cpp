@@ -0,0 +1,250 @@
+//	zawa-ch/cdfs:/src/parallelbuilder
+//	Copyright 2020 zawa-ch.
+//
+#include <cstring>
+#include <cstddef>
+#include "cdfs/parallelbuilder.hpp"
+#include "cdfs/builder.hpp"
+using namespace zawa_ch::CDFS;
+
+CDFSParallelBuilder::CDFSParallelBuilder(std::ostream& stream, const std::string& label, const size_t& threads, const size_t& depth)
+	: stream(stream), label(label), frameindex(), datasize(), wrotehead(), wrotefinf(), current(), fill(), hash(), blocks(), freeblocks(), work(), order(), writing(), stopping(), mutex(), freeready(), workready(), writeready(), workers(), writer()
+{
+	auto workercount = (threads != 0U)?threads:size_t(std::thread::hardware_concurrency());
+	if (workercount == 0U) { workercount = 1U; }
+	// 書き込み中のブロックと書き込み途中のフレームを移すブロックのため、最低でも2ブロック必要
+	auto blockcount = (depth != 0U)?depth:(workercount * 2U);
+	if (blockcount < 2U) { blockcount = 2U; }
+	for (size_t i = 0; i < blockcount; i++)
+	{
+		blocks.push_back(std::make_unique<Block>());
+		freeblocks.push_back(blocks.back().get());
+	}
+	for (size_t i = 0; i < workercount; i++) { workers.emplace_back(&CDFSParallelBuilder::WorkerLoop, this); }
+	writer = std::thread(&CDFSParallelBuilder::WriterLoop, this);
+}
+CDFSParallelBuilder::~CDFSParallelBuilder()
+{
+	Flush();
+	{
+		auto lock = std::unique_lock(mutex);
+		stopping = true;
+	}
+	workready.notify_all();
+	writeready.notify_all();
+	for (auto& worker: workers) { worker.join(); }
+	writer.join();
+}
+
+const std::string& CDFSParallelBuilder::Label() const { return label; }
+const UInt128& CDFSParallelBuilder::FrameIndex() const { return frameindex; }
+const UInt128& CDFSParallelBuilder::DataSize() const { return datasize; }
+size_t CDFSParallelBuilder::Threads() const { return workers.size(); }
+void CDFSParallelBuilder::WriteHEADFrame() { WriteHEADFrame(frameindex + 1, datasize); }
+void CDFSParallelBuilder::WriteHEADFrame(const UInt128& framecount, const UInt128& datasize)
+{
+	// 書き込み待ちのデータフレームを先に送出する
+	SubmitCurrent();
+	SubmitFrame(CDFSBuilder::BuildHEADFrame(label, framecount, datasize, CDFSHashTypes::XXH3).Frame());
+	// 開始フレーム書き込みフラグを立てる
+	wrotehead = true;
+	if (!wrotefinf) { ++frameindex; }
+}
+void CDFSParallelBuilder::WriteFINFFrame()
+{
+	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
+	if ((!wrotehead)||(wrotefinf)) { return; }
+	if (current != nullptr)
+	{
+		// 書き込み途中のフレームを最後のデータフレームとして確定する
+		if (fill != 0U)
+		{
+			++current->count;
+			current->lastsize = fill;
+			++frameindex;
+			datasize += fill;
+			fill = 0U;
+		}
+		if (current->count != 0U)
+		{
+			current->sequence = uint64_t(frameindex) - current->count;
+			Submit(current);
+		}
+		else
+		{
+			auto lock = std::unique_lock(mutex);
+			freeblocks.push_back(current);
+		}
+		current = nullptr;
+	}
+	SubmitFrame(CDFSBuilder::BuildFINFFrame(frameindex, datasize, hash.GetValue()).Frame());
+	// 終了フレーム書き込みフラグを立てる
+	wrotefinf = true;
+}
+void CDFSParallelBuilder::WriteCONTFrame()
+{
+	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
+	if ((!wrotehead)||(wrotefinf)) { return; }
+	// 書き込み待ちのデータフレームを先に送出する
+	// (書き込み途中のフレームはデータの順序に影響しないため保留したままにする)
+	SubmitCurrent();
+	SubmitFrame(CDFSBuilder::BuildCONTFrame(frameindex, label, datasize).Frame());
+	++frameindex;
+}
+void CDFSParallelBuilder::Write(const void* data, const size_t& size)
+{
+	// 開始フレーム書き込んでいない/終了フレーム書き込み済みの場合は何もせず処理終了
+	if ((!wrotehead)||(wrotefinf)) { return; }
+	auto source = (const uint8_t*)data;
+	auto remain = size;
+	hash.Push(source, source + size);
+	while (remain != 0U)
+	{
+		if (current == nullptr) { current = Acquire(); }
+		// フレームのデータ領域に直接コピーする
+		// (フレームヘッダーとチェックサムはワーカースレッドで設定する)
+		auto& frame = current->frames[current->count];
+		auto count = ((frame.data.size() - fill) < remain)?(frame.data.size() - fill):remain;
+		std::memcpy(frame.data.data() + fill, source, count);
+		fill += count;
+		source += count;
+		remain -= count;
+		if (fill == frame.data.size())
+		{
+			++current->count;
+			++frameindex;
+			datasize += frame.data.size();
+			fill = 0U;
+			if (current->count == BlockSize)
+			{
+				current->sequence = uint64_t(frameindex) - current->count;
+				Submit(current);
+				current = nullptr;
+			}
+		}
+	}
+}
+void CDFSParallelBuilder::Flush()
+{
+	SubmitCurrent();
+	{
+		auto lock = std::unique_lock(mutex);
+		freeready.wait(lock, [this] { return order.empty()&&(!writing); });
+	}
+	// 書き込みスレッドは待機中のためストリームを操作できる
+	stream.flush();
+}
+
+CDFSParallelBuilder::Block* CDFSParallelBuilder::Acquire()
+{
+	auto lock = std::unique_lock(mutex);
+	freeready.wait(lock, [this] { return !freeblocks.empty(); });
+	auto block = freeblocks.back();
+	freeblocks.pop_back();
+	block->count = 0U;
+	block->lastsize = block->frames[0].data.size();
+	block->sequence = 0U;
+	block->prepared = false;
+	block->done = false;
+	return block;
+}
+void CDFSParallelBuilder::Submit(Block* block)
+{
+	{
+		auto lock = std::unique_lock(mutex);
+		order.push_back(block);
+		if (block->prepared) { block->done = true; }
+		else { work.push_back(block); }
+	}
+	if (block->prepared) { writeready.notify_one(); }
+	else { workready.notify_one(); }
+}
+void CDFSParallelBuilder::SubmitCurrent()
+{
+	if ((current == nullptr)||(current->count == 0U)) { return; }
+	Block* next = nullptr;
+	// 書き込み途中のフレームは新しいブロックの先頭に移す
+	if (fill != 0U)
+	{
+		next = Acquire();
+		std::memcpy(next->frames[0].data.data(), current->frames[current->count].data.data(), fill);
+	}
+	current->sequence = uint64_t(frameindex) - current->count;
+	Submit(current);
+	current = next;
+}
+void CDFSParallelBuilder::SubmitFrame(const CDFSFrame& frame)
+{
+	auto block = Acquire();
+	block->frames[0] = frame;
+	block->count = 1U;
+	block->prepared = true;
+	Submit(block);
+}
+void CDFSParallelBuilder::WorkerLoop()
+{
+	while (true)
+	{
+		Block* block;
+		{
+			auto lock = std::unique_lock(mutex);
+			workready.wait(lock, [this] { return stopping||(!work.empty()); });
+			if (work.empty()) { return; }
+			block = work.front();
+			work.pop_front();
+		}
+		Prepare(*block);
+		{
+			auto lock = std::unique_lock(mutex);
+			block->done = true;
+		}
+		writeready.notify_one();
+	}
+}
+void CDFSParallelBuilder::WriterLoop()
+{
+	while (true)
+	{
+		Block* block;
+		{
+			auto lock = std::unique_lock(mutex);
+			// シーケンス順に書き込むため、先頭のブロックの処理完了を待つ
+			writeready.wait(lock, [this] { return (stopping&&order.empty())||((!order.empty())&&(order.front()->done)); });
+			if (order.empty()) { return; }
+			block = order.front();
+			order.pop_front();
+			writing = true;
+		}
+		// ストリーム書き込み
+		{
+			auto sentry = std::ostream::sentry(stream);
+			if (bool(sentry))
+			{
+				stream.write((const std::ostream::char_type*)block->frames.data(), std::streamsize(sizeof(CDFSFrame) * block->count));
+			}
+		}
+		{
+			auto lock = std::unique_lock(mutex);
+			writing = false;
+			freeblocks.push_back(block);
+		}
+		freeready.notify_all();
+	}
+}
+void CDFSParallelBuilder::Prepare(Block& block) noexcept
+{
+	auto begins = std::array<const uint8_t*, BlockSize>();
+	auto checksums = std::array<uint32_t, BlockSize>();
+	for (size_t i = 0; i < block.count; i++)
+	{
+		auto& frame = block.frames[i];
+		frame.sequence = block.sequence + i;
+		frame.frametype = CDFSFrameTypes::DATA;
+		begins[i] = (const uint8_t*)&frame;
+	}
+	// データを保持していない領域は0でフィルする
+	auto& last = block.frames[block.count - 1U];
+	std::memset(last.data.data() + block.lastsize, 0, last.data.size() - block.lastsize);
+	CRC32::Calculate(begins.data(), offsetof(CDFSFrame, checksum), checksums.data(), block.count);
+	for (size_t i = 0; i < block.count; i++) { block.frames[i].checksum = checksums[i]; }
+}
@@ -0,0 +1,528 @@
+//	zawa-ch/cdfs:/src/recovery
+//	Copyright 2020 zawa-ch.
+//
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <array>
+#include "cdfs/recovery.hpp"
+#include "cdfs/compression.hpp"
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define CDFS_RECOVERY_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using namespace zawa_ch::CDFS;
+
+namespace
+{
+	///	フレームの種類の数
+	constexpr size_t SignatureCount = 6;
+	///	フレームの種類のシグネチャ
+	constexpr std::array<CDFSFrameTypes, SignatureCount> Signatures = { CDFSFrameTypes::HEAD, CDFSFrameTypes::FINF, CDFSFrameTypes::DATA, CDFSFrameTypes::CONT, CDFSFrameTypes::META, CDFSFrameTypes::CMPR };
+	///	フレームの大きさ
+	constexpr size_t FrameSize = sizeof(CDFSFrame);
+	///	チェックサムの計算範囲の大きさ
+	constexpr size_t ChecksumLength = offsetof(CDFSFrame, checksum);
+
+	///	シグネチャの指定されたバイトを取得する
+	constexpr uint8_t SignatureByte(const CDFSFrameTypes& type, const size_t& index) noexcept { return uint8_t(uint32_t(type) >> (index * 8U)); }
+	///	指定された位置の4バイトがシグネチャと一致するかを取得する
+	bool IsSignature(const uint8_t* data) noexcept
+	{
+		auto value = uint32_t();
+		std::memcpy(&value, data, sizeof(value));
+		for (const auto& signature: Signatures) { if (value == uint32_t(signature)) { return true; } }
+		return false;
+	}
+	///	候補の位置のうち、シグネチャと一致する最初の位置を取得する
+	size_t ConfirmCandidates(const uint8_t* data, const size_t& size, const size_t& base, uint32_t mask) noexcept
+	{
+		while (mask != 0U)
+		{
+			auto position = base + size_t(__builtin_ctz(mask));
+			if (((position + 4U) <= size)&&(IsSignature(data + position))) { return position; }
+			mask &= mask - 1U;
+		}
+		return size;
+	}
+	///	シグネチャを1バイトずつ比較して探す
+	size_t FindSignatureScalar(const uint8_t* data, const size_t& begin, const size_t& size) noexcept
+	{
+		for (auto i = begin; (i + 4U) <= size; i++)
+		{
+			if (IsSignature(data + i)) { return i; }
+		}
+		return size;
+	}
+#if defined(__SSE2__)
+	///	シグネチャを探す(SSE2)
+	///	@details
+	///	各位置の先頭2バイトがいずれかのシグネチャと一致するかを16位置ずつ比較し、一致した位置のみ4バイトを照合する
+	size_t FindSignatureSSE2(const uint8_t* data, const size_t& size) noexcept
+	{
+		__m128i first[SignatureCount];
+		__m128i second[SignatureCount];
+		for (size_t i = 0; i < SignatureCount; i++)
+		{
+			first[i] = _mm_set1_epi8(char(SignatureByte(Signatures[i], 0U)));
+			second[i] = _mm_set1_epi8(char(SignatureByte(Signatures[i], 1U)));
+		}
+		size_t i = 0U;
+		for (; (i + 17U) <= size; i += 16U)
+		{
+			auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1U));
+			auto match = _mm_setzero_si128();
+			for (size_t t = 0; t < SignatureCount; t++)
+			{
+				match = _mm_or_si128(match, _mm_and_si128(_mm_cmpeq_epi8(a, first[t]), _mm_cmpeq_epi8(b, second[t])));
+			}
+			auto mask = uint32_t(_mm_movemask_epi8(match));
+			if (mask == 0U) { continue; }
+			auto found = ConfirmCandidates(data, size, i, mask);
+			if (found != size) { return found; }
+		}
+		return FindSignatureScalar(data, i, size);
+	}
+#endif
+#if defined(CDFS_RECOVERY_AVX2)
+	///	シグネチャを探す(AVX2)
+	__attribute__((target("avx2")))
+	size_t FindSignatureAVX2(const uint8_t* data, const size_t& size) noexcept
+	{
+		__m256i first[SignatureCount];
+		__m256i second[SignatureCount];
+		for (size_t i = 0; i < SignatureCount; i++)
+		{
+			first[i] = _mm256_set1_epi8(char(SignatureByte(Signatures[i], 0U)));
+			second[i] = _mm256_set1_epi8(char(SignatureByte(Signatures[i], 1U)));
+		}
+		size_t i = 0U;
+		for (; (i + 33U) <= size; i += 32U)
+		{
+			auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+			auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1U));
+			auto match = _mm256_setzero_si256();
+			for (size_t t = 0; t < SignatureCount; t++)
+			{
+				match = _mm256_or_si256(match, _mm256_and_si256(_mm256_cmpeq_epi8(a, first[t]), _mm256_cmpeq_epi8(b, second[t])));
+			}
+			auto mask = uint32_t(_mm256_movemask_epi8(match));
+			if (mask == 0U) { continue; }
+			auto found = ConfirmCandidates(data, size, i, mask);
+			if (found != size) { return found; }
+		}
+		return FindSignatureScalar(data, i, size);
+	}
+	///	実行環境でAVX2が使用できるか
+	bool RecoverySupportsAVX2() noexcept
+	{
+		static const bool supported = []
+		{
+			__builtin_cpu_init();
+			return bool(__builtin_cpu_supports("avx2"));
+		}();
+		return supported;
+	}
+#endif
+
+	///	復旧したフレームを順に受け取り、データを書き出す
+	class Recoverer final
+	{
+	public:
+		///	書き出しをまとめて行う大きさ
+		static constexpr size_t OutputSize = 1048576U;
+	private:
+		std::ostream& stream;
+		CDFSRecoveryReport& report;
+		///	書き出し待ちのデータ
+		std::vector<uint8_t> output;
+		size_t outputsize;
+		///	次に期待するシーケンス番号
+		uint64_t expected;
+		///	最後のデータフレームか判断できないため書き出しを保留しているデータ
+		std::array<uint8_t, 240> withheld;
+		bool withholding;
+		///	書き出したデータのハッシュ値
+		XXH3 hash;
+		bool hashing;
+		///	失われたデータの大きさを推定した範囲があるか
+		bool estimated;
+		///	読み込み途中の圧縮フレームのブロック
+		std::vector<uint8_t> block;
+		///	次に期待する圧縮フレームのブロック内での位置 (0 の場合はブロックを読み込んでいない)
+		size_t blockpart;
+		///	読み込み途中のブロックの最初のフレームのシーケンス番号
+		uint64_t blockframe;
+		///	読み込み途中のブロックを構成するフレーム数
+		size_t blockparts;
+		///	展開したブロックの内容
+		std::vector<uint8_t> raw;
+		///	直前のチャンネル切り替えフレームが示した、次のデータフレームに格納されたデータの大きさ
+		size_t declared;
+
+		///	データを書き出し待ちに追加する
+		void Emit(const uint8_t* data, const size_t& size)
+		{
+			if (hashing) { hash.Push(data, data + size); }
+			report.datasize += UInt128(uint64_t(size));
+			size_t done = 0U;
+			while (done < size)
+			{
+				auto count = ((OutputSize - outputsize) < (size - done))?(OutputSize - outputsize):(size - done);
+				std::memcpy(output.data() + outputsize, data + done, count);
+				outputsize += count;
+				done += count;
+				if (outputsize == OutputSize) { Flush(); }
+			}
+		}
+		///	失われたデータの範囲を0で埋める
+		void EmitZeros(UInt128 size)
+		{
+			static const auto zeros = std::array<uint8_t, 4096>();
+			while (size != 0U)
+			{
+				auto count = (size < zeros.size())?size_t(size):zeros.size();
+				Emit(zeros.data(), count);
+				size -= count;
+			}
+		}
+		///	保留しているデータを書き出す
+		void Release(const size_t& size = 240U)
+		{
+			if (!withholding) { return; }
+			Emit(withheld.data(), size);
+			withholding = false;
+		}
+		///	失われた範囲を記録して0で埋める
+		void Lose(CDFSRecoveryGap gap)
+		{
+			gap.dataoffset = report.datasize;
+			if (!gap.exact) { estimated = true; }
+			report.gaps.push_back(gap);
+			EmitZeros(gap.datasize);
+		}
+		///	読み込み途中の圧縮フレームのブロックを失われた範囲として記録する
+		///	@param	end	ブロックの最後に受け入れたフレームの次のシーケンス番号。
+		///	@return	ブロックを構成するフレームのうち @a end 以降にあるフレーム数。
+		uint64_t LoseBlock(const uint64_t& end)
+		{
+			if (blockpart == 0U) { return 0U; }
+			// 展開後の大きさはブロックの先頭のフレームから取得できる
+			auto size = CDFSCompression::DecodedSize(block.data(), block.size());
+			blockpart = 0U;
+			Release();
+			Lose(CDFSRecoveryGap{ blockframe, end - blockframe, 0U, size.value_or(0U), size.has_value() });
+			return ((end - blockframe) < blockparts)?(blockparts - (end - blockframe)):0U;
+		}
+		///	圧縮フレームをブロックに追加し、ブロックが揃った場合は展開して書き出す
+		void AcceptBlock(const CDFSFrame& frame)
+		{
+			auto cmpr = CDFSCMPRView(frame);
+			auto part = size_t(cmpr.data_part());
+			auto parts = size_t(cmpr.data_parts());
+			// ブロックの途中から受け入れた場合(先頭のフレームが失われた場合)は展開できないため、失われた範囲に含める
+			if ((blockpart != 0U)&&(part != blockpart)) { LoseBlock(frame.sequence); }
+			if (part != blockpart)
+			{
+				if (!report.gaps.empty()) { ++report.gaps.back().framecount; }
+				return;
+			}
+			if (part == 0U)
+			{
+				block.clear();
+				blockframe = frame.sequence;
+				blockparts = parts;
+			}
+			block.insert(block.end(), cmpr.data_content().begin(), cmpr.data_content().end());
+			blockpart = part + 1U;
+			if (blockpart < parts) { return; }
+			// 圧縮フレームのブロックは切り詰められないため、保留していたデータフレームも満たされていることが確定する
+			Release();
+			if (raw.empty()) { raw.resize(CDFSCompression::BlockSize); }
+			auto size = (blockpart == parts)?CDFSCompression::DecodeBlock(block.data(), block.size(), raw.data()):std::nullopt;
+			if (!size.has_value())
+			{
+				LoseBlock(frame.sequence + 1U);
+				return;
+			}
+			blockpart = 0U;
+			Emit(raw.data(), *size);
+		}
+	public:
+		Recoverer(std::ostream& stream, CDFSRecoveryReport& report)
+			: stream(stream), report(report), output(OutputSize), outputsize(), expected(), withheld(), withholding(), hash(), hashing(), estimated(), block(), blockpart(), blockframe(), blockparts(), raw(), declared()
+		{}
+
+		///	次に期待するシーケンス番号を取得する
+		uint64_t Expected() const noexcept { return expected; }
+		///	フレームを受け入れる
+		void Accept(const CDFSFrame& frame)
+		{
+			// データフレームの大きさは直前のフレームが示している場合のみ従う
+			auto length = (expected == frame.sequence)?declared:size_t(0U);
+			declared = 0U;
+			// シーケンス番号が飛んでいる場合は失われた範囲を記録して0で埋める
+			if (expected < frame.sequence)
+			{
+				// 読み込み途中の圧縮フレームのブロックは展開できないため失われた範囲とする
+				auto covered = LoseBlock(expected);
+				auto gap = CDFSRecoveryGap();
+				gap.frame = expected;
+				gap.framecount = frame.sequence - expected;
+				// 開始フレームと、失われた範囲とした圧縮フレームのブロックの残りはデータを持たない
+				auto excluded = ((expected == 0U)?1U:0U) + covered;
+				gap.datasize = UInt128((excluded < gap.framecount)?(gap.framecount - excluded):0U) * UInt128(240U);
+				// 失われたフレームがすべてブロックの残りのフレームであれば、失われたデータはブロックのみである
+				gap.exact = (covered != 0U)&&(gap.framecount <= covered);
+				// データサイズが記録されたフレームの場合はそれに合わせる
+				auto known = std::optional<UInt128>();
+				if (CDFSCONTFrame::IsCONTFrame(frame)&&(CDFSCONTView(frame).data_size() != 0U)) { known = CDFSCONTView(frame).data_size(); }
+				if (CDFSFINFFrame::IsFINFFrame(frame)) { known = CDFSFINFView(frame).data_size(); }
+				// 保留していたデータは失われた範囲より前にあるため書き出す
+				// (データサイズが分かっている場合は、失われたフレームにデータフレームが含まれない場合に備えて切り詰める)
+				if (known.has_value())
+				{
+					auto remain = (report.datasize < *known)?(*known - report.datasize):UInt128(0U);
+					Release((remain < 240U)?size_t(remain):size_t(240U));
+					gap.datasize = (report.datasize < *known)?(*known - report.datasize):UInt128(0U);
+					gap.exact = true;
+				}
+				else { Release(); }
+				Lose(gap);
+			}
+			switch (frame.frametype)
+			{
+			case CDFSFrameTypes::HEAD:
+			{
+				auto head = CDFSHEADView(frame);
+				report.hashead = true;
+				report.label = std::string(head.data_label().data(), strnlen(head.data_label().data(), head.data_label().size()));
+				hashing = (head.data_hashtype() == CDFSHashTypes::XXH3);
+				hash = XXH3();
+				break;
+			}
+			case CDFSFrameTypes::CMPR:
+			{
+				AcceptBlock(frame);
+				break;
+			}
+			case CDFSFrameTypes::DATA:
+			{
+				// 圧縮フレームのブロックの途中にデータフレームは書き込まれない
+				LoseBlock(frame.sequence);
+				Release();
+				// 大きさが示されている場合は切り詰める必要がないため保留しない
+				if (length != 0U)
+				{
+					Emit(frame.data.data(), length);
+					break;
+				}
+				std::memcpy(withheld.data(), frame.data.data(), withheld.size());
+				withholding = true;
+				break;
+			}
+			case CDFSFrameTypes::CONT:
+			{
+				// 継続フレームはデータフレームの区切りにのみ書き込まれる
+				Release();
+				break;
+			}
+			case CDFSFrameTypes::META:
+			{
+				// チャンネル切り替えフレームの前のデータフレームは満たされている
+				if (!CDFSMETAFrame::IsCHANFrame(frame)) { break; }
+				LoseBlock(frame.sequence);
+				Release();
+				declared = CDFSMETAFrame::DeclaredSize(frame);
+				break;
+			}
+			case CDFSFrameTypes::FINF:
+			{
+				auto finf = CDFSFINFView(frame);
+				auto size = finf.data_size();
+				LoseBlock(frame.sequence);
+				// 保留していたデータを総サイズに合わせて切り詰める
+				// (失われたデータの大きさを推定した場合、最後のデータフレーム以外は満たされているため総サイズを240で割った余りから求める)
+				if (estimated) { Release((size != 0U)?(size_t((size - 1U) % 240U) + 1U):size_t(0U)); }
+				else
+				{
+					auto remain = (report.datasize < size)?(size - report.datasize):UInt128(0U);
+					Release((remain < 240U)?size_t(remain):size_t(240U));
+				}
+				report.hasfinf = true;
+				if (hashing&&report.hashead)
+				{
+					auto value = hash.GetValue();
+					auto expected = std::array<uint8_t, 32>();
+					std::memcpy(expected.data(), value.data(), value.size());
+					report.hashmatch = std::equal(expected.begin(), expected.end(), finf.data_hash().begin());
+				}
+				break;
+			}
+			default: { break; }
+			}
+			expected = frame.sequence + 1U;
+			++report.frames;
+		}
+		///	保留しているデータをすべて書き出す
+		void Finish()
+		{
+			// 終了フレームを復旧できなかった場合は最後のデータフレームの大きさが分からないため、そのまま書き出す
+			Release();
+			LoseBlock(expected);
+			Flush();
+		}
+		///	書き出し待ちのデータをストリームに書き込む
+		void Flush()
+		{
+			if (outputsize == 0U) { return; }
+			stream.write((const std::ostream::char_type*)output.data(), std::streamsize(outputsize));
+			outputsize = 0U;
+		}
+	};
+	///	指定された位置のフレームを読み込む
+	CDFSFrame LoadFrame(const uint8_t* data) noexcept
+	{
+		auto frame = CDFSFrame();
+		std::memcpy(&frame, data, sizeof(frame));
+		return frame;
+	}
+	///	指定された位置のフレームのチェックサムが一致するかを取得する
+	bool IsChecksumValid(const uint8_t* data) noexcept
+	{
+		auto crc = CRC32();
+		crc.Push(data, data + ChecksumLength);
+		auto checksum = uint32_t();
+		std::memcpy(&checksum, data + ChecksumLength, sizeof(checksum));
+		return crc.GetValue() == checksum;
+	}
+	///	チェックサムが一致したフレームを受け入れるかを判断する
+	///	@param	available	@a data 以降の読み込み済みのデータの大きさ。
+	///	@param	eof	入力の終端に達しているか。
+	bool IsAcceptable(const CDFSFrame& frame, const uint64_t& expected, const uint8_t* data, const size_t& available, const bool& eof)
+	{
+		if (frame.sequence == expected) { return true; }
+		// 既に受け入れたシーケンス番号のフレームは重複しているため読み飛ばす
+		if (frame.sequence < expected) { return false; }
+		// シーケンス番号が飛んでいる場合は、偶然チェックサムが一致したものでないことを確かめるため後続のフレームも検証する
+		if (CDFSFINFFrame::IsFINFFrame(frame)) { return true; }
+		if (available < (FrameSize * 2U)) { return eof; }
+		if (!IsChecksumValid(data + FrameSize)) { return false; }
+		return LoadFrame(data + FrameSize).sequence == (frame.sequence + 1U);
+	}
+}
+
+bool CDFSRecoveryReport::IsComplete() const noexcept
+{
+	return hashead&&hasfinf&&gaps.empty()&&skipped.empty()&&hashmatch.value_or(true);
+}
+
+size_t CDFSRecoveryScanner::FindSignature(const uint8_t* data, const size_t& size) noexcept
+{
+#if defined(CDFS_RECOVERY_AVX2)
+	if (RecoverySupportsAVX2()) { return FindSignatureAVX2(data, size); }
+#endif
+#if defined(__SSE2__)
+	return FindSignatureSSE2(data, size);
+#else
+	return FindSignatureScalar(data, 0U, size);
+#endif
+}
+CDFSRecoveryReport CDFSRecoveryScanner::Recover(std::istream& source, std::ostream& payload)
+{
+	auto report = CDFSRecoveryReport();
+	auto recoverer = Recoverer(payload, report);
+	auto buffer = std::vector<uint8_t>(BlockSize);
+	///	バッファの先頭の入力上の位置
+	uint64_t position = 0U;
+	///	未処理のデータの範囲
+	size_t begin = 0U;
+	size_t end = 0U;
+	bool eof = false;
+	///	フレームの位置が揃っているか
+	// (揃っていない場合、 @a begin は既に候補から外れた位置を指す)
+	bool synced = true;
+	///	読み飛ばし始めた入力上の位置
+	uint64_t skipstart = 0U;
+	auto checksums = std::array<uint32_t, 256>();
+	auto begins = std::array<const uint8_t*, 256>();
+	while (!report.hasfinf)
+	{
+		// 後続のフレームの検証のため、2フレーム分以上のデータを読み込んでおく
+		if (((end - begin) <= (FrameSize * 2U))&&(!eof))
+		{
+			std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+			position += begin;
+			end -= begin;
+			begin = 0U;
+			while ((end < buffer.size())&&(!eof))
+			{
+				source.read((std::istream::char_type*)buffer.data() + end, std::streamsize(buffer.size() - end));
+				end += size_t(source.gcount());
+				eof = !source.good();
+			}
+		}
+		if ((end - begin) < FrameSize) { break; }
+		if (synced)
+		{
+			// 位置が揃っている間はフレームのチェックサムをまとめて計算する
+			// (入力の終端に達していない場合は、後続のフレームを検証できるフレームまでを処理する)
+			auto count = (end - begin - (eof?0U:FrameSize)) / FrameSize;
+			if (checksums.size() < count) { count = checksums.size(); }
+			for (size_t i = 0; i < count; i++) { begins[i] = buffer.data() + begin + (i * FrameSize); }
+			CRC32::Calculate(begins.data(), ChecksumLength, checksums.data(), count);
+			size_t accepted = 0U;
+			for (; accepted < count; accepted++)
+			{
+				auto data = begins[accepted];
+				auto frame = LoadFrame(data);
+				if ((frame.checksum != checksums[accepted])||(!IsAcceptable(frame, recoverer.Expected(), data, end - size_t(data - buffer.data()), eof))) { break; }
+				recoverer.Accept(frame);
+				if (report.hasfinf) { ++accepted; break; }
+			}
+			begin += accepted * FrameSize;
+			if ((accepted != count)&&(!report.hasfinf))
+			{
+				synced = false;
+				skipstart = position + begin;
+			}
+		}
+		else
+		{
+			// シグネチャを探し、候補の位置のフレームを検証する
+			// (入力の終端に達していない場合は、後続のフレームを検証できる位置までを候補とする)
+			auto reserve = eof?FrameSize:(FrameSize * 2U);
+			if ((end - begin) <= reserve) { break; }
+			auto first = begin + 1U + offsetof(CDFSFrame, frametype);
+			auto last = end - reserve + 1U + offsetof(CDFSFrame, frametype) + sizeof(CDFSFrameTypes) - 1U;
+			auto found = FindSignature(buffer.data() + first, last - first);
+			if (found == (last - first))
+			{
+				begin = end - reserve;
+				continue;
+			}
+			auto candidate = first + found - offsetof(CDFSFrame, frametype);
+			auto data = buffer.data() + candidate;
+			if ((IsChecksumValid(data))&&(IsAcceptable(LoadFrame(data), recoverer.Expected(), data, end - candidate, eof)))
+			{
+				report.skipped.push_back(CDFSSkippedRange{ skipstart, position + candidate - skipstart });
+				begin = candidate;
+				synced = true;
+			}
+			else { begin = candidate; }
+		}
+	}
+	// 復旧できなかった末尾の入力を記録する
+	if (!report.hasfinf)
+	{
+		if (synced) { skipstart = position + begin; }
+		if (skipstart < (position + end)) { report.skipped.push_back(CDFSSkippedRange{ skipstart, position + end - skipstart }); }
+	}
+	report.scanned = position + (report.hasfinf?begin:end);
+	recoverer.Finish();
+	return report;
+}
@@ -0,0 +1,81 @@
+//	zawa-ch/cdfs:/src/validator
+//	Copyright 2020 zawa-ch.
+//
+#include <cstddef>
+#include "cdfs/validator.hpp"
+using namespace zawa_ch::CDFS;
+
+CDFSValidationSummary& CDFSValidationSummary::operator+=(const CDFSValidationSummary& other) noexcept
+{
+	for (size_t i = 0; i < frames.size(); i++) { frames[i] += other.frames[i]; }
+	checksumfault += other.checksumfault;
+	sequencefault += other.sequencefault;
+	return *this;
+}
+
+namespace
+{
+	///	指定されたバイト順序のフレーム列を検証・分類します。
+	template<CDFSByteOrder Order>
+	CDFSValidationSummary ValidateIn(const Span<const CDFSFrame>& frames, const uint64_t& sequence, const Span<CDFSFrameStatus>& result) noexcept
+	{
+		///	一度にCRCを計算するフレーム数
+		constexpr size_t group = 16;
+		///	チェックサムの計算範囲
+		constexpr size_t length = offsetof(CDFSFrame, checksum);
+		auto summary = CDFSValidationSummary();
+		auto count = (frames.size() < result.size())?frames.size():result.size();
+		for (size_t i = 0; i < count; i += group)
+		{
+			auto n = ((count - i) < group)?(count - i):group;
+			// 複数フレームのCRCをまとめて計算する
+			const uint8_t* begins[group];
+			uint32_t checksums[group];
+			for (size_t j = 0; j < n; j++) { begins[j] = (const uint8_t*)&frames[i + j]; }
+			CRC32::Calculate(begins, length, checksums, n);
+			for (size_t j = 0; j < n; j++)
+			{
+				auto frame = CDFSBasicRawFrameView<Order>(frames[i + j]);
+				auto checksum = (frame.checksum() == checksums[j]);
+				auto sequential = (frame.sequence() == (sequence + i + j));
+				auto kind = CDFSValidator::Classify(frames[i + j], Order);
+				result[i + j].value = uint8_t((checksum?CDFSFrameStatus::ChecksumBit:0U) | (sequential?CDFSFrameStatus::SequenceBit:0U) | (uint8_t(kind) << CDFSFrameStatus::KindShift));
+				++summary.frames[size_t(kind)];
+				summary.checksumfault += checksum?0U:1U;
+				summary.sequencefault += sequential?0U:1U;
+			}
+		}
+		return summary;
+	}
+}
+CDFSValidationSummary CDFSValidator::Validate(const Span<const CDFSFrame>& frames, const uint64_t& sequence, const Span<CDFSFrameStatus>& result, const CDFSByteOrder& order) noexcept
+{
+	// 実行環境のバイト順序ではフィールドの読み出しに変換を伴わない
+	if (order != CDFSByteOrder::Native) { return ValidateIn<CDFSByteOrderConverter::Foreign>(frames, sequence, result); }
+	return ValidateIn<CDFSByteOrder::Native>(frames, sequence, result);
+}
+CDFSValidationSummary CDFSValidator::Validate(const Span<const CDFSFrame>& frames, const uint64_t& sequence, const CDFSByteOrder& order) noexcept
+{
+	// 結果をスタック上のバッファに分割して書き出しながら集計する
+	auto summary = CDFSValidationSummary();
+	auto buffer = std::array<CDFSFrameStatus, 256>();
+	for (size_t i = 0; i < frames.size(); i += buffer.size())
+	{
+		summary += Validate(frames.Subspan(i, buffer.size()), sequence + i, Span<CDFSFrameStatus>(buffer), order);
+	}
+	return summary;
+}
+CDFSFrameKinds CDFSValidator::Classify(const CDFSFrame& frame, const CDFSByteOrder& order) noexcept
+{
+	auto type = (order != CDFSByteOrder::Native)?CDFSBasicRawFrameView<CDFSByteOrderConverter::Foreign>(frame).frametype():frame.frametype;
+	switch (type)
+	{
+	case CDFSFrameTypes::HEAD: { return CDFSFrameKinds::HEAD; }
+	case CDFSFrameTypes::FINF: { return CDFSFrameKinds::FINF; }
+	case CDFSFrameTypes::DATA: { return CDFSFrameKinds::DATA; }
+	case CDFSFrameTypes::CONT: { return CDFSFrameKinds::CONT; }
+	case CDFSFrameTypes::META: { return CDFSFrameKinds::META; }
+	case CDFSFrameTypes::CMPR: { return CDFSFrameKinds::CMPR; }
+	default: { return CDFSFrameKinds::Unknown; }
+	}
+}
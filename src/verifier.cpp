@@ -0,0 +1,231 @@
+//	zawa-ch/cdfs:/src/verifier
+//	Copyright 2020 zawa-ch.
+//
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include "cdfs/verifier.hpp"
+#include "cdfs/loader.hpp"
+#include "cdfs/compression.hpp"
+#ifdef CDFS_HAS_MMAP
+#include "cdfs/mappedloader.hpp"
+#endif
+using namespace zawa_ch::CDFS;
+
+bool CDFSVerificationReport::IsValid() const noexcept
+{
+	return badframes.empty()&&badblocks.empty()&&hashead&&hasfinf&&countmatch&&sizematch&&layoutmatch&&(trailing == 0U)
+		&&(summary.Count(CDFSFrameKinds::HEAD) == 1U)&&(summary.Count(CDFSFrameKinds::FINF) == 1U);
+}
+
+CDFSVerificationReport CDFSVerifier::Verify(const Span<const CDFSFrame>& frames, const size_t& threads)
+{
+	// 実行環境と異なるバイト順序のフレーム列は変換した複製を検証する
+	auto order = (!frames.empty())?CDFSByteOrderConverter::Detect(frames[0]).value_or(CDFSByteOrder::Native):CDFSByteOrder::Native;
+	if (order != CDFSByteOrder::Native)
+	{
+		auto converted = std::vector<CDFSFrame>(frames.begin(), frames.end());
+		CDFSByteOrderConverter::ToNative(converted.data(), converted.size(), order);
+		auto report = Verify(Span<const CDFSFrame>(converted.data(), converted.size()), threads);
+		report.byteorder = order;
+		return report;
+	}
+	auto report = CDFSVerificationReport();
+	report.frames = frames.size();
+	report.byteorder = CDFSByteOrder::Native;
+	auto threadcount = (threads != 0U)?threads:size_t(std::thread::hardware_concurrency());
+	if (threadcount == 0U) { threadcount = 1U; }
+	auto chunks = (frames.size() + ChunkSize - 1U) / ChunkSize;
+	if (chunks < threadcount) { threadcount = (chunks != 0U)?chunks:1U; }
+
+	// 最後のデータフレームは余白を含む可能性があるため、チャンクのCRC32の計算から除外する
+	// (後に圧縮フレームが続くデータフレームは満たされており、チャンネル切り替えフレームが大きさを示すデータフレームは余白を含まない)
+	auto lastdata = frames.size();
+	for (auto i = frames.size(); i != 0U; i--)
+	{
+		auto kind = CDFSValidator::Classify(frames[i - 1U]);
+		if ((kind == CDFSFrameKinds::DATA)&&((i < 2U)||(CDFSMETAFrame::DeclaredSize(frames[i - 2U]) == 0U))) { lastdata = i - 1U; }
+		if ((kind == CDFSFrameKinds::DATA)||(kind == CDFSFrameKinds::CMPR)) { break; }
+	}
+	// チャンクごとのデータのCRC32とその長さ
+	auto crcs = std::vector<uint32_t>(chunks);
+	auto lengths = std::vector<uint64_t>(chunks);
+	// チャンクごとの圧縮フレームのブロックの展開後の大きさ
+	auto rawsizes = std::vector<uint64_t>(chunks);
+	// チャンクごとの大きさが示されたデータフレームが満たしていないデータの大きさ
+	auto shortfalls = std::vector<uint64_t>(chunks);
+
+	// 各スレッドは未処理のチャンクを順に取得して検証する
+	auto next = std::atomic<size_t>(0U);
+	auto mutex = std::mutex();
+	auto task = [&]()
+	{
+		auto summary = CDFSValidationSummary();
+		auto badframes = std::vector<size_t>();
+		auto badblocks = std::vector<size_t>();
+		auto status = std::vector<CDFSFrameStatus>(ChunkSize);
+		auto block = std::vector<uint8_t>();
+		auto raw = std::vector<uint8_t>();
+		for (auto chunk = next.fetch_add(1U); chunk < chunks; chunk = next.fetch_add(1U))
+		{
+			auto first = chunk * ChunkSize;
+			auto range = frames.Subspan(first, ChunkSize);
+			auto result = CDFSValidator::Validate(range, uint64_t(first), Span<CDFSFrameStatus>(status));
+			if (!result.IsValid())
+			{
+				for (size_t i = 0; i < range.size(); i++)
+				{
+					if (!status[i].IsValid()) { badframes.push_back(first + i); }
+				}
+			}
+			summary += result;
+			auto crc = CRC32();
+			uint64_t length = 0U;
+			uint64_t rawsize = 0U;
+			uint64_t shortfall = 0U;
+			for (size_t i = 0; i < range.size(); i++)
+			{
+				if (status[i].Kind() == CDFSFrameKinds::CMPR)
+				{
+					// ブロックの先頭のフレームから、チャンクの範囲を超えて後続のフレームを連結する
+					auto head = CDFSCMPRView(range[i]);
+					if (head.data_part() != 0U) { continue; }
+					auto parts = size_t(head.data_parts());
+					auto valid = (parts != 0U)&&(parts <= (frames.size() - (first + i)));
+					block.clear();
+					for (size_t j = 0; valid&&(j < parts); j++)
+					{
+						const auto& frame = frames[first + i + j];
+						valid = CDFSCMPRFrame::IsCMPRFrame(frame);
+						if (!valid) { break; }
+						auto cmpr = CDFSCMPRView(frame);
+						valid = (cmpr.data_part() == j)&&(cmpr.data_parts() == parts);
+						block.insert(block.end(), cmpr.data_content().begin(), cmpr.data_content().end());
+					}
+					if (raw.empty()) { raw.resize(CDFSCompression::BlockSize); }
+					auto size = valid?CDFSCompression::DecodeBlock(block.data(), block.size(), raw.data()):std::nullopt;
+					if (!size.has_value())
+					{
+						badblocks.push_back(first + i);
+						continue;
+					}
+					crc.Push(raw.data(), raw.data() + *size);
+					length += *size;
+					rawsize += *size;
+					continue;
+				}
+				if ((status[i].Kind() != CDFSFrameKinds::DATA)||((first + i) == lastdata)) { continue; }
+				const auto& data = range[i].data;
+				// 直前のチャンネル切り替えフレームが大きさを示している場合はそれに従う
+				// (直前のフレームはチャンクの範囲外にある場合がある)
+				auto size = ((first + i) != 0U)?CDFSMETAFrame::DeclaredSize(frames[first + i - 1U]):size_t(0U);
+				if (size != 0U) { shortfall += data.size() - size; }
+				else { size = data.size(); }
+				crc.Push(data.data(), data.data() + size);
+				length += size;
+			}
+			crcs[chunk] = crc.GetValue();
+			lengths[chunk] = length;
+			rawsizes[chunk] = rawsize;
+			shortfalls[chunk] = shortfall;
+		}
+		auto lock = std::unique_lock(mutex);
+		report.summary += summary;
+		report.badframes.insert(report.badframes.end(), badframes.begin(), badframes.end());
+		report.badblocks.insert(report.badblocks.end(), badblocks.begin(), badblocks.end());
+	};
+	auto workers = std::vector<std::thread>();
+	for (size_t i = 1; i < threadcount; i++) { workers.emplace_back(task); }
+	task();
+	for (auto& worker: workers) { worker.join(); }
+	std::sort(report.badframes.begin(), report.badframes.end());
+	std::sort(report.badblocks.begin(), report.badblocks.end());
+	for (const auto& rawsize: rawsizes) { report.blocksize += rawsize; }
+	auto shortfall = UInt128(0U);
+	for (const auto& item: shortfalls) { shortfall += item; }
+
+	if (frames.empty()) { return report; }
+	// 開始フレームの検証
+	const auto& head = frames[0];
+	///	開始フレームがデータフレームのみで構成されていることを示しているか
+	auto flagged = false;
+	if ((CDFSHEADFrame::IsHEADFrame(head))&&(head.IsValid())&&(CDFSLoader::VerifySequence(head, 0U)))
+	{
+		auto header = CDFSHEADView(head);
+		report.hashead = CDFSLoader::IsVersionCompatible(header);
+		report.headcount = header.data_count();
+		report.headsize = header.data_size();
+		flagged = (CDFS::BaseFormatVersion < header.data_version())&&((header.data_flags() & CDFSHEADFrame::DenseFlag) != 0U);
+	}
+	// 終了フレームの検証
+	const auto& last = frames[frames.size() - 1U];
+	if ((CDFSFINFFrame::IsFINFFrame(last))&&(last.IsValid())&&(CDFSLoader::VerifySequence(last, uint64_t(frames.size() - 1U))))
+	{
+		auto finf = CDFSFINFView(last);
+		report.hasfinf = true;
+		report.finfcount = finf.data_count();
+		report.finfsize = finf.data_size();
+	}
+	// フレーム数・総サイズの検証
+	// 開始フレームの記録は 0 (未記録) を許容する
+	if (report.hashead&&report.hasfinf)
+	{
+		auto count = UInt128(uint64_t(frames.size()));
+		report.countmatch = (report.finfcount == count)&&((report.headcount == 0U)||(report.headcount == count));
+		auto datacount = UInt128(uint64_t(report.summary.Count(CDFSFrameKinds::DATA)));
+		// 圧縮フレームのブロックに格納されたデータを除いた残りがデータフレームに格納されている
+		// (大きさが示されたデータフレームは満たしていない分を加えて数える)
+		report.sizematch = ((report.headsize == 0U)||(report.headsize == report.finfsize))&&(report.blocksize <= report.finfsize)
+			&&(((report.finfsize - report.blocksize + shortfall + 239U) / 240U) == datacount);
+		// 読み込み側はフラグを信頼してデータの位置からフレームの位置を求めるため、間のフレームがすべてデータフレームであることを確かめる
+		report.layoutmatch = (!flagged)||((datacount == (count - 2U))&&(report.sizematch)&&(((report.finfsize + 239U) / 240U) == datacount));
+	}
+	// データ全体のCRC32の計算
+	// チャンクごとの値を結合し、最後のデータフレームのデータを加える
+	report.payloadcrc = CRC32::Combine(crcs.data(), lengths.data(), crcs.size());
+	if (lastdata != frames.size())
+	{
+		const auto& data = frames[lastdata].data;
+		auto tail = data.size();
+		if (report.sizematch)
+		{
+			auto preceding = (UInt128(uint64_t(report.summary.Count(CDFSFrameKinds::DATA) - 1U)) * UInt128(240U)) - shortfall + report.blocksize;
+			tail = size_t(uint64_t(report.finfsize - preceding));
+		}
+		auto crc = CRC32();
+		crc.Push(data.data(), data.data() + tail);
+		report.payloadcrc = CRC32::Combine(report.payloadcrc, crc.GetValue(), uint64_t(tail));
+	}
+	return report;
+}
+#ifdef CDFS_HAS_MMAP
+std::optional<CDFSVerificationReport> CDFSVerifier::VerifyFile(const std::string& path, const size_t& threads)
+{
+	auto loader = CDFSMappedLoader(path);
+	if (loader.IsOpen())
+	{
+		loader.Advise(CDFSMappedLoader::AccessPatterns::Sequential);
+		auto report = Verify(loader.Frames(), threads);
+		report.trailing = loader.Length() % sizeof(CDFSFrame);
+		return report;
+	}
+	// 実行環境と異なるバイト順序のファイルはマップできないため、読み込んで変換したものを検証する
+	auto stream = std::ifstream(path, std::ios_base::binary);
+	stream.seekg(0, std::ios_base::end);
+	auto size = stream.tellg();
+	stream.seekg(0, std::ios_base::beg);
+	if ((stream.fail())||(size < std::streamoff(sizeof(CDFSFrame)))) { return std::nullopt; }
+	auto frames = std::vector<CDFSFrame>(size_t(size) / sizeof(CDFSFrame));
+	stream.read((std::istream::char_type*)frames.data(), std::streamsize(frames.size() * sizeof(CDFSFrame)));
+	if (size_t(stream.gcount()) != (frames.size() * sizeof(CDFSFrame))) { return std::nullopt; }
+	auto order = CDFSByteOrderConverter::Detect(frames[0]).value_or(CDFSByteOrder::Native);
+	if (order == CDFSByteOrder::Native) { return std::nullopt; }
+	CDFSByteOrderConverter::ToNative(frames.data(), frames.size(), order);
+	auto report = Verify(Span<const CDFSFrame>(frames.data(), frames.size()), threads);
+	report.trailing = size_t(size) % sizeof(CDFSFrame);
+	report.byteorder = order;
+	return report;
+}
+#endif
@@ -0,0 +1,119 @@
+//	zawa-ch/cdfs:/tests/crc32
+//	Copyright 2020 zawa-ch.
+//
+#include <iostream>
+#include <vector>
+#include <random>
+#include "cdfs/cdfs.hpp"
+using namespace zawa_ch::CDFS;
+
+///	1ビットずつ計算する参照実装
+uint32_t Reference(const uint8_t* begin, const uint8_t* end)
+{
+	uint32_t crc = 0xFFFFFFFFU;
+	for (auto i = begin; i != end; ++i)
+	{
+		crc ^= *i;
+		for (size_t j = 0; j < 8; j++) { crc = (crc >> 1) ^ (((crc & 1U) != 0U)?0xEDB88320U:0U); }
+	}
+	return ~crc;
+}
+
+int main()
+{
+	auto failures = size_t(0U);
+	auto check = [&](const bool& condition, const char* name, const size_t& a, const size_t& b)
+	{
+		if (condition) { return; }
+		if (failures < 16U) { std::cerr << "E: " << name << " mismatch (" << a << ", " << b << ")" << std::endl; }
+		++failures;
+	};
+	// 既知の値との照合
+	{
+		const char text[] = "123456789";
+		auto crc = CRC32();
+		crc.Push((const uint8_t*)text, (const uint8_t*)text + 9);
+		check(crc.GetValue() == 0xCBF43926U, "check value", 0U, 0U);
+	}
+
+	auto engine = std::mt19937(0);
+	auto data = std::vector<uint8_t>(4096 + 64);
+	for (auto& item : data) { item = uint8_t(engine()); }
+
+	// 各実装を、境界の揃っていない位置から様々な長さで参照実装と照合する
+	auto implementations = std::vector<CRC32::Implementations>{ CRC32::Implementations::Table };
+	if (CRC32::IsSupported(CRC32::Implementations::CLMUL)) { implementations.push_back(CRC32::Implementations::CLMUL); }
+	else { std::cout << "CLMUL: not supported, skipped" << std::endl; }
+	for (const auto& implementation : implementations)
+	{
+		for (size_t offset = 0; offset < 16; offset++)
+		{
+			for (size_t length = 0; length <= 600; length++)
+			{
+				auto begin = data.data() + offset;
+				auto expected = Reference(begin, begin + length);
+				auto whole = CRC32();
+				whole.Push(begin, begin + length, implementation);
+				check(whole.GetValue() == expected, "Push", offset, length);
+				// 分割して追加しても同じ値になる
+				auto split = length / 3U;
+				auto parts = CRC32();
+				parts.Push(begin, begin + split, implementation);
+				parts.Push(begin + split, begin + length, implementation);
+				check(parts.GetValue() == expected, "split Push", offset, length);
+			}
+		}
+		auto expected = Reference(data.data() + 1, data.data() + 1 + 4096);
+		auto large = CRC32();
+		large.Push(data.data() + 1, data.data() + 1 + 4096, implementation);
+		check(large.GetValue() == expected, "large Push", size_t(implementation), 4096U);
+	}
+	// 実行環境で選択された実装
+	for (size_t length = 0; length <= 600; length++)
+	{
+		auto crc = CRC32();
+		crc.Push(data.data() + 3, data.data() + 3 + length);
+		check(crc.GetValue() == Reference(data.data() + 3, data.data() + 3 + length), "active Push", 3U, length);
+	}
+
+	// 複数データの一括計算
+	for (const size_t length : { size_t(0U), size_t(1U), size_t(15U), size_t(16U), size_t(63U), size_t(64U), size_t(65U), size_t(252U), size_t(1000U) })
+	{
+		for (size_t count = 1; count <= 37; count++)
+		{
+			auto begins = std::vector<const uint8_t*>(count);
+			auto results = std::vector<uint32_t>(count);
+			for (size_t i = 0; i < count; i++) { begins[i] = data.data() + ((i * 97U) % 3000U); }
+			CRC32::Calculate(begins.data(), length, results.data(), count);
+			for (size_t i = 0; i < count; i++) { check(results[i] == Reference(begins[i], begins[i] + length), "Calculate", length, i); }
+		}
+	}
+
+	// ダイジェスト値の結合
+	for (size_t split = 0; split <= 4096; split += 173)
+	{
+		auto crcA = Reference(data.data(), data.data() + split);
+		auto crcB = Reference(data.data() + split, data.data() + 4096);
+		check(CRC32::Combine(crcA, crcB, uint64_t(4096U - split)) == Reference(data.data(), data.data() + 4096), "Combine", split, 4096U);
+	}
+	{
+		auto crcs = std::vector<uint32_t>();
+		auto lengths = std::vector<uint64_t>();
+		for (size_t begin = 0; begin < 4096; begin += 300)
+		{
+			auto end = ((begin + 300U) < 4096U)?(begin + 300U):size_t(4096U);
+			crcs.push_back(Reference(data.data() + begin, data.data() + end));
+			lengths.push_back(uint64_t(end - begin));
+		}
+		check(CRC32::Combine(crcs.data(), lengths.data(), crcs.size()) == Reference(data.data(), data.data() + 4096), "Combine list", crcs.size(), 4096U);
+		check(CRC32::Combine(crcs.data(), lengths.data(), 0U) == 0U, "Combine empty", 0U, 0U);
+	}
+
+	if (failures != 0U)
+	{
+		std::cerr << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "OK" << std::endl;
+	return 0;
+}
@@ -0,0 +1,119 @@
+//	zawa-ch/cdfs:/tests/index
+//	Copyright 2020 zawa-ch.
+//
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <random>
+#include "cdfs/builder.hpp"
+#include "cdfs/index.hpp"
+using namespace zawa_ch::CDFS;
+
+///	圧縮フレームのブロック・チャンネル切り替えフレームを含むCDFSデータの索引を構築します。
+std::string Build()
+{
+	auto content = std::vector<uint8_t>(CDFSCompression::BlockSize * 3U);
+	{
+		auto engine = std::mt19937(1U);
+		for (auto& item : content) { item = uint8_t(engine() % 16U); }
+	}
+	auto stream = std::stringstream();
+	auto builder = CDFSBuilder("index");
+	builder.EnableIndex(64U);
+	builder.WriteHEADFrame(stream);
+	builder.Write(stream, content.data(), 1000U);
+	builder.SetCompression(1U);
+	builder.Write(stream, content.data(), CDFSCompression::BlockSize * 2U);
+	builder.Flush(stream);
+	builder.SetCompression(0U);
+	builder.Write(stream, 1U, content.data(), 5000U);
+	builder.Write(stream, 0U, content.data(), 700U);
+	builder.WriteFINFFrame(stream);
+	builder.WriteHEADFrame(stream.seekp(0));
+	auto indexstream = std::stringstream();
+	builder.GetIndex()->Write(indexstream);
+	return indexstream.str();
+}
+///	索引ファイルの内容を書き換え、チェックサムを計算し直します。
+std::string Modify(const std::string& index, const std::function<void(std::string&, const size_t&)>& modifier)
+{
+	auto result = index;
+	auto checkpoints = uint64_t();
+	std::memcpy(&checkpoints, result.data() + 0x38, sizeof(uint64_t));
+	modifier(result, size_t(0x48U + (checkpoints * 24U)));
+	auto crc = CRC32();
+	crc.Push((const uint8_t*)result.data(), (const uint8_t*)result.data() + result.size() - sizeof(uint32_t));
+	auto value = crc.GetValue();
+	std::memcpy(&result[result.size() - sizeof(uint32_t)], &value, sizeof(value));
+	return result;
+}
+///	指定された位置に値を書き込みます。
+template<typename T>
+void Store(std::string& buffer, const size_t& offset, const T& value) { std::memcpy(&buffer[offset], &value, sizeof(T)); }
+///	指定された位置から値を読み込みます。
+template<typename T>
+T Load(const std::string& buffer, const size_t& offset) { auto value = T(); std::memcpy(&value, buffer.data() + offset, sizeof(T)); return value; }
+///	索引ファイルとして読み込めるかを取得します。
+bool Readable(const std::string& index)
+{
+	auto stream = std::istringstream(index);
+	return CDFSIndex::Read(stream).has_value();
+}
+
+int main()
+{
+	auto failures = size_t(0U);
+	auto check = [&](const bool& condition, const char* name)
+	{
+		if (condition) { return; }
+		if (failures < 16U) { std::cerr << "E: " << name << std::endl; }
+		++failures;
+	};
+	auto index = Build();
+	auto markers = Load<uint64_t>(index, 0x40);
+	auto framecount = Load<uint64_t>(index, 0x10);
+	auto datasize = Load<UInt128>(index, 0x18);
+	auto checkpoints = Load<uint64_t>(index, 0x38);
+	///	指定された種類の最初のマーカーのインデックス
+	auto find = [&](const CDFSFrameTypes& type)
+	{
+		for (size_t i = 0; i < markers; i++)
+		{
+			if (Load<CDFSFrameTypes>(index, size_t(0x48U + (checkpoints * 24U) + (i * 32U) + 8U)) == type) { return i; }
+		}
+		return size_t(markers);
+	};
+	auto cmpr = find(CDFSFrameTypes::CMPR);
+	auto meta = find(CDFSFrameTypes::META);
+	check((cmpr < markers)&&(meta < markers)&&(cmpr + 1U < markers), "Build");
+
+	// 書き換えていない索引とチェックサムのみを計算し直した索引は読み込める
+	check(Readable(index), "Read");
+	check(Readable(Modify(index, [](std::string&, const size_t&) {})), "Read recomputed");
+
+	// チェックポイントのデータの位置が減少する・総サイズを超える
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t&) { Store(buffer, 0x48U + 24U, UInt128(0U) - 1U); })), "Read checkpoint beyond size");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t&) { Store(buffer, 0x48U, UInt128(1U)); })), "Read first checkpoint");
+	// マーカーのフレームが減少する・フレーム数を超える
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + ((meta + 1U) * 32U), Load<uint64_t>(buffer, position + (meta * 32U))); })), "Read marker order");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + ((markers - 1U) * 32U), framecount); })), "Read marker beyond count");
+	// マーカーのデータの位置が減少する・総サイズを超える・格納できる大きさを超えて増加する
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + ((markers - 1U) * 32U) + 16U, datasize + 1U); })), "Read marker beyond size");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + ((cmpr + 1U) * 32U) + 16U, UInt128(0U)); })), "Read marker offset order");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + (cmpr * 32U) + 16U, Load<UInt128>(buffer, position + (cmpr * 32U) + 16U) + 500U); })), "Read inflated marker");
+	// 圧縮フレームのブロックが次のマーカーと重なる・ブロック内での位置が 0 でない
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + (cmpr * 32U) + 14U, uint16_t(0xFFFFU)); })), "Read block overlap");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + (cmpr * 32U) + 14U, uint16_t(0U)); })), "Read empty block");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + (cmpr * 32U) + 12U, uint16_t(1U)); })), "Read block part");
+	check(!Readable(Modify(index, [&](std::string& buffer, const size_t& position) { Store(buffer, position + (meta * 32U) + 14U, uint16_t(1U)); })), "Read meta parts");
+
+	if (failures != 0U)
+	{
+		std::cerr << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "OK" << std::endl;
+	return 0;
+}
@@ -0,0 +1,178 @@
+//	zawa-ch/cdfs:/tests/readat
+//	Copyright 2020 zawa-ch.
+//
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <random>
+#include "cdfs/builder.hpp"
+#include "cdfs/loader.hpp"
+using namespace zawa_ch::CDFS;
+
+///	圧縮フレームのブロックの後にデータフレームが続くCDFSデータと、その索引を構築します。
+void Build(const std::vector<uint8_t>& content, std::string& data, std::string& index)
+{
+	auto stream = std::stringstream();
+	auto builder = CDFSBuilder("readat");
+	builder.EnableIndex();
+	builder.SetCompression(1U);
+	builder.WriteHEADFrame(stream);
+	builder.Write(stream, content.data(), CDFSCompression::BlockSize);
+	builder.Flush(stream);
+	builder.SetCompression(0U);
+	builder.Write(stream, content.data() + CDFSCompression::BlockSize, content.size() - CDFSCompression::BlockSize);
+	builder.WriteFINFFrame(stream);
+	builder.WriteHEADFrame(stream.seekp(0));
+	data = stream.str();
+	auto indexstream = std::stringstream();
+	builder.GetIndex()->Write(indexstream);
+	index = indexstream.str();
+}
+///	索引の圧縮フレームのマーカーのデータの大きさを書き換え、チェックサムを計算し直します。
+void InflateMarker(std::string& index, const uint64_t& amount)
+{
+	auto checkpoints = uint64_t();
+	auto markers = uint64_t();
+	std::memcpy(&checkpoints, index.data() + 0x38, sizeof(uint64_t));
+	std::memcpy(&markers, index.data() + 0x40, sizeof(uint64_t));
+	for (uint64_t i = 0; i < markers; i++)
+	{
+		auto position = size_t(0x48U + (checkpoints * 24U) + (i * 32U));
+		auto type = CDFSFrameTypes();
+		std::memcpy(&type, index.data() + position + 8U, sizeof(type));
+		if (type != CDFSFrameTypes::CMPR) { continue; }
+		auto dataoffset = UInt128();
+		std::memcpy(&dataoffset, index.data() + position + 16U, sizeof(dataoffset));
+		dataoffset += amount;
+		std::memcpy(&index[position + 16U], &dataoffset, sizeof(dataoffset));
+	}
+	auto crc = CRC32();
+	crc.Push((const uint8_t*)index.data(), (const uint8_t*)index.data() + index.size() - sizeof(uint32_t));
+	auto value = crc.GetValue();
+	std::memcpy(&index[index.size() - sizeof(uint32_t)], &value, sizeof(value));
+}
+///	最初の圧縮フレームのブロックを指定された大きさのデータのブロックに置き換え、チェックサムを計算し直します。
+void ReplaceBlock(std::string& data, const std::vector<uint8_t>& content, const size_t& size)
+{
+	auto encoded = std::vector<uint8_t>(CDFSCompression::MaxEncodedSize);
+	auto encodedsize = CDFSCompression::EncodeBlock(content.data(), size, encoded.data(), 0U);
+	for (size_t index = 1U; (index * sizeof(CDFSFrame)) < data.size(); index++)
+	{
+		auto raw = CDFSFrame();
+		std::memcpy(&raw, data.data() + (index * sizeof(CDFSFrame)), sizeof(CDFSFrame));
+		if (!CDFSCMPRFrame::IsCMPRFrame(raw)) { break; }
+		auto frame = CDFSCMPRFrame(raw);
+		auto begin = (index - 1U) * CDFSCMPRFrame::ContentSize;
+		std::memset(frame.data_content().data(), 0, CDFSCMPRFrame::ContentSize);
+		if (begin < encodedsize) { std::memcpy(frame.data_content().data(), encoded.data() + begin, std::min(encodedsize - begin, CDFSCMPRFrame::ContentSize)); }
+		frame.Validate();
+		std::memcpy(&data[index * sizeof(CDFSFrame)], &frame.Frame(), sizeof(CDFSFrame));
+	}
+}
+///	データフレームのみ(または継続フレームを含む)のCDFSデータを構築します。
+std::string BuildPlain(const std::vector<uint8_t>& content, const bool& cont)
+{
+	auto stream = std::stringstream();
+	auto builder = CDFSBuilder("readat");
+	builder.WriteHEADFrame(stream);
+	builder.Write(stream, content.data(), content.size() / 2U);
+	if (cont) { builder.WriteCONTFrame(stream); }
+	builder.Write(stream, content.data() + (content.size() / 2U), content.size() - (content.size() / 2U));
+	builder.WriteFINFFrame(stream);
+	builder.WriteHEADFrame(stream.seekp(0));
+	return stream.str();
+}
+///	開始フレームがデータフレームのみで構成されていることを示しているかを取得します。
+bool IsDense(const std::string& data)
+{
+	auto frame = CDFSFrame();
+	std::memcpy(&frame, data.data(), sizeof(CDFSFrame));
+	return (CDFSHEADFrame(frame).data_flags() & CDFSHEADFrame::DenseFlag) != 0U;
+}
+///	索引を使用せずに、指定された位置から読み出します。
+size_t ReadAt(const std::string& data, const UInt128& offset, std::vector<uint8_t>& buffer)
+{
+	auto stream = std::istringstream(data);
+	auto loader = CDFSLoader();
+	return loader.ReadAt(stream, offset, buffer.data(), buffer.size());
+}
+///	索引を読み込んだ @a CDFSLoader で、指定された位置から読み出します。
+size_t ReadAt(const std::string& data, const std::string& index, const UInt128& offset, std::vector<uint8_t>& buffer)
+{
+	auto stream = std::istringstream(data);
+	auto indexstream = std::istringstream(index);
+	auto loader = CDFSLoader();
+	if (!loader.LoadIndex(stream, indexstream)) { return 0U; }
+	return loader.ReadAt(stream, offset, buffer.data(), buffer.size());
+}
+
+int main()
+{
+	auto failures = size_t(0U);
+	auto check = [&](const bool& condition, const char* name, const size_t& a, const size_t& b)
+	{
+		if (condition) { return; }
+		if (failures < 16U) { std::cerr << "E: " << name << " mismatch (" << a << ", " << b << ")" << std::endl; }
+		++failures;
+	};
+	auto content = std::vector<uint8_t>(CDFSCompression::BlockSize + 2000U);
+	{
+		auto engine = std::mt19937(1U);
+		for (auto& item : content) { item = uint8_t(engine() % 16U); }
+	}
+	auto data = std::string();
+	auto index = std::string();
+	Build(content, data, index);
+	auto buffer = std::vector<uint8_t>(300U);
+
+	// 索引を使用した読み出し
+	for (size_t offset : { size_t(0U), size_t(1000U), CDFSCompression::BlockSize - 100U, CDFSCompression::BlockSize + 100U })
+	{
+		auto size = ReadAt(data, index, offset, buffer);
+		check((size == buffer.size())&&(std::equal(buffer.begin(), buffer.end(), content.begin() + std::ptrdiff_t(offset))), "ReadAt", offset, size);
+	}
+
+	// 開始フレームのフラグに従ってデータの位置から直接フレームの位置を求める読み出しと、フレームを走査する読み出し
+	check(!IsDense(data), "Dense compressed", 0U, 0U);
+	for (auto cont : { false, true })
+	{
+		auto plain = BuildPlain(content, cont);
+		check(IsDense(plain) != cont, "Dense", cont, IsDense(plain));
+		for (size_t offset : { size_t(0U), size_t(239U), size_t(240U), content.size() / 2U, content.size() - 100U })
+		{
+			auto size = ReadAt(plain, offset, buffer);
+			auto expected = std::min(buffer.size(), content.size() - offset);
+			check((size == expected)&&(std::equal(buffer.begin(), buffer.begin() + std::ptrdiff_t(size), content.begin() + std::ptrdiff_t(offset))), "ReadAt plain", offset, size);
+		}
+	}
+
+	// 圧縮フレームのマーカーのデータの大きさが実際のブロックより大きい索引
+	{
+		auto inflated = index;
+		InflateMarker(inflated, 500U);
+		check(ReadAt(data, inflated, CDFSCompression::BlockSize + 100U, buffer) == 0U, "ReadAt inflated marker", CDFSCompression::BlockSize + 100U, 0U);
+	}
+
+	// 索引が示す大きさより小さいデータに展開される圧縮フレームのブロック
+	{
+		auto shrunk = data;
+		ReplaceBlock(shrunk, content, 100U);
+		check(ReadAt(shrunk, index, 1000U, buffer) == 0U, "ReadAt shrunk block", 1000U, 0U);
+	}
+
+	// 空のデータに展開される圧縮フレームのブロック
+	{
+		auto empty = data;
+		ReplaceBlock(empty, content, 0U);
+		check(ReadAt(empty, index, 0U, buffer) == 0U, "ReadAt empty block", 0U, 0U);
+	}
+
+	if (failures != 0U)
+	{
+		std::cerr << failures << " failures" << std::endl;
+		return 1;
+	}
+	std::cout << "OK" << std::endl;
+	return 0;
+}
@@ -0,0 +1,107 @@
+//	zawa-ch/cdfs:/tools/cdfsrecover
+//	Copyright 2020 zawa-ch.
+//
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <fstream>
+#include "cdfs/recovery.hpp"
+using namespace zawa_ch::CDFS;
+
+///	使用法を表示する
+void usage()
+{
+	std::cout << "\tUsage: <program> [-m mapfile] source.cdfs dest" << std::endl;
+}
+
+///	読み飛ばした入力の範囲と失われたデータの範囲を書き込む
+void writemap(std::ostream& stream, const CDFSRecoveryReport& report)
+{
+	stream << "# skip <input offset> <input size>" << std::endl;
+	for (const auto& range: report.skipped)
+	{
+		stream << "skip " << range.offset << " " << range.size << std::endl;
+	}
+	stream << "# gap <first frame> <frame count> <data offset> <data size> <exact|estimated>" << std::endl;
+	for (const auto& gap: report.gaps)
+	{
+		stream << "gap " << gap.frame << " " << gap.framecount << " " << uint64_t(gap.dataoffset) << " " << uint64_t(gap.datasize) << " " << (gap.exact?"exact":"estimated") << std::endl;
+	}
+}
+
+int main(int argc, char const *argv[])
+{
+	///	復旧するファイルのパス
+	auto source_filename = std::string_view();
+	///	復旧したデータを書き込むファイルのパス
+	auto dest_filename = std::string_view();
+	///	失われた範囲を書き込むファイルのパス
+	auto map_filename = std::string();
+	// 引数の解析
+	for (int i = 1; i < argc; i++)
+	{
+		auto arg = std::string_view(argv[i]);
+		if ((arg == "-m")&&((i + 1) < argc)) { map_filename = argv[++i]; }
+		else if (source_filename.empty()) { source_filename = arg; }
+		else { dest_filename = arg; }
+	}
+	if (dest_filename.empty())
+	{
+		std::cerr << "E: Too few arguments" << std::endl;
+		usage();
+		return 2;
+	}
+	if (map_filename.empty()) { map_filename = std::string(dest_filename) + ".map"; }
+	///	読み込みファイルのストリーム
+	auto source_stream = std::ifstream(std::string(source_filename), std::ios_base::binary);
+	if (!source_stream.good())
+	{
+		std::cerr << "E: Can't open source file" << std::endl;
+		return 1;
+	}
+	///	書き込みファイルのストリーム
+	auto dest_stream = std::ofstream(std::string(dest_filename), std::ios_base::binary);
+	if (!dest_stream.good())
+	{
+		std::cerr << "E: Can't open destination file" << std::endl;
+		return 1;
+	}
+	auto report = CDFSRecoveryScanner::Recover(source_stream, dest_stream);
+	dest_stream.close();
+	if (dest_stream.fail())
+	{
+		std::cerr << "E: Can't write destination file" << std::endl;
+		return 1;
+	}
+	std::cout << "Scanned: " << report.scanned << " bytes" << std::endl;
+	std::cout << "Recovered frames: " << report.frames << std::endl;
+	std::cout << "Recovered data: " << uint64_t(report.datasize) << " bytes" << std::endl;
+	if (report.hashead) { std::cout << "Label: " << report.label << std::endl; }
+	else { std::cerr << "W: HEAD frame is missing" << std::endl; }
+	if (!report.hasfinf) { std::cerr << "W: FINF frame is missing, the last data frame was not trimmed" << std::endl; }
+	for (const auto& range: report.skipped)
+	{
+		std::cerr << "W: Skipped " << range.size << " bytes at " << range.offset << std::endl;
+	}
+	for (const auto& gap: report.gaps)
+	{
+		std::cerr << "W: Lost " << gap.framecount << " frames from " << gap.frame << " (" << uint64_t(gap.datasize) << " bytes at " << uint64_t(gap.dataoffset) << ")" << std::endl;
+	}
+	if (report.hashmatch.has_value()&&(!*report.hashmatch)) { std::cerr << "W: Data hash mismatch" << std::endl; }
+	if ((!report.skipped.empty())||(!report.gaps.empty()))
+	{
+		auto map_stream = std::ofstream(map_filename);
+		writemap(map_stream, report);
+		if (!map_stream.good()) { std::cerr << "W: Can't write map file" << std::endl; }
+	}
+	if (report.IsComplete())
+	{
+		std::cout << "Complete" << std::endl;
+		return 0;
+	}
+	else
+	{
+		std::cerr << "W: Recovered with damage." << std::endl;
+		return 1;
+	}
+}
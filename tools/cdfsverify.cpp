@@ -0,0 +1,90 @@
+//	zawa-ch/cdfs:/tools/cdfsverify
+//	Copyright 2020 zawa-ch.
+//
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <iomanip>
+#include "cdfs/verifier.hpp"
+using namespace zawa_ch::CDFS;
+
+///	使用法を表示する
+void usage()
+{
+	std::cout << "\tUsage: <program> [-j threads] filename.cdfs" << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+	///	使用するスレッド数
+	size_t threads = 0U;
+	///	検証するファイルのパス
+	auto source_filename = std::string_view();
+	// 引数の解析
+	for (int i = 1; i < argc; i++)
+	{
+		auto arg = std::string_view(argv[i]);
+		if ((arg == "-j")&&((i + 1) < argc))
+		{
+			threads = size_t(std::stoul(argv[++i]));
+		}
+		else
+		{
+			source_filename = arg;
+		}
+	}
+	if (source_filename.empty())
+	{
+		std::cerr << "E: Too few arguments" << std::endl;
+		usage();
+		return 2;
+	}
+	auto report = CDFSVerifier::VerifyFile(std::string(source_filename), threads);
+	if (!report.has_value())
+	{
+		std::cerr << "E: Can't open source file" << std::endl;
+		return 1;
+	}
+	const auto& summary = report->summary;
+	std::cout << "Byte order: " << ((report->byteorder == CDFSByteOrder::Big)?"big":"little") << "-endian" << std::endl;
+	std::cout << "Frames: " << report->frames << std::endl;
+	std::cout << "  HEAD: " << summary.Count(CDFSFrameKinds::HEAD) << std::endl;
+	std::cout << "  FINF: " << summary.Count(CDFSFrameKinds::FINF) << std::endl;
+	std::cout << "  DATA: " << summary.Count(CDFSFrameKinds::DATA) << std::endl;
+	std::cout << "  CONT: " << summary.Count(CDFSFrameKinds::CONT) << std::endl;
+	std::cout << "  META: " << summary.Count(CDFSFrameKinds::META) << std::endl;
+	std::cout << "  CMPR: " << summary.Count(CDFSFrameKinds::CMPR) << std::endl;
+	std::cout << "  Unknown: " << summary.Count(CDFSFrameKinds::Unknown) << std::endl;
+	std::cout << "Checksum faults: " << summary.checksumfault << std::endl;
+	std::cout << "Sequence faults: " << summary.sequencefault << std::endl;
+	for (const auto& index: report->badframes)
+	{
+		std::cerr << "W: Frame " << index << " validation failed" << std::endl;
+	}
+	for (const auto& index: report->badblocks)
+	{
+		std::cerr << "W: Block at frame " << index << " can't be decompressed" << std::endl;
+	}
+	if (!report->hashead) { std::cerr << "W: HEAD frame is missing or invalid" << std::endl; }
+	if (!report->hasfinf) { std::cerr << "W: FINF frame is missing or invalid" << std::endl; }
+	if (report->hashead&&report->hasfinf)
+	{
+		std::cout << "Data size: " << uint64_t(report->finfsize) << std::endl;
+		std::cout << "Data CRC32: " << std::hex << std::setw(8) << std::setfill('0') << report->payloadcrc << std::dec << std::endl;
+		if (!report->countmatch) { std::cerr << "W: Frame count mismatch" << std::endl; }
+		if (!report->sizematch) { std::cerr << "W: Data size mismatch" << std::endl; }
+		if (!report->layoutmatch) { std::cerr << "W: HEAD frame layout flag mismatch" << std::endl; }
+	}
+	if (summary.Count(CDFSFrameKinds::Unknown) != 0U) { std::cerr << "W: Can't recognized frame type" << std::endl; }
+	if (report->trailing != 0U) { std::cerr << "W: " << report->trailing << " trailing bytes" << std::endl; }
+	if (report->IsValid())
+	{
+		std::cout << "Complete" << std::endl;
+		return 0;
+	}
+	else
+	{
+		std::cerr << "W: Integrity check failed." << std::endl;
+		return 1;
+	}
+}